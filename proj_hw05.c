@@ -40,17 +40,12 @@ void extract_instructionFields(WORD instruction, InstructionFields *fieldsOut){
 /* IDtoIF_get_stall
  * Input: InstructionFields *fields, ID_EX *old_idex
  * Output: Boolean represented by int, wether or not to stall.
- * Description: Tells the program if a stall is required from a prior lw instruction.
+ * Description: Tells the program if a stall is required because of the instruction in
+ * EX (a lw, or anything that a branch compares). See IDtoIF_get_hazard.
  */
 int IDtoIF_get_stall(InstructionFields *fields, ID_EX *old_idex){
-    // lw instruction memRead = 1
-    if(old_idex->memRead){
-        // check lw destination is input for next instruction
-        if(old_idex->rt == fields->rs || (old_idex->rt == fields->rt && !fields->opcode)){
-            return 1;
-        }
-    }
-    return 0;
+    EX_MEM nothing = {0};
+    return IDtoIF_get_hazard(fields, old_idex, &nothing) != HAZARD_NONE;
 }
 
 /* IDtoIF_get_branchControl
@@ -70,6 +65,19 @@ int IDtoIF_get_branchControl(InstructionFields *fields, WORD rsVal, WORD rtVal){
     return 0;
 }
 
+/* ID_getBranchOperand
+ * Input: int reg, WORD regVal, EX_MEM *old_exMem
+ * Output: WORD, newest value of the register
+ * Description: forwards an ALU result in MEM to a branch in ID. Anything older has
+ * already been written back (WB runs before ID), so regVal is current.
+ */
+WORD ID_getBranchOperand(int reg, WORD regVal, EX_MEM *old_exMem){
+    if(reg != 0 && old_exMem->regWrite && !old_exMem->memToReg && old_exMem->writeReg == reg){
+        return old_exMem->aluResult;
+    }
+    return regVal;
+}
+
 /* calc_branchAddr
  * Input: WORD pcPlus4, InstructionFields *fields
  * Output: next program counter
@@ -88,364 +96,254 @@ WORD calc_jumpAddr(WORD pcPlus4, InstructionFields *fields){
     return ((pcPlus4 >> 28) << 28) | (fields->address << 2);
 }
 
+/* ControlWord
+ * Description: One row of the control ROM used by execute_ID.  Every control bit
+ * that ID has to produce is packed into a single word.
+ *      valid        : 1 if this opcode/funct is a recognized instruction
+ *      keepRegs     : 0 clears rs, rt, rd, rsVal and rtVal (branches, jumps, nop)
+ *      keepImm      : 0 clears imm16 and imm32 (nop)
+ *      the rest     : copied into the ID_EX register of the same name
+ */
+typedef struct ControlWord{
+    unsigned valid    : 1;
+    unsigned keepRegs : 1;
+    unsigned keepImm  : 1;
+    unsigned ALUsrc   : 2;
+    unsigned bNegate  : 1;
+    unsigned ALUop    : 3;
+    unsigned memRead  : 1;
+    unsigned memWrite : 1;
+    unsigned memToReg : 1;
+    unsigned regDst   : 1;
+    unsigned regWrite : 1;
+    unsigned extra1   : 1;
+    unsigned extra2   : 1;
+    unsigned extra3   : 1;
+} ControlWord;
+
+//                     keepRegs  ALUsrc  ALUop   memWrite   regDst   extra1    extra3
+//                          keepImm  bNegate  memRead  memToReg regWrite  extra2
+#define CTRL(kr,ki, src,neg,op, mr,mw,m2r, dst,rw, e1,e2,e3) \
+    { 1, kr,ki, src,neg,op, mr,mw,m2r, dst,rw, e1,e2,e3 }
+
+/* opcodeROM
+ * Description: Control words for the I and J format instructions, indexed by opcode.
+ * Opcode 0 (R format) is looked up in functROM instead.
+ */
+static const ControlWord opcodeROM[64] = {
+    [0x08] = CTRL(1,1, 1,0,2, 0,0,0, 0,1, 0,0,0),   // addi
+    [0x09] = CTRL(1,1, 1,0,2, 0,0,0, 0,1, 0,0,0),   // addiu
+    [0x0a] = CTRL(1,1, 1,1,3, 0,0,0, 0,1, 0,0,0),   // slti
+    [0x23] = CTRL(1,1, 1,0,2, 1,0,1, 0,1, 0,0,0),   // lw
+    [0x2b] = CTRL(1,1, 1,0,2, 0,1,0, 0,0, 0,0,0),   // sw
+    [0x30] = CTRL(1,1, 1,0,2, 1,0,1, 0,1, 0,0,1),   // ll
+    [0x38] = CTRL(1,1, 1,0,2, 0,1,1, 0,1, 0,0,1),   // sc
+    [0x04] = CTRL(0,1, 0,0,0, 0,0,0, 0,0, 0,0,0),   // beq
+    [0x02] = CTRL(0,1, 0,0,0, 0,0,0, 0,0, 0,0,0),   // j
+    [0x05] = CTRL(0,1, 0,0,0, 0,0,0, 0,0, 1,0,0),   // bne
+    [0x0c] = CTRL(1,1, 2,0,0, 0,0,0, 0,1, 0,0,0),   // andi
+    [0x0d] = CTRL(1,1, 2,0,1, 0,0,0, 0,1, 0,0,0),   // ori
+    [0x0f] = CTRL(1,1, 2,0,4, 0,0,0, 0,1, 0,1,0),   // lui
+};
+
+/* functROM
+ * Description: Control words for the R format instructions, indexed by funct.
+ */
+static const ControlWord functROM[64] = {
+    [0x20] = CTRL(1,1, 0,0,2, 0,0,0, 1,1, 0,0,0),   // add
+    [0x21] = CTRL(1,1, 0,0,2, 0,0,0, 1,1, 0,0,0),   // addu
+    [0x22] = CTRL(1,1, 0,1,2, 0,0,0, 1,1, 0,0,0),   // sub
+    [0x23] = CTRL(1,1, 0,1,2, 0,0,0, 1,1, 0,0,0),   // subu
+    [0x24] = CTRL(1,1, 0,0,0, 0,0,0, 1,1, 0,0,0),   // and
+    [0x25] = CTRL(1,1, 0,0,1, 0,0,0, 1,1, 0,0,0),   // or
+    [0x27] = CTRL(1,1, 0,0,1, 0,0,0, 1,1, 1,0,0),   // nor
+    [0x2a] = CTRL(1,1, 0,1,3, 0,0,0, 1,1, 0,0,0),   // slt
+    [0x00] = CTRL(0,0, 0,0,4, 0,0,0, 1,1, 0,0,0),   // nop
+};
+
+/* SourceUse
+ * Description: One row of sourceROM: for rs and rt, the first phase that needs the
+ * register's value.
+ *      USE_NONE : not read (j, lui, nop; rt of most I format instructions)
+ *      USE_ID   : compared in ID (beq, bne)
+ *      USE_EX   : an ALU input
+ *      USE_MEM  : only needed in MEM (the data of sw)
+ */
+#define USE_NONE 0
+#define USE_ID   1
+#define USE_EX   2
+#define USE_MEM  3
+
+typedef struct SourceUse{
+    unsigned char rs, rt;
+} SourceUse;
+
+/* opcodeSources, functSources
+ * Description: what each instruction reads, indexed like opcodeROM and functROM.
+ * Unrecognized instructions read nothing.
+ */
+static const SourceUse opcodeSources[64] = {
+    [0x08] = { USE_EX,   USE_NONE },    // addi
+    [0x09] = { USE_EX,   USE_NONE },    // addiu
+    [0x0a] = { USE_EX,   USE_NONE },    // slti
+    [0x23] = { USE_EX,   USE_NONE },    // lw
+    [0x2b] = { USE_EX,   USE_MEM  },    // sw
+    [0x30] = { USE_EX,   USE_NONE },    // ll
+    [0x38] = { USE_EX,   USE_MEM  },    // sc
+    [0x04] = { USE_ID,   USE_ID   },    // beq
+    [0x02] = { USE_NONE, USE_NONE },    // j
+    [0x05] = { USE_ID,   USE_ID   },    // bne
+    [0x0c] = { USE_EX,   USE_NONE },    // andi
+    [0x0d] = { USE_EX,   USE_NONE },    // ori
+    [0x0f] = { USE_NONE, USE_NONE },    // lui
+};
+
+static const SourceUse functSources[64] = {
+    [0x20] = { USE_EX,   USE_EX   },    // add
+    [0x21] = { USE_EX,   USE_EX   },    // addu
+    [0x22] = { USE_EX,   USE_EX   },    // sub
+    [0x23] = { USE_EX,   USE_EX   },    // subu
+    [0x24] = { USE_EX,   USE_EX   },    // and
+    [0x25] = { USE_EX,   USE_EX   },    // or
+    [0x27] = { USE_EX,   USE_EX   },    // nor
+    [0x2a] = { USE_EX,   USE_EX   },    // slt
+    [0x00] = { USE_NONE, USE_NONE },    // nop
+};
+
+/* IDtoIF_get_hazard
+ * Input: InstructionFields *fields, ID_EX *old_idex, EX_MEM *old_exMem
+ * Output: HAZARD_NONE, or the reason that the instruction in ID has to stall.
+ * Description: Compares the registers the instruction reads (from sourceROM) with the
+ * ones that EX and MEM are about to write. Everything else is forwarded: ALU results
+ * to EX and to branches in ID, lw results to EX from WB, and to sw data in MEM.
+ * $zero is never a hazard.
+ */
+int IDtoIF_get_hazard(InstructionFields *fields, ID_EX *old_idex, EX_MEM *old_exMem){
+    const SourceUse *use = (fields->opcode == 0x00) ? &functSources[fields->funct]
+                                                    : &opcodeSources[fields->opcode];
+    int regs[2] = { fields->rs, fields->rt };
+    int uses[2] = { use->rs, use->rt };
+
+    // destinations of the instructions in EX (same as execute_EX) and in MEM
+    int exReg  = old_idex->regWrite ? (old_idex->ALUsrc ? old_idex->rt : old_idex->rd) : 0;
+    int memReg = old_exMem->regWrite ? old_exMem->writeReg : 0;
+
+    int i;
+    for(i = 0; i < 2; i++){
+        if(uses[i] == USE_NONE || regs[i] == 0){
+            continue;
+        }
+        if(regs[i] == exReg){
+            // nothing in EX has a result yet when ID needs it
+            if(uses[i] == USE_ID){
+                return HAZARD_BRANCH;
+            }
+            // a lw result reaches EX from WB, a clock too late
+            if(uses[i] == USE_EX && old_idex->memToReg){
+                return HAZARD_LOAD_USE;
+            }
+        }
+        // a lw in MEM hasn't read memory yet
+        if(regs[i] == memReg && uses[i] == USE_ID && old_exMem->memToReg){
+            return HAZARD_BRANCH;
+        }
+    }
+    return HAZARD_NONE;
+}
+
+/* stallControl
+ * Description: The bubble inserted into ID_EX on a stall: every field is cleared.
+ */
+static const ControlWord stallControl = CTRL(0,0, 0,0,0, 0,0,0, 0,0, 0,0,0);
+
+#undef CTRL
+
 /* execute_ID
  * Input: int IDstall, InstructionFields *fieldsIn, WORD rsVal, WORD rtVal, ID_EX *new_idex
  * Output: return code for recognized/unrecognized function.
- * Description: Executes ID phase of pipelined cpu. Sets control bits for instruction.
- *      ALUsrc       : determines source for ALU (between r or i type instructions)
- *      ALU.op       : ALU operation, 0 = and, 1 = or, 2 = add, 3 = less than
+ * Description: Executes ID phase of pipelined cpu. Looks up the control word for the
+ * instruction in opcodeROM/functROM and stores it into the pipeline register.
+ *      ALUsrc       : determines source for ALU (0 = rt, 1 = imm32, 2 = imm16)
+ *      ALU.op       : ALU operation, 0 = and, 1 = or, 2 = add, 3 = less than, 4 = none
  *      ALU.bNegate  : determines wether to negate the second alu input
  *      memRead      : determines wether to read from memory
  *      memWrite     : determines wether to write to memory
  *      memToReg     : determiens wether to wrtie from a memory to a register
  *      regDst       : determines where the register to write to's location is
  *      regWrite     : determines wether to write to a register
- *      branch       : determines branch if equal instruction
- *      jump         : determines j format instruction
- *      extra1       : determines branch if not equal instruction
- *      extra2       : determines if andi or ori instruction
- *      extra3       : not in use
+ *      extra1       : determines bne or nor instruction
+ *      extra2       : determines lui instruction
+ *      extra3       : determines ll or sc instruction (the simulator keeps the reservation)
+ * To add an instruction, add its row to opcodeROM (or functROM for R format).
  */
 int execute_ID(int IDstall, InstructionFields *fieldsIn, WORD rsVal, WORD rtVal, ID_EX *new_idex){
-    WORD op = fieldsIn->opcode;
-    WORD funct = fieldsIn->funct;
-    // copy to pipeline register
-    new_idex->rs = fieldsIn->rs;
-    new_idex->rt = fieldsIn->rt;
-    new_idex->rd = fieldsIn->rd;
-    new_idex->rsVal = rsVal;
-    new_idex->rtVal = rtVal;
-    new_idex->imm16 = fieldsIn->imm16;
-    new_idex->imm32 = fieldsIn->imm32;
-    // stall
+    const ControlWord *ctrl;
     if(IDstall){
-        new_idex->ALUsrc = 0;
-        new_idex->ALU.bNegate = 0;
-        new_idex->ALU.op = 0;
-        new_idex->memRead = 0;
-        new_idex->memWrite = 0;
-        new_idex->memToReg = 0;
-        new_idex->regDst = 0;
-        new_idex->regWrite = 0;
-        new_idex->extra1 = 0;
-        new_idex->extra2 = 0;
-        new_idex->extra3 = 0;
-        new_idex->rs = 0;
-        new_idex->rt = 0;
-        new_idex->rd = 0;
-        new_idex->rsVal = 0;
-        new_idex->rtVal = 0;
-        new_idex->imm16 = 0;
-        new_idex->imm32 = 0;
-    }
-    // add
-    else if(op==0x00 && funct==0x20){
-        new_idex->ALUsrc = 0;
-        new_idex->ALU.bNegate = 0;
-        new_idex->ALU.op = 2;
-        new_idex->memRead = 0;
-        new_idex->memWrite = 0;
-        new_idex->memToReg = 0;
-        new_idex->regDst = 1;
-        new_idex->regWrite = 1;
-        new_idex->extra1 = 0;
-        new_idex->extra2 = 0;
-        new_idex->extra3 = 0;
+        ctrl = &stallControl;
     }
-    // addu
-    else if(op==0x00 && funct==0x21){
-        new_idex->ALUsrc = 0;
-        new_idex->ALU.bNegate = 0;
-        new_idex->ALU.op = 2;
-        new_idex->memRead = 0;
-        new_idex->memWrite = 0;
-        new_idex->memToReg = 0;
-        new_idex->regDst = 1;
-        new_idex->regWrite = 1;
-        new_idex->extra1 = 0;
-        new_idex->extra2 = 0;
-        new_idex->extra3 = 0;
+    else if(fieldsIn->opcode == 0x00){
+        ctrl = &functROM[fieldsIn->funct];
     }
-    // sub
-    else if(op==0x00 && funct==0x22){
-        new_idex->ALUsrc = 0;
-        new_idex->ALU.bNegate = 1;
-        new_idex->ALU.op = 2;
-        new_idex->memRead = 0;
-        new_idex->memWrite = 0;
-        new_idex->memToReg = 0;
-        new_idex->regDst = 1;
-        new_idex->regWrite = 1;
-        new_idex->extra1 = 0;
-        new_idex->extra2 = 0;
-        new_idex->extra3 = 0;
-    }
-    // subu
-    else if(op==0x00 && funct==0x23){
-        new_idex->ALUsrc = 0;
-        new_idex->ALU.bNegate = 1;
-        new_idex->ALU.op = 2;
-        new_idex->memRead = 0;
-        new_idex->memWrite = 0;
-        new_idex->memToReg = 0;
-        new_idex->regDst = 1;
-        new_idex->regWrite = 1;
-        new_idex->extra1 = 0;
-        new_idex->extra2 = 0;
-        new_idex->extra3 = 0;
-    }
-    // addi
-    else if(op==0x08){
-        new_idex->ALUsrc = 1;
-        new_idex->ALU.bNegate = 0;
-        new_idex->ALU.op = 2;
-        new_idex->memRead = 0;
-        new_idex->memWrite = 0;
-        new_idex->memToReg = 0;
-        new_idex->regDst = 0;
-        new_idex->regWrite = 1;
-        new_idex->extra1 = 0;
-        new_idex->extra2 = 0;
-        new_idex->extra3 = 0;
-    }
-    // addiu
-    else if(op==0x09){
-        new_idex->ALUsrc = 1;
-        new_idex->ALU.bNegate = 0;
-        new_idex->ALU.op = 2;
-        new_idex->memRead = 0;
-        new_idex->memWrite = 0;
-        new_idex->memToReg = 0;
-        new_idex->regDst = 0;
-        new_idex->regWrite = 1;
-        new_idex->extra1 = 0;
-        new_idex->extra2 = 0;
-        new_idex->extra3 = 0;
-    }
-    // and
-    else if(op==0x00 && funct==0x24){
-        new_idex->ALUsrc = 0;
-        new_idex->ALU.bNegate = 0;
-        new_idex->ALU.op = 0;
-        new_idex->memRead = 0;
-        new_idex->memWrite = 0;
-        new_idex->memToReg = 0;
-        new_idex->regDst = 1;
-        new_idex->regWrite = 1;
-        new_idex->extra1 = 0;
-        new_idex->extra2 = 0;
-        new_idex->extra3 = 0;
-    }
-    // or
-    else if(op==0x00 && funct==0x25){
-        new_idex->ALUsrc = 0;
-        new_idex->ALU.bNegate = 0;
-        new_idex->ALU.op = 1;
-        new_idex->memRead = 0;
-        new_idex->memWrite = 0;
-        new_idex->memToReg = 0;
-        new_idex->regDst = 1;
-        new_idex->regWrite = 1;
-        new_idex->extra1 = 0;
-        new_idex->extra2 = 0;
-        new_idex->extra3 = 0;
-    }
-    // slt
-    else if(op==0x00 && funct==0x2a){
-        new_idex->ALUsrc = 0;
-        new_idex->ALU.bNegate = 1;
-        new_idex->ALU.op = 3;
-        new_idex->memRead = 0;
-        new_idex->memWrite = 0;
-        new_idex->memToReg = 0;
-        new_idex->regDst = 1;
-        new_idex->regWrite = 1;
-        new_idex->extra1 = 0;
-        new_idex->extra2 = 0;
-        new_idex->extra3 = 0;
-    }
-    // slti
-    else if(op==0x0a){
-        new_idex->ALUsrc = 1;
-        new_idex->ALU.bNegate = 1;
-        new_idex->ALU.op = 3;
-        new_idex->memRead = 0;
-        new_idex->memWrite = 0;
-        new_idex->memToReg = 0;
-        new_idex->regDst = 0;
-        new_idex->regWrite = 1;
-        new_idex->extra1 = 0;
-        new_idex->extra2 = 0;
-        new_idex->extra3 = 0;
-    }
-    // lw
-    else if(op==0x23){
-        new_idex->ALUsrc = 1;
-        new_idex->ALU.bNegate = 0;
-        new_idex->ALU.op = 2;
-        new_idex->memRead = 1;
-        new_idex->memWrite = 0;
-        new_idex->memToReg = 1;
-        new_idex->regDst = 0;
-        new_idex->regWrite = 1;
-        new_idex->extra1 = 0;
-        new_idex->extra2 = 0;
-        new_idex->extra3 = 0;
-    }
-    // sw
-    else if(op==0x2b){
-        new_idex->ALUsrc = 1;
-        new_idex->ALU.bNegate = 0;
-        new_idex->ALU.op = 2;
-        new_idex->memRead = 0;
-        new_idex->memWrite = 1;
-        new_idex->memToReg = 0;
-        new_idex->regDst = 0;
-        new_idex->regWrite = 0;
-        new_idex->extra1 = 0;
-        new_idex->extra2 = 0;
-        new_idex->extra3 = 0;
-    }
-    // beq
-    else if(op==0x04){
-        new_idex->ALUsrc = 0;
-        new_idex->ALU.bNegate = 0;
-        new_idex->ALU.op = 0;
-        new_idex->memRead = 0;
-        new_idex->memWrite = 0;
-        new_idex->memToReg = 0;
-        new_idex->regDst = 0;
-        new_idex->regWrite = 0;
-        new_idex->extra1 = 0;
-        new_idex->extra2 = 0;
-        new_idex->extra3 = 0;
-        new_idex->rs = 0;
-        new_idex->rt = 0;
-        new_idex->rd = 0;
-        new_idex->rsVal = 0;
-        new_idex->rtVal = 0;
-    }
-    // j
-    else if(op==0x02){
-        new_idex->ALUsrc = 0;
-        new_idex->ALU.bNegate = 0;
-        new_idex->ALU.op = 0;
-        new_idex->memRead = 0;
-        new_idex->memWrite = 0;
-        new_idex->memToReg = 0;
-        new_idex->regDst = 0;
-        new_idex->regWrite = 0;
-        new_idex->extra1 = 0;
-        new_idex->extra2 = 0;
-        new_idex->extra3 = 0;
-        new_idex->rs = 0;
-        new_idex->rt = 0;
-        new_idex->rd = 0;
-        new_idex->rsVal = 0;
-        new_idex->rtVal = 0;
-    }
-    // bne
-    else if(op == 0x05){
-        new_idex->ALUsrc = 0;
-        new_idex->ALU.bNegate = 0;
-        new_idex->ALU.op = 0;
-        new_idex->memRead = 0;
-        new_idex->memWrite = 0;
-        new_idex->memToReg = 0;
-        new_idex->regDst = 0;
-        new_idex->regWrite = 0;
-        new_idex->extra1 = 1;
-        new_idex->extra2 = 0;
-        new_idex->extra3 = 0;
-        new_idex->rs = 0;
-        new_idex->rt = 0;
-        new_idex->rd = 0;
-        new_idex->rsVal = 0;
-        new_idex->rtVal = 0;
-    }
-    // andi
-    else if(op == 0x0c){
-        new_idex->ALUsrc = 2;
-        new_idex->ALU.bNegate = 0;
-        new_idex->ALU.op = 0;
-        new_idex->memRead = 0;
-        new_idex->memWrite = 0;
-        new_idex->memToReg = 0;
-        new_idex->regDst = 0;
-        new_idex->regWrite = 1;
-        new_idex->extra1 = 0;
-        new_idex->extra2 = 0;
-        new_idex->extra3 = 0;
-    }
-    // ori
-    else if(op == 0x0d){
-        new_idex->ALUsrc = 2;
-        new_idex->ALU.bNegate = 0;
-        new_idex->ALU.op = 1;
-        new_idex->memRead = 0;
-        new_idex->memWrite = 0;
-        new_idex->memToReg = 0;
-        new_idex->regDst = 0;
-        new_idex->regWrite = 1;
-        new_idex->extra1 = 0;
-        new_idex->extra2 = 0;
-        new_idex->extra3 = 0;
+    else{
+        ctrl = &opcodeROM[fieldsIn->opcode];
     }
-    // nor
-    else if(op == 0x00 && funct == 0x27){
-        new_idex->ALUsrc = 0;
-        new_idex->ALU.bNegate = 0;
-        new_idex->ALU.op = 1;
-        new_idex->memRead = 0;
-        new_idex->memWrite = 0;
-        new_idex->memToReg = 0;
-        new_idex->regDst = 1;
-        new_idex->regWrite = 1;
-        new_idex->extra1 = 1;
-        new_idex->extra2 = 0;
-        new_idex->extra3 = 0;
+    // copy to pipeline register
+    *new_idex = (ID_EX){
+        .rs     = ctrl->keepRegs ? fieldsIn->rs : 0,
+        .rt     = ctrl->keepRegs ? fieldsIn->rt : 0,
+        .rd     = ctrl->keepRegs ? fieldsIn->rd : 0,
+        .rsVal  = ctrl->keepRegs ? rsVal : 0,
+        .rtVal  = ctrl->keepRegs ? rtVal : 0,
+        .imm16  = ctrl->keepImm ? fieldsIn->imm16 : 0,
+        .imm32  = ctrl->keepImm ? fieldsIn->imm32 : 0,
+        .ALUsrc = ctrl->ALUsrc,
+        .ALU    = { .bNegate = ctrl->bNegate, .op = ctrl->ALUop },
+        .memRead  = ctrl->memRead,
+        .memWrite = ctrl->memWrite,
+        .memToReg = ctrl->memToReg,
+        .regDst   = ctrl->regDst,
+        .regWrite = ctrl->regWrite,
+        .extra1 = ctrl->extra1,
+        .extra2 = ctrl->extra2,
+        .extra3 = ctrl->extra3,
+    };
+    // unused ROM rows are all zero, so valid is 0 for unrecognized instructions
+    return ctrl->valid;
+}
+
+/* EX_getForwardSource
+ * Input: int reg, EX_MEM *old_exMem, MEM_WB *old_memWb
+ * Output: FWD_EXMEM, FWD_MEMWB, or FWD_NONE if the value read in ID is current
+ * Description: forwarding unit, decides where the newest value of a register is.
+ * $zero is never forwarded.
+ */
+int EX_getForwardSource(int reg, EX_MEM *old_exMem, MEM_WB *old_memWb){
+    if(reg == 0){
+        return FWD_NONE;
     }
-    // lui
-    else if(op == 0x0f){
-        new_idex->ALUsrc = 2;
-        new_idex->ALU.bNegate = 0;
-        new_idex->ALU.op = 4;
-        new_idex->memRead = 0;
-        new_idex->memWrite = 0;
-        new_idex->memToReg = 0;
-        new_idex->regDst = 0;
-        new_idex->regWrite = 1;
-        new_idex->extra1 = 0;
-        new_idex->extra2 = 1;
-        new_idex->extra3 = 0;
+    // if old_exMem wrote to a register with the same address
+    if (old_exMem->regWrite && old_exMem->writeReg == reg){
+        return FWD_EXMEM;
     }
-    // nop
-    else if(op == 0x00 && funct == 0x00){
-        new_idex->ALUsrc = 0;
-        new_idex->ALU.bNegate = 0;
-        new_idex->ALU.op = 4;
-        new_idex->memRead = 0;
-        new_idex->memWrite = 0;
-        new_idex->memToReg = 0;
-        new_idex->regDst = 1;
-        new_idex->regWrite = 1;
-        new_idex->extra1 = 0;
-        new_idex->extra2 = 0;
-        new_idex->extra3 = 0;
-        new_idex->rs = 0;
-        new_idex->rt = 0;
-        new_idex->rd = 0;
-        new_idex->rsVal = 0;
-        new_idex->rtVal = 0;
-        new_idex->imm16 = 0;
-        new_idex->imm32 = 0;
+    // if old_memWb wrote to a register with the same address
+    else if(old_memWb->regWrite && old_memWb->writeReg == reg){
+        return FWD_MEMWB;
     }
-    // not a recognized instruction
-    else{
-        return 0;
+    return FWD_NONE;
+}
+
+/* EX_getForwardedValue
+ * Input: int reg, WORD regVal, EX_MEM *old_exMem, MEM_WB *old_memWb
+ * Output: WORD, newest value of the register
+ * Description: regVal (read in ID), or the value forwarded from MEM or WB. In WB,
+ * memToReg picks the loaded value over the address.
+ */
+WORD EX_getForwardedValue(int reg, WORD regVal, EX_MEM *old_exMem, MEM_WB *old_memWb){
+    switch(EX_getForwardSource(reg, old_exMem, old_memWb)){
+        case FWD_EXMEM: return old_exMem->aluResult;
+        case FWD_MEMWB: return old_memWb->memToReg ? old_memWb->memResult : old_memWb->aluResult;
     }
-    // if it has not returned 0 it is a recognized instruction
-    return 1;
+    return regVal;
 }
 
 /* EX_getALUinput1
@@ -454,16 +352,8 @@ int execute_ID(int IDstall, InstructionFields *fieldsIn, WORD rsVal, WORD rtVal,
  * Description: gets first alu input and handles forwarding from previous instructions.
  */
 WORD EX_getALUinput1(ID_EX *in, EX_MEM *old_exMem, MEM_WB *old_memWb){
-    // if old_exMem wrote to a register with the same address as rs
-    if (old_exMem->regWrite && old_exMem->writeReg == in->rs){
-        return old_exMem->aluResult;
-    }
-    // if old_memWb wrote to a register with the same address as rs
-    else if(old_memWb->regWrite && old_memWb->writeReg == in->rs){
-        return old_memWb->aluResult;
-    }
     // first ALUinput is rsVal
-    return in->rsVal;
+    return EX_getForwardedValue(in->rs, in->rsVal, old_exMem, old_memWb);
 }
 
 /* EX_getALUinput2
@@ -481,16 +371,36 @@ WORD EX_getALUinput2(ID_EX *in, EX_MEM *old_exMem, MEM_WB *old_memWb){
         // use immediate 32 bit for ALUinput2
         return in->imm32;
     }
-    // r format instruction
-    // if old_exMem wrote to a register with the same address as rt
-    if (old_exMem->regWrite && old_exMem->writeReg == in->rt){
-        return old_exMem->aluResult;
+    // r format instruction, second ALUinput is rtVal
+    return EX_getForwardedValue(in->rt, in->rtVal, old_exMem, old_memWb);
+}
+
+/* EX_getStoreData
+ * Input: ID_EX *in, EX_MEM *old_exMem, MEM_WB *old_memWb
+ * Output: WORD, the rtVal for EX_MEM
+ * Description: forwards the data for a sw. A lw right in front of it hasn't read
+ * memory yet; MEM_getStoreData() forwards that one a clock later.
+ */
+WORD EX_getStoreData(ID_EX *in, EX_MEM *old_exMem, MEM_WB *old_memWb){
+    if(!in->memWrite){
+        return in->rtVal;
     }
-    // if old_memWb wrote to a register with the same address as rt
-    else if(old_memWb->regWrite && old_memWb->writeReg == in->rt){
-        return old_memWb->aluResult;
+    if(old_exMem->memToReg && old_exMem->regWrite && old_exMem->writeReg == in->rt){
+        return in->rtVal;
+    }
+    return EX_getForwardedValue(in->rt, in->rtVal, old_exMem, old_memWb);
+}
+
+/* MEM_getStoreData
+ * Input: EX_MEM *in, MEM_WB *old_memWb
+ * Output: WORD, the data that a sw writes
+ * Description: forwards the result of the instruction right in front of a sw (in WB)
+ * into its data. For a sw, writeReg is rt.
+ */
+WORD MEM_getStoreData(EX_MEM *in, MEM_WB *old_memWb){
+    if(in->memWrite && in->writeReg != 0 && old_memWb->regWrite && old_memWb->writeReg == in->writeReg){
+        return old_memWb->memToReg ? old_memWb->memResult : old_memWb->aluResult;
     }
-    // second ALUinput is rtVal
     return in->rtVal;
 }
 
@@ -558,9 +468,11 @@ void execute_EX(ID_EX *in, WORD input1, WORD input2, EX_MEM *new_exMem){
 
 /* execute_MEM
  * Input: EX_MEM *in, WORD *mem, MEM_WB *new_memwb
- * Description: executes memory phase of pipelined cpu.
+ * Output: index of the word written to mem, -1 if nothing was written
+ * Description: executes memory phase of pipelined cpu. An sc writes 1 to rt if it
+ * stored, and 0 if the simulator cleared memWrite because it lost its reservation.
  */
-void execute_MEM(EX_MEM *in, WORD *mem, MEM_WB *new_memwb){
+int execute_MEM(EX_MEM *in, WORD *mem, MEM_WB *new_memwb){
     // copy to next pipeline register
     new_memwb->aluResult = in->aluResult;
     new_memwb->memToReg = in->memToReg;
@@ -569,21 +481,22 @@ void execute_MEM(EX_MEM *in, WORD *mem, MEM_WB *new_memwb){
     new_memwb->extra1 = in->extra1;
     new_memwb->extra2 = in->extra2;
     new_memwb->extra3 = in->extra3;
-    // lw instruction
-    if(in->memToReg){
+    // lw or ll instruction
+    if(in->memRead){
         // aluResult is address, read from adress/4 because WORD
         new_memwb->memResult = mem[in->aluResult/4];
     }
     else{
-        // sw instruction
+        // set result to 0 if not modified, sc gets 1 if it stores
+        new_memwb->memResult = in->extra3 && in->memWrite;
+        // sw or sc instruction
         if(in->memWrite){
             // aluResult is adress, rtVal is value to save
             mem[in->aluResult/4] = in->rtVal;
+            return in->aluResult/4;
         }
-        // set result to 0 if not modified
-        new_memwb->memResult = 0;
     }
-    
+    return -1;
 }
 
 /* execute_WB
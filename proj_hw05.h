@@ -7,10 +7,6 @@ typedef int WORD;
 
 
 
-// TODO: add forwarding into the MEM phase (for sw)
-
-
-
 /* duplicated from Hardware Project 4 */
 typedef struct InstructionFields
 {
@@ -36,19 +32,17 @@ typedef struct InstructionFields
 
 
 
+/* The pipeline registers are stored compactly: register numbers are
+ * bytes, and all of the 1-bit (and 2- or 3-bit) control signals are
+ * bitfields which share a single word.  A full set of ID/EX, EX/MEM and
+ * MEM/WB fits in one cache line.
+ */
+
 typedef struct ID_EX
 {
 	// these are the register *NUMBERS* (5 bits each), which
 	// were mapped directly from the instruction fields.
-	int rs,rt,rd;
-
-	// these are the two register *VALUES*, which were read from the
-	// register file.
-	WORD rsVal, rtVal;
-
-
-	// save the immediate fields for use in the EX phase
-	int imm16, imm32;
+	unsigned char rs,rt,rd;
 
 
 	// these are control bits, which were generated based on the
@@ -58,20 +52,31 @@ typedef struct ID_EX
 	// Note that we still have the 3 'extra' fields, for you to use
 	// however you wish.
 
-	int ALUsrc;
+	unsigned char ALUsrc   : 2;
+	unsigned char memRead  : 1;
+	unsigned char memWrite : 1;
+	unsigned char memToReg : 1;
+	unsigned char regDst   : 1;
+	unsigned char regWrite : 1;
+
 	struct {
-		int bNegate;
-		int op;
+		unsigned char bNegate : 1;
+		unsigned char op      : 3;
 	} ALU;
 
-	int memRead;
-	int memWrite;
-	int memToReg;
+	unsigned char extra1 : 1;
+	unsigned char extra2 : 1;
+	unsigned char extra3 : 1;
 
-	int regDst;
-	int regWrite;
 
-	WORD extra1, extra2, extra3;
+	// save the immediate fields for use in the EX phase
+	unsigned short imm16;
+	WORD           imm32;
+
+
+	// these are the two register *VALUES*, which were read from the
+	// register file.
+	WORD rsVal, rtVal;
 } ID_EX;
 
 
@@ -84,16 +89,19 @@ typedef struct EX_MEM
 	// register, which is now the (5 bit) 'destReg' field.
 
 	WORD rtVal;      // useful for SW
+	WORD aluResult;
 
-	int memRead, memWrite, memToReg;      // 1 bit each
+	unsigned char writeReg;        // 5 bits
 
-	int writeReg;   // 5 bits
-	int regWrite;   // 1 bit
-
-	WORD aluResult;
+	unsigned char memRead  : 1;
+	unsigned char memWrite : 1;
+	unsigned char memToReg : 1;
+	unsigned char regWrite : 1;
 
 	// If you need extra fields, I have them available for you...
-	WORD extra1, extra2, extra3;
+	unsigned char extra1 : 1;
+	unsigned char extra2 : 1;
+	unsigned char extra3 : 1;
 } EX_MEM;
 
 
@@ -103,14 +111,17 @@ typedef struct MEM_WB
 	// in the official MIPS design, we carry the ALUresult and MEMresult
 	// into the WB phase - and then we use memToReg in that phase.  Do
 	// the same in your code.
-	int  memToReg;
 	WORD aluResult;
 	WORD memResult;
 
-	int writeReg;    // 5 bits
-	int regWrite;    // 1 bit
+	unsigned char writeReg;        // 5 bits
+
+	unsigned char memToReg : 1;
+	unsigned char regWrite : 1;
 
-	WORD extra1, extra2, extra3;
+	unsigned char extra1 : 1;
+	unsigned char extra2 : 1;
+	unsigned char extra3 : 1;
 } MEM_WB;
 
 
@@ -142,15 +153,37 @@ typedef struct MEM_WB
  * 1 to indicate "ERROR".  (This is the equivalent of the 'err' field from
  * Project 9.)
  *
+ * The MEM phase also returns a value: the index (into mem[]) of the word
+ * that it wrote, or -1 if it did not write memory.  This lets the caller
+ * see what changed without comparing all of memory.
+ *
  * The rest of the phases have no ability to report an error; they simply
  * must do their work.
  */
 
 void extract_instructionFields(WORD instruction, InstructionFields *fieldsOut);
 
-int IDtoIF_get_stall(InstructionFields *fields, ID_EX *old_idex);
+/* the hazard unit: whether the instruction in ID has to stall, and why.
+ * It knows which registers each instruction reads, and where it needs
+ * them, so it only stalls when forwarding can't deliver a value in time.
+ * IDtoIF_get_stall() is the same check against EX alone.
+ */
+#define HAZARD_NONE      0
+#define HAZARD_LOAD_USE  1     // an ALU input is being loaded by the LW in EX
+#define HAZARD_BRANCH    2     // a branch compares a value that is still in
+                               // EX, or being loaded in MEM
+
+int IDtoIF_get_hazard(InstructionFields *fields, ID_EX *old_idex, EX_MEM *old_exMem);
+int IDtoIF_get_stall (InstructionFields *fields, ID_EX *old_idex);
+
 int IDtoIF_get_branchControl(InstructionFields *fields, WORD rsVal, WORD rtVal);
 
+/* beq and bne compare their registers in ID.  Unless the hazard unit
+ * holds them, ID_getBranchOperand() gives the newest value, forwarding an
+ * ALU result from EX/MEM; pass the results to IDtoIF_get_branchControl().
+ */
+WORD ID_getBranchOperand(int reg, WORD regVal, EX_MEM *old_exMem);
+
 WORD calc_branchAddr(WORD pcPlus4, InstructionFields *fields);
 WORD calc_jumpAddr  (WORD pcPlus4, InstructionFields *fields);
 
@@ -159,13 +192,37 @@ int execute_ID(int IDstall,
                WORD rsVal, WORD rtVal,
                ID_EX *new_idex);
 
+/* the forwarding unit: where the newest value of register 'reg' comes
+ * from, for an instruction in EX.  ($zero is never forwarded.)  The
+ * EX_getALUinput*() functions use this; the simulator also uses it for
+ * tracing and statistics.
+ */
+#define FWD_NONE   0     // the value read from the register file in ID
+#define FWD_EXMEM  1
+#define FWD_MEMWB  2
+
+int EX_getForwardSource(int reg, EX_MEM *old_exMem, MEM_WB *old_memWb);
+
+/* 'regVal' (read in ID), or the value forwarded from EX/MEM or MEM/WB;
+ * from MEM/WB, that is memResult for a LW, and aluResult otherwise.
+ */
+WORD EX_getForwardedValue(int reg, WORD regVal, EX_MEM *old_exMem, MEM_WB *old_memWb);
+
 WORD EX_getALUinput1(ID_EX *in, EX_MEM *old_exMem, MEM_WB *old_memWb);
 WORD EX_getALUinput2(ID_EX *in, EX_MEM *old_exMem, MEM_WB *old_memWb);
 
+/* forwarding for the data of a SW.  execute_EX() copies rtVal as it was
+ * read in ID; the simulator replaces it with EX_getStoreData(), and then,
+ * in MEM, with MEM_getStoreData() - which covers a LW right in front of
+ * the SW, whose value doesn't exist until the SW is in MEM.
+ */
+WORD EX_getStoreData(ID_EX *in, EX_MEM *old_exMem, MEM_WB *old_memWb);
+WORD MEM_getStoreData(EX_MEM *in, MEM_WB *old_memWb);
+
 void execute_EX(ID_EX *in, WORD input1, WORD input2,
                 EX_MEM *new_exMem);
 
-void execute_MEM(EX_MEM *in, WORD *mem, MEM_WB *new_memwb);
+int  execute_MEM(EX_MEM *in, WORD *mem, MEM_WB *new_memwb);
 
 void execute_WB (MEM_WB *in, WORD *regs);
 
@@ -0,0 +1,114 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <memory.h>
+#include <string.h>
+
+#include "proj_hw05.h"
+#include "proj_hw05_bench.h"
+#include "proj_hw05_threaded.h"
+
+
+
+/* translates a benchmark kernel from proj_hw05_bench.c to C, with
+ * TranslateToC(), for the host compiler to build along with the rest of
+ * the simulator.
+ *
+ * Usage: proj_hw05_aotc [-m] <kernel> <reps> <output.c> [function name]
+ *
+ * The function is called aot_<kernel> unless it is named.  '-m' adds a
+ * main() which builds the same program (for its data and registers),
+ * runs the translation from the start, and checks $v1, so that the file
+ * is a complete program:
+ *     gcc -O2 -o kernel output.c proj_hw05.c proj_hw05_test_commonCode.c ... proj_hw05_bench.c
+ */
+
+
+
+static void write_main(FILE *out, const char *funcName, const char *kernel, int reps)
+{
+	fprintf(out, "\n\n\n");
+	fprintf(out, "#include <stdlib.h>\n");
+	fprintf(out, "#include \"proj_hw05_bench.h\"\n\n");
+	fprintf(out, "int main()\n");
+	fprintf(out, "{\n");
+	fprintf(out, "\tBenchProgram *prog = malloc(sizeof(BenchProgram));\n");
+	fprintf(out, "\tif (prog == NULL || Bench_build(Bench_find(\"%s\"), %d, prog) != 0)\n", kernel, reps);
+	fprintf(out, "\t\treturn 1;\n\n");
+	fprintf(out, "\t%s(prog->regs, prog->dataMemory, BENCH_CODE_OFFSET);\n\n", funcName);
+	fprintf(out, "\tint ok = (prog->regs[V_REG(1)] == prog->expected);\n");
+	fprintf(out, "\tif (!ok)\n");
+	fprintf(out, "\t\tprintf(\"ERROR: $v1=0x%%08x, expected 0x%%08x\\n\", prog->regs[V_REG(1)], prog->expected);\n");
+	fprintf(out, "\tfree(prog);\n");
+	fprintf(out, "\treturn ok ? 0 : 1;\n");
+	fprintf(out, "}\n");
+}
+
+
+
+int main(int argc, char **argv)
+{
+	int withMain = 0;
+	int argi = 1;
+
+	if (argi < argc && strcmp(argv[argi], "-m") == 0)
+	{
+		withMain = 1;
+		argi++;
+	}
+
+	if (argc - argi < 3 || argc - argi > 4)
+	{
+		printf("Usage: %s [-m] <kernel> <reps> <output.c> [function name]\n", argv[0]);
+		return 1;
+	}
+
+	const BenchKernel *kernel = Bench_find(argv[argi]);
+	if (kernel == NULL)
+	{
+		printf("ERROR: There is no kernel named '%s'.\n", argv[argi]);
+		return 1;
+	}
+
+	int reps = atoi(argv[argi+1]);
+	if (reps < 1)
+	{
+		printf("ERROR: Invalid number of reps '%s'.\n", argv[argi+1]);
+		return 1;
+	}
+
+	char funcName[64];
+	if (argc - argi == 4)
+		snprintf(funcName, sizeof(funcName), "%s", argv[argi+3]);
+	else
+		snprintf(funcName, sizeof(funcName), "aot_%s", kernel->name);
+
+	BenchProgram *prog = malloc(sizeof(BenchProgram));
+	if (prog == NULL || Bench_build(kernel, reps, prog) != 0)
+	{
+		free(prog);
+		return 1;
+	}
+
+	FILE *out = fopen(argv[argi+2], "w");
+	if (out == NULL)
+	{
+		printf("ERROR: Could not open '%s' for writing.\n", argv[argi+2]);
+		free(prog);
+		return 1;
+	}
+
+	// only the words that the program uses: the rest can't be reached
+	int rc = TranslateToC(out, funcName, prog->instMemory, prog->instCount,
+	                      BENCH_CODE_OFFSET);
+	if (rc == 0 && withMain)
+		write_main(out, funcName, kernel->name, reps);
+
+	if (fclose(out) != 0 && rc == 0)
+	{
+		printf("ERROR: Could not write '%s'.\n", argv[argi+2]);
+		rc = -1;
+	}
+
+	free(prog);
+	return (rc == 0) ? 0 : 1;
+}
@@ -0,0 +1,205 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "proj_hw05_batch.h"
+
+
+
+/* each worker's share of the jobs is the range [lo,hi) of job indices,
+ * packed into one word so that it can be updated with a single CAS: the
+ * owner takes jobs from 'lo', and thieves take them from 'hi'.
+ */
+#define RANGE(lo,hi)    (((uint64_t)(hi) << 32) | (uint32_t)(lo))
+#define RANGE_LO(r)     ((int)((r) & 0xffffffff))
+#define RANGE_HI(r)     ((int)((r) >> 32))
+
+typedef struct BatchPool BatchPool;
+
+typedef struct BatchWorker
+{
+	_Alignas(64) _Atomic uint64_t range;
+
+	BatchPool *pool;
+	int        id;
+	pthread_t  thread;
+	long long  steals;
+} BatchWorker;
+
+struct BatchPool
+{
+	BatchJob    *jobs;
+	BatchWorker *workers;
+	int          workerCount;
+};
+
+
+
+// the owner's end: takes the first job of its range
+static int range_take(BatchWorker *w, int *job)
+{
+	uint64_t r = atomic_load_explicit(&w->range, memory_order_acquire);
+
+	while (RANGE_LO(r) < RANGE_HI(r))
+	{
+		if (atomic_compare_exchange_weak_explicit(&w->range, &r,
+		                                          RANGE(RANGE_LO(r)+1, RANGE_HI(r)),
+		                                          memory_order_acq_rel,
+		                                          memory_order_acquire))
+		{
+			*job = RANGE_LO(r);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+
+// a thief's end: takes the second half of the victim's range
+static int range_steal(BatchWorker *victim, int *lo, int *hi)
+{
+	uint64_t r = atomic_load_explicit(&victim->range, memory_order_acquire);
+
+	while (RANGE_LO(r) < RANGE_HI(r))
+	{
+		int count = RANGE_HI(r) - RANGE_LO(r);
+		int split = RANGE_HI(r) - (count+1)/2;
+
+		if (atomic_compare_exchange_weak_explicit(&victim->range, &r,
+		                                          RANGE(RANGE_LO(r), split),
+		                                          memory_order_acq_rel,
+		                                          memory_order_acquire))
+		{
+			*lo = split;
+			*hi = RANGE_HI(r);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+
+
+static void batch_runJob(BatchJob *job)
+{
+	MachineState *m = &job->m;
+
+	job->output    = NULL;
+	job->outputLen = 0;
+
+	m->out = open_memstream(&job->output, &job->outputLen);
+	if (m->out == NULL)
+	{
+		printf("RunBatch(): Could not capture the output of job '%s'; it goes to stdout.\n",
+		       job->name);
+	}
+
+	ExecMachine(m, job->maxCycles);
+
+	if (m->out != NULL)
+		fclose(m->out);
+	m->out = NULL;
+
+	FreeMachine(m);
+}
+
+
+
+static void *batch_workerThread(void *arg)
+{
+	BatchWorker *w    = arg;
+	BatchPool   *pool = w->pool;
+
+	while (1)
+	{
+		int job;
+		while (range_take(w, &job))
+			batch_runJob(&pool->jobs[job]);
+
+		/* out of work: look for a victim.  Jobs never create more
+		 * jobs, so once every range is empty, we are done.
+		 */
+		int lo, hi, i, found = 0;
+		for (i=1; i<pool->workerCount && !found; i++)
+		{
+			BatchWorker *victim = &pool->workers[(w->id + i) % pool->workerCount];
+			found = range_steal(victim, &lo, &hi);
+		}
+
+		if (!found)
+			break;
+
+		w->steals++;
+		atomic_store_explicit(&w->range, RANGE(lo,hi), memory_order_release);
+	}
+
+	return NULL;
+}
+
+
+
+int RunBatch(BatchJob *jobs, int jobCount, int threads, BatchStats *stats)
+{
+	if (threads <= 0)
+		threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	if (threads <= 0)
+		threads = 1;
+	if (threads > jobCount)
+		threads = jobCount > 0 ? jobCount : 1;
+
+	BatchPool pool;
+	pool.jobs        = jobs;
+	pool.workerCount = threads;
+	pool.workers     = aligned_alloc(64, threads * sizeof(BatchWorker));
+	if (pool.workers == NULL)
+	{
+		printf("RunBatch(): Out of memory.\n");
+		return -1;
+	}
+
+	// equal shares, in order
+	int i;
+	for (i=0; i<threads; i++)
+	{
+		BatchWorker *w = &pool.workers[i];
+
+		atomic_init(&w->range, RANGE((long long)jobCount* i   /threads,
+		                             (long long)jobCount*(i+1)/threads));
+		w->pool   = &pool;
+		w->id     = i;
+		w->steals = 0;
+	}
+
+	/* the calling thread is worker 0; if a thread can't be started,
+	 * its share is stolen by the others.
+	 */
+	int started;
+	for (started=1; started<threads; started++)
+	{
+		BatchWorker *w = &pool.workers[started];
+		if (pthread_create(&w->thread, NULL, batch_workerThread, w) != 0)
+			break;
+	}
+
+	batch_workerThread(&pool.workers[0]);
+
+	long long steals = pool.workers[0].steals;
+	for (i=1; i<started; i++)
+	{
+		pthread_join(pool.workers[i].thread, NULL);
+		steals += pool.workers[i].steals;
+	}
+
+	if (stats != NULL)
+	{
+		stats->threads = started;
+		stats->steals  = steals;
+	}
+
+	free(pool.workers);
+	return 0;
+}
+
@@ -0,0 +1,51 @@
+#ifndef PROJ_HW05_BATCH_H
+#define PROJ_HW05_BATCH_H
+
+
+#include <stddef.h>
+
+#include "proj_hw05_test_commonCode.h"
+
+
+
+/* runs many independent machines on a pool of threads.
+ *
+ * The caller sets up each job's MachineState (with InitMachine() or
+ * RestoreCheckpoint()); every job must have its own data memory.  Each
+ * job runs until its program ends, or for 'maxCycles' clocks if that is
+ * not negative.  Afterwards the MachineState holds the final state (and
+ * its predecode cache has been freed), and everything that the program
+ * printed is in 'output' - a NUL-terminated buffer that the caller must
+ * free().
+ *
+ * Scheduling: every worker starts with an equal, contiguous share of the
+ * jobs, and runs them in order.  A worker that runs out steals the second
+ * half of the remaining jobs of another worker, so a few long jobs don't
+ * leave the other threads idle.
+ */
+typedef struct BatchJob
+{
+	const char   *name;
+	MachineState  m;
+	long long     maxCycles;
+
+	char         *output;
+	size_t        outputLen;
+} BatchJob;
+
+typedef struct BatchStats
+{
+	int       threads;
+	long long steals;            // successful steals, over all workers
+} BatchStats;
+
+
+/* 'threads' <= 0 means one per online CPU.  Returns 0 on success; prints
+ * a message and returns -1 if the pool can't be started.  'stats' may be
+ * NULL.
+ */
+int RunBatch(BatchJob *jobs, int jobCount, int threads, BatchStats *stats);
+
+
+#endif
+
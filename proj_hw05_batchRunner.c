@@ -0,0 +1,223 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <memory.h>
+#include <string.h>
+#include <time.h>
+
+#include "proj_hw05.h"
+#include "proj_hw05_test_commonCode.h"
+#include "proj_hw05_checkpoint.h"
+#include "proj_hw05_bench.h"
+#include "proj_hw05_batch.h"
+
+
+
+/* runs every job listed in a manifest file, in one process, on a pool of
+ * threads (see proj_hw05_batch.h).  Each line of the manifest is one job:
+ *
+ *     bench <kernel> <reps> [maxCycles]     a kernel from proj_hw05_bench.c
+ *     ckpt  <path>          [maxCycles]     a saved checkpoint
+ *
+ * Blank lines, and lines starting with '#', are ignored.
+ *
+ * Usage: proj_hw05_batchRunner [-j <threads>] <manifest>
+ *
+ * Once every job has finished, the output of each one is printed, in the
+ * order of the manifest, followed by a summary.
+ */
+
+
+
+typedef struct JobSource
+{
+	char         *name;
+	BenchProgram *prog;          // one of these two
+	Checkpoint    ckpt;
+} JobSource;
+
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+
+/* sets up the job from one line of the manifest.  Returns 1 if the line
+ * is a job, 0 if it is blank, and -1 on error.
+ */
+static int parse_job(char *line, int lineNum, BatchJob *job, JobSource *src)
+{
+	char kind[16], arg[256];
+	long long reps = 0, maxCycles = -1;
+
+	char *p = line + strspn(line, " \t");
+	if (*p == '\0' || *p == '\n' || *p == '#')
+		return 0;
+
+	memset(job, 0, sizeof(*job));
+	memset(src, 0, sizeof(*src));
+
+	if (sscanf(p, "%15s %255s", kind, arg) != 2)
+	{
+		printf("ERROR: line %d of the manifest: expected a job.\n", lineNum);
+		return -1;
+	}
+
+	if (strcmp(kind, "bench") == 0)
+	{
+		if (sscanf(p, "%*s %*s %lld %lld", &reps, &maxCycles) < 1 || reps < 1)
+		{
+			printf("ERROR: line %d of the manifest: 'bench' needs a kernel and a rep count.\n", lineNum);
+			return -1;
+		}
+
+		const BenchKernel *kernel = Bench_find(arg);
+		if (kernel == NULL)
+		{
+			printf("ERROR: line %d of the manifest: there is no kernel named '%s'.\n", lineNum, arg);
+			return -1;
+		}
+
+		src->prog = malloc(sizeof(BenchProgram));
+		if (src->prog == NULL)
+		{
+			printf("ERROR: Out of memory.\n");
+			return -1;
+		}
+		if (Bench_build(kernel, (int)reps, src->prog) != 0)
+			return -1;
+
+		InitMachine(&job->m, src->prog->instMemory, BENCH_CODE_SIZE,
+		            src->prog->regs,
+		            src->prog->dataMemory, BENCH_DATA_SIZE,
+		            BENCH_CODE_OFFSET);
+	}
+	else if (strcmp(kind, "ckpt") == 0)
+	{
+		sscanf(p, "%*s %*s %lld", &maxCycles);
+
+		if (RestoreCheckpoint(arg, &job->m, &src->ckpt) != 0)
+			return -1;
+	}
+	else
+	{
+		printf("ERROR: line %d of the manifest: unknown job type '%s'.\n", lineNum, kind);
+		return -1;
+	}
+
+	char name[300];
+	snprintf(name, sizeof(name), "%s %s", kind, arg);
+	src->name = strdup(name);
+
+	job->name      = src->name;
+	job->maxCycles = maxCycles;
+	return 1;
+}
+
+
+
+int main(int argc, char **argv)
+{
+	int threads = 0;
+
+	int argi = 1;
+	if (argi+1 < argc && strcmp(argv[argi], "-j") == 0)
+	{
+		threads = atoi(argv[argi+1]);
+		argi += 2;
+	}
+
+	if (argi+1 != argc)
+	{
+		printf("Usage: %s [-j <threads>] <manifest>\n", argv[0]);
+		return 1;
+	}
+
+	FILE *fp = fopen(argv[argi], "r");
+	if (fp == NULL)
+	{
+		printf("ERROR: Could not open '%s'.\n", argv[argi]);
+		return 1;
+	}
+
+	BatchJob  *jobs = NULL;
+	JobSource *srcs = NULL;
+	int jobCount = 0, jobMax = 0;
+
+	char line[512];
+	int  lineNum = 0, rc = 0;
+	while (fgets(line, sizeof(line), fp) != NULL)
+	{
+		lineNum++;
+
+		if (jobCount == jobMax)
+		{
+			jobMax = jobMax ? 2*jobMax : 64;
+			jobs = realloc(jobs, jobMax * sizeof(BatchJob));
+			srcs = realloc(srcs, jobMax * sizeof(JobSource));
+			if (jobs == NULL || srcs == NULL)
+			{
+				printf("ERROR: Out of memory.\n");
+				return 1;
+			}
+		}
+
+		int status = parse_job(line, lineNum, &jobs[jobCount], &srcs[jobCount]);
+		if (status < 0)
+		{
+			rc = 1;
+			break;
+		}
+		jobCount += status;
+	}
+	fclose(fp);
+
+	double start = now();
+	BatchStats stats;
+	if (rc == 0 && RunBatch(jobs, jobCount, threads, &stats) != 0)
+		rc = 1;
+	double elapsed = now() - start;
+
+
+	long long totalInsts = 0;
+	int i, halted = 0;
+	for (i=0; i<jobCount; i++)
+	{
+		BatchJob *job = &jobs[i];
+
+		if (rc == 0)
+		{
+			printf("=== job %d: %s: %lld cycles, %lld instructions, %s\n",
+			       i, job->name, job->m.cycles, job->m.perf.retired,
+			       job->m.halted ? "ended" : "out of cycles");
+			if (job->output != NULL)
+				fwrite(job->output, 1, job->outputLen, stdout);
+
+			totalInsts += job->m.perf.retired;
+			halted     += job->m.halted;
+		}
+
+		free(job->output);
+		if (srcs[i].prog != NULL)
+			free(srcs[i].prog);
+		else
+			ReleaseCheckpoint(&srcs[i].ckpt);
+		free(srcs[i].name);
+	}
+
+	if (rc == 0)
+	{
+		printf("=== %d jobs (%d ended), %d threads, %lld steals\n",
+		       jobCount, halted, stats.threads, stats.steals);
+		printf("=== %lld instructions in %.3f sec: %.2f M inst/sec\n",
+		       totalInsts, elapsed, totalInsts / elapsed / 1e6);
+	}
+
+	free(jobs);
+	free(srcs);
+	return rc;
+}
+
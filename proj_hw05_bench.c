@@ -0,0 +1,446 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <memory.h>
+#include <string.h>
+
+#include "proj_hw05.h"
+#include "proj_hw05_test_commonCode.h"
+#include "proj_hw05_bench.h"
+
+
+
+/* The pipeline interlocks on every hazard, so the kernels need no NOPs;
+ * but they are scheduled by hand to avoid the stalls where that is easy.
+ * A stall costs a clock when
+ *     - an instruction uses the result of the LW right in front of it
+ *       (except as the data of a SW), or
+ *     - a branch compares the result of the instruction right in front of
+ *       it (or of a LW, either of the two in front of it).
+ *
+ * There is no multiply, and SLL has the same encoding as NOP, so the
+ * kernels that need to multiply use repeated addition.
+ */
+
+
+
+/* a very small assembler: instructions are emitted in order, "labels" are
+ * just instruction indices, and forward branches are patched once their
+ * target is known.
+ */
+struct BenchAsm
+{
+	WORD *code;
+	int   count;
+	int   max;
+	int   overflow;
+};
+
+static int emit(BenchAsm *a, WORD inst)
+{
+	if (a->count >= a->max)
+	{
+		a->overflow = 1;
+		return a->count;
+	}
+
+	a->code[a->count] = inst;
+	return a->count++;
+}
+
+// the imm16 for a branch, emitted next, to instruction 'target'
+static int branchTo(BenchAsm *a, int target)
+{
+	return target - (a->count+1);
+}
+
+// points the (forward) branch at 'branchIndx' to the next instruction
+static void patch(BenchAsm *a, int branchIndx)
+{
+	if (a->overflow)
+		return;
+
+	WORD imm16 = (a->count - (branchIndx+1)) & 0xffff;
+	a->code[branchIndx] = (a->code[branchIndx] & 0xffff0000) | imm16;
+}
+
+// a J to instruction 'target'
+static WORD jumpTo(int target)
+{
+	return J(((BENCH_CODE_OFFSET + 4*target) >> 2) & 0x3ffffff);
+}
+
+// loads a 32-bit constant
+static void li(BenchAsm *a, int reg, WORD val)
+{
+	if ((int)val >= -32768 && (int)val <= 32767)
+		emit(a, ADDI(reg, REG_ZERO, val));
+	else
+	{
+		emit(a, LUI(reg, val >> 16));
+		emit(a, ORI(reg, reg, val & 0xffff));
+	}
+}
+
+
+/* small, repeatable pseudo-random numbers for the input data.  (WORD is
+ * signed, so the arithmetic that is expected to wrap around is done as
+ * unsigned.)
+ */
+static WORD bench_rand(unsigned *seed)
+{
+	*seed = *seed * 1103515245 + 12345;
+	return (*seed >> 16) & 0x7fff;
+}
+
+
+
+/* memcpy: copies 512 words, two per iteration, and sums them */
+#define MEMCPY_WORDS  512
+#define MEMCPY_SRC    0x1000
+#define MEMCPY_DST    0x2000
+
+static WORD build_memcpy(BenchAsm *a, WORD *data)
+{
+	unsigned seed = 1, sum = 0;
+	int i;
+	for (i=0; i<MEMCPY_WORDS; i++)
+	{
+		data[MEMCPY_SRC/4 + i] = bench_rand(&seed) * 0x10001;
+		sum += data[MEMCPY_SRC/4 + i];
+	}
+
+	li  (a, S_REG(1), MEMCPY_SRC);
+	li  (a, S_REG(2), MEMCPY_DST);
+	li  (a, S_REG(3), MEMCPY_SRC + 4*MEMCPY_WORDS);
+	emit(a, ADDI(V_REG(1), REG_ZERO, 0));
+
+	int loop = emit(a, LW(T_REG(0), S_REG(1), 0));
+	emit(a, LW  (T_REG(1), S_REG(1), 4));
+	emit(a, ADDI(S_REG(1), S_REG(1), 8));
+	emit(a, ADD (V_REG(1), V_REG(1), T_REG(0)));
+	emit(a, SW  (T_REG(0), S_REG(2), 0));
+	emit(a, ADD (V_REG(1), V_REG(1), T_REG(1)));
+	emit(a, SW  (T_REG(1), S_REG(2), 4));
+	emit(a, ADDI(S_REG(2), S_REG(2), 8));
+	emit(a, BNE (S_REG(1), S_REG(3), branchTo(a, loop)));
+
+	return sum;
+}
+
+
+
+/* dot product of two 64-element vectors of small values */
+#define DOT_LEN  64
+#define DOT_A    0x1000
+#define DOT_B    0x1400
+
+static WORD build_dotprod(BenchAsm *a, WORD *data)
+{
+	unsigned seed = 2, sum = 0;
+	int i;
+	for (i=0; i<DOT_LEN; i++)
+	{
+		data[DOT_A/4 + i] = bench_rand(&seed) % 1000;
+		data[DOT_B/4 + i] = bench_rand(&seed) % 16;
+		sum += data[DOT_A/4 + i] * data[DOT_B/4 + i];
+	}
+
+	li  (a, S_REG(1), DOT_A);
+	li  (a, S_REG(2), DOT_B);
+	li  (a, S_REG(3), DOT_A + 4*DOT_LEN);
+	emit(a, ADDI(V_REG(1), REG_ZERO, 0));
+
+	int loop = emit(a, LW(T_REG(0), S_REG(1), 0));
+	emit(a, LW  (T_REG(1), S_REG(2), 0));
+	emit(a, ADDI(S_REG(1), S_REG(1), 4));
+	emit(a, ADDI(S_REG(2), S_REG(2), 4));
+	int skip = emit(a, BEQ(T_REG(1), REG_ZERO, 0));
+
+	// $v1 += $t0 * $t1
+	int mul = emit(a, ADDI(T_REG(1), T_REG(1), -1));
+	emit(a, ADD (V_REG(1), V_REG(1), T_REG(0)));
+	emit(a, BNE (T_REG(1), REG_ZERO, branchTo(a, mul)));
+
+	patch(a, skip);
+	emit(a, BNE (S_REG(1), S_REG(3), branchTo(a, loop)));
+
+	return sum;
+}
+
+
+
+/* insertion sort of 64 words.  The unsorted input is copied in at the
+ * start of every rep.
+ */
+#define ISORT_LEN  64
+#define ISORT_SRC  0x1000
+#define ISORT_ARR  0x2000
+
+static int cmp_word(const void *x, const void *y)
+{
+	int a = *(const int*)x, b = *(const int*)y;
+	return (a > b) - (a < b);
+}
+
+static WORD build_isort(BenchAsm *a, WORD *data)
+{
+	unsigned seed = 3;
+	WORD sorted[ISORT_LEN];
+	int i;
+	for (i=0; i<ISORT_LEN; i++)
+	{
+		data[ISORT_SRC/4 + i] = bench_rand(&seed) - 0x4000;
+		sorted[i] = data[ISORT_SRC/4 + i];
+	}
+	qsort(sorted, ISORT_LEN, sizeof(WORD), cmp_word);
+
+	// copy the input
+	li  (a, S_REG(1), ISORT_SRC);
+	li  (a, S_REG(2), ISORT_ARR);
+	li  (a, S_REG(3), ISORT_SRC + 4*ISORT_LEN);
+
+	int copy = emit(a, LW(T_REG(0), S_REG(1), 0));
+	emit(a, ADDI(S_REG(1), S_REG(1), 4));
+	emit(a, SW  (T_REG(0), S_REG(2), 0));
+	emit(a, ADDI(S_REG(2), S_REG(2), 4));
+	emit(a, BNE (S_REG(1), S_REG(3), branchTo(a, copy)));
+
+	/* $s1 = &arr[0]; $s2 = &arr[i]; $s3 = &arr[LEN]
+	 * $t0 = key; $t1 = &arr[j]; $t2 = arr[j]
+	 */
+	li  (a, S_REG(1), ISORT_ARR);
+	li  (a, S_REG(3), ISORT_ARR + 4*ISORT_LEN);
+	emit(a, ADDI(S_REG(2), S_REG(1), 4));
+
+	int outer = emit(a, LW(T_REG(0), S_REG(2), 0));
+	emit(a, ADDI(T_REG(1), S_REG(2), -4));
+
+	int inner = emit(a, SLT(T_REG(3), T_REG(1), S_REG(1)));
+	int atStart = emit(a, BNE(T_REG(3), REG_ZERO, 0));
+	emit(a, LW  (T_REG(2), T_REG(1), 0));
+	emit(a, SLT (T_REG(3), T_REG(0), T_REG(2)));
+	int inPlace = emit(a, BEQ(T_REG(3), REG_ZERO, 0));
+	emit(a, SW  (T_REG(2), T_REG(1), 4));
+	emit(a, ADDI(T_REG(1), T_REG(1), -4));
+	emit(a, jumpTo(inner));
+
+	patch(a, atStart);
+	patch(a, inPlace);
+	emit(a, ADDI(S_REG(2), S_REG(2), 4));
+	emit(a, SW  (T_REG(0), T_REG(1), 4));
+	emit(a, BNE (S_REG(2), S_REG(3), branchTo(a, outer)));
+
+	// checksum: the smallest, middle and largest values
+	emit(a, LW  (T_REG(0), S_REG(1), 0));
+	emit(a, LW  (T_REG(1), S_REG(1), 4*(ISORT_LEN/2)));
+	emit(a, LW  (T_REG(2), S_REG(1), 4*(ISORT_LEN-1)));
+	emit(a, ADD (V_REG(1), T_REG(0), T_REG(1)));
+	emit(a, ADD (V_REG(1), V_REG(1), T_REG(2)));
+
+	return sorted[0] + sorted[ISORT_LEN/2] + sorted[ISORT_LEN-1];
+}
+
+
+
+/* walks a 256-node linked list, whose nodes are scattered through memory,
+ * and sums the values.  Each node is { value, next }.
+ */
+#define LIST_LEN    256
+#define LIST_NODES  0x1000
+
+static WORD build_listwalk(BenchAsm *a, WORD *data)
+{
+	unsigned seed = 4, sum = 0;
+	int  order[LIST_LEN];
+	int  i;
+
+	// a random order for the nodes
+	for (i=0; i<LIST_LEN; i++)
+		order[i] = i;
+	for (i=LIST_LEN-1; i>0; i--)
+	{
+		int j = bench_rand(&seed) % (i+1);
+		int tmp = order[i]; order[i] = order[j]; order[j] = tmp;
+	}
+
+	for (i=0; i<LIST_LEN; i++)
+	{
+		WORD node = LIST_NODES + 8*order[i];
+		WORD next = (i+1 < LIST_LEN) ? LIST_NODES + 8*order[i+1] : 0;
+
+		data[node/4]   = bench_rand(&seed);
+		data[node/4+1] = next;
+		sum += data[node/4];
+	}
+
+	li  (a, S_REG(1), LIST_NODES + 8*order[0]);
+	emit(a, ADDI(V_REG(1), REG_ZERO, 0));
+
+	int walk = emit(a, LW(T_REG(0), S_REG(1), 0));
+	emit(a, LW  (S_REG(1), S_REG(1), 4));
+	emit(a, ADD (V_REG(1), V_REG(1), T_REG(0)));
+	emit(a, BNE (S_REG(1), REG_ZERO, branchTo(a, walk)));
+
+	return sum;
+}
+
+
+
+/* iterative Fibonacci: 1000 steps (the values wrap around, of course) */
+#define FIB_STEPS  1000
+
+static WORD build_fib(BenchAsm *a, WORD *data)
+{
+	(void)data;
+
+	unsigned x = 0, y = 1;
+	int i;
+	for (i=0; i<FIB_STEPS; i++)
+	{
+		unsigned t = x+y;
+		x = y;
+		y = t;
+	}
+
+	emit(a, ADDI(S_REG(0), REG_ZERO, 0));
+	emit(a, ADDI(S_REG(1), REG_ZERO, 1));
+	li  (a, S_REG(2), FIB_STEPS);
+
+	int loop = emit(a, BEQ(S_REG(2), REG_ZERO, 0));
+	emit(a, ADDI(S_REG(2), S_REG(2), -1));
+	emit(a, ADDU(T_REG(0), S_REG(0), S_REG(1)));
+	emit(a, OR  (S_REG(0), S_REG(1), REG_ZERO));
+	emit(a, OR  (S_REG(1), T_REG(0), REG_ZERO));
+	emit(a, jumpTo(loop));
+
+	patch(a, loop);
+	emit(a, OR  (V_REG(1), S_REG(0), REG_ZERO));
+
+	return x;
+}
+
+
+
+/* C = A*B, for 8x8 matrices of small values; $v1 is the sum of C */
+#define MAT_N  8
+#define MAT_A  0x1000
+#define MAT_B  0x1400
+#define MAT_C  0x1800
+
+static WORD build_matmul(BenchAsm *a, WORD *data)
+{
+	unsigned seed = 5, sum = 0;
+	int i,j,k;
+	for (i=0; i<MAT_N*MAT_N; i++)
+	{
+		data[MAT_A/4 + i] = bench_rand(&seed) % 100;
+		data[MAT_B/4 + i] = bench_rand(&seed) % 8;
+	}
+	for (i=0; i<MAT_N; i++)
+	for (j=0; j<MAT_N; j++)
+	for (k=0; k<MAT_N; k++)
+		sum += data[MAT_A/4 + i*MAT_N+k] * data[MAT_B/4 + k*MAT_N+j];
+
+	/* $s1 = &A[i][0]; $s2 = &B[0][j]; $s3 = &C[i][j]
+	 * $s4 = &A[N][0]; $s5 = &B[0][N]
+	 * $t2 = &A[i][k]; $t3 = &B[k][j]; $t4 = &A[i][N]; $t5 = C[i][j]
+	 */
+	li  (a, S_REG(1), MAT_A);
+	li  (a, S_REG(3), MAT_C);
+	li  (a, S_REG(4), MAT_A + 4*MAT_N*MAT_N);
+	li  (a, S_REG(5), MAT_B + 4*MAT_N);
+	emit(a, ADDI(V_REG(1), REG_ZERO, 0));
+
+	int iloop = emit(a, ADDI(S_REG(2), REG_ZERO, MAT_B));
+	emit(a, ADDI(T_REG(4), S_REG(1), 4*MAT_N));
+
+	int jloop = emit(a, ADDI(T_REG(2), S_REG(1), 0));
+	emit(a, ADDI(T_REG(3), S_REG(2), 0));
+	emit(a, ADDI(T_REG(5), REG_ZERO, 0));
+
+	int kloop = emit(a, LW(T_REG(0), T_REG(2), 0));
+	emit(a, LW  (T_REG(1), T_REG(3), 0));
+	emit(a, ADDI(T_REG(2), T_REG(2), 4));
+	emit(a, ADDI(T_REG(3), T_REG(3), 4*MAT_N));
+	int skip = emit(a, BEQ(T_REG(1), REG_ZERO, 0));
+
+	// $t5 += $t0 * $t1
+	int mul = emit(a, ADDI(T_REG(1), T_REG(1), -1));
+	emit(a, ADD (T_REG(5), T_REG(5), T_REG(0)));
+	emit(a, BNE (T_REG(1), REG_ZERO, branchTo(a, mul)));
+
+	patch(a, skip);
+	emit(a, BNE (T_REG(2), T_REG(4), branchTo(a, kloop)));
+
+	emit(a, ADDI(S_REG(2), S_REG(2), 4));
+	emit(a, SW  (T_REG(5), S_REG(3), 0));
+	emit(a, ADD (V_REG(1), V_REG(1), T_REG(5)));
+	emit(a, ADDI(S_REG(3), S_REG(3), 4));
+	emit(a, BNE (S_REG(2), S_REG(5), branchTo(a, jloop)));
+
+	emit(a, ADDI(S_REG(1), S_REG(1), 4*MAT_N));
+	emit(a, BNE (S_REG(1), S_REG(4), branchTo(a, iloop)));
+
+	return sum;
+}
+
+
+
+const BenchKernel benchKernels[] = {
+	{ "memcpy",   "copy 512 words, and sum them",      2000, build_memcpy   },
+	{ "dotprod",  "dot product of 64-element vectors", 2500, build_dotprod  },
+	{ "isort",    "insertion sort of 64 words",         350, build_isort    },
+	{ "listwalk", "walk a 256-node linked list",       4000, build_listwalk },
+	{ "fib",      "1000 steps of Fibonacci",            800, build_fib      },
+	{ "matmul",   "8x8 matrix multiply",                500, build_matmul   },
+};
+
+const int benchKernelCount = sizeof(benchKernels) / sizeof(benchKernels[0]);
+
+
+
+const BenchKernel *Bench_find(const char *name)
+{
+	int i;
+	for (i=0; i<benchKernelCount; i++)
+		if (strcmp(benchKernels[i].name, name) == 0)
+			return &benchKernels[i];
+	return NULL;
+}
+
+
+
+int Bench_build(const BenchKernel *kernel, int reps, BenchProgram *prog)
+{
+	memset(prog, 0, sizeof(*prog));
+
+	BenchAsm a;
+	a.code     = prog->instMemory;
+	a.count    = 0;
+	a.max      = BENCH_CODE_SIZE;
+	a.overflow = 0;
+
+	// for (rep=reps; rep != 0; rep--) { kernel }
+	li(&a, S_REG(7), reps);
+
+	int rep = a.count;
+	prog->expected = kernel->build(&a, prog->dataMemory);
+
+	emit(&a, ADDI(S_REG(7), S_REG(7), -1));
+	emit(&a, BNE (S_REG(7), REG_ZERO, branchTo(&a, rep)));
+
+	// exit
+	emit(&a, ADDI(V_REG(0), REG_ZERO, 10));
+	emit(&a, SYSCALL());
+
+	if (a.overflow)
+	{
+		printf("Bench_build(): The '%s' program doesn't fit in %d words.\n",
+		       kernel->name, BENCH_CODE_SIZE);
+		return -1;
+	}
+
+	prog->instCount = a.count;
+	return 0;
+}
+
@@ -0,0 +1,65 @@
+#ifndef PROJ_HW05_BENCH_H
+#define PROJ_HW05_BENCH_H
+
+
+#include "proj_hw05.h"
+
+
+
+/* a suite of small benchmark programs, written with the instruction macros
+ * from proj_hw05_test_commonCode.h.  proj_hw05_benchRunner.c runs them and
+ * reports the simulator's speed, and the CPI of each program.
+ *
+ * Every program wraps its kernel in a loop that runs it 'reps' times, so
+ * that the same program can be scaled from a quick test up to a proper
+ * timing run.  When it ends, $v1 holds a checksum of the last rep, which
+ * must equal BenchProgram.expected.
+ */
+
+#define BENCH_CODE_SIZE    (1024)
+#define BENCH_DATA_SIZE    (16*1024)
+#define BENCH_CODE_OFFSET  0x00400000
+
+typedef struct BenchProgram
+{
+	WORD instMemory[BENCH_CODE_SIZE];
+	WORD dataMemory[BENCH_DATA_SIZE];
+	WORD regs[34];
+
+	int  instCount;              // words of instMemory actually used
+	WORD expected;               // $v1 at the end of the program
+} BenchProgram;
+
+
+/* the assembler that the kernels are written with; see proj_hw05_bench.c */
+typedef struct BenchAsm BenchAsm;
+
+typedef struct BenchKernel
+{
+	const char *name;
+	const char *description;
+	int         defaultReps;     // about 5M instructions
+
+	/* emits one rep of the kernel, fills in the data that it needs,
+	 * and returns the expected $v1.
+	 */
+	WORD (*build)(BenchAsm *a, WORD *dataMemory);
+} BenchKernel;
+
+
+extern const BenchKernel benchKernels[];
+extern const int         benchKernelCount;
+
+
+/* returns the kernel with this name, or NULL */
+const BenchKernel *Bench_find(const char *name);
+
+/* assembles the complete program (the kernel, the 'reps' loop around it,
+ * and the exit syscall) into 'prog'.  Returns 0 on success; prints a
+ * message and returns -1 if the program doesn't fit.
+ */
+int Bench_build(const BenchKernel *kernel, int reps, BenchProgram *prog);
+
+
+#endif
+
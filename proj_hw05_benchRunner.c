@@ -0,0 +1,361 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <memory.h>
+#include <string.h>
+#include <time.h>
+
+#include "proj_hw05.h"
+#include "proj_hw05_test_commonCode.h"
+#include "proj_hw05_bench.h"
+#include "proj_hw05_ensemble.h"
+#include "proj_hw05_threaded.h"
+
+
+
+/* runs the benchmark kernels from proj_hw05_bench.c on the pipelined
+ * model, and reports
+ *     - the target's CPI, from the performance counters, and
+ *     - the simulator's speed, in millions of simulated instructions per
+ *       second of host time.
+ * Each kernel is then run again on the functional model, on the threaded
+ * interpreter (with and without the JIT), and on an ensemble of
+ * ENSEMBLE_LANES copies (with their output thrown away), to time them,
+ * and to check that every model gets the right answer.
+ *
+ * Usage: proj_hw05_benchRunner [-s <scale>] [-c] [-t] [-p <predictor>]
+ *                              [kernel ...]
+ *
+ * By default, every kernel runs; '-s' multiplies the number of reps of
+ * each kernel (it may be a fraction).  '-c' gives the pipelined model the
+ * L1 caches below, instead of a perfect memory, and prints their stats.
+ * '-t' does the same for the TLBs below.
+ * '-p' gives it a branch predictor ("nt", "1bit", "2bit" or "gshare"),
+ * with the BTB and penalty below, and prints its stats.
+ */
+
+
+
+static const CacheConfig l1iConfig = { 4096, 2, 32, CACHE_LRU,  1, 1, 10 };
+static const CacheConfig l1dConfig = { 4096, 4, 32, CACHE_PLRU, 1, 1, 10 };
+
+static const TlbConfig itlbConfig = { 8, 8, 20 };
+static const TlbConfig dtlbConfig = { 8, 2, 20 };
+
+static PredictorConfig bpredConfig = { BPRED_NOT_TAKEN, 10, 8, 64, 1 };
+
+
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+
+/* runs ENSEMBLE_LANES copies of the program; returns the time, or a
+ * negative number if any lane got the wrong answer.
+ */
+static double time_ensemble(BenchProgram *prog)
+{
+	WORD (*laneData)[BENCH_DATA_SIZE] = malloc(ENSEMBLE_LANES * sizeof(*laneData));
+	FILE *devnull = fopen("/dev/null", "w");
+	if (laneData == NULL || devnull == NULL)
+	{
+		printf("ERROR: Could not set up the ensemble.\n");
+		free(laneData);
+		if (devnull != NULL)
+			fclose(devnull);
+		return -1;
+	}
+
+	Ensemble e;
+	InitEnsemble(&e, prog->instMemory, BENCH_CODE_SIZE, BENCH_DATA_SIZE,
+	             BENCH_CODE_OFFSET);
+
+	int lane;
+	for (lane=0; lane<ENSEMBLE_LANES; lane++)
+	{
+		memcpy(laneData[lane], prog->dataMemory, sizeof(laneData[lane]));
+		SetEnsembleLane(&e, lane, prog->regs, laneData[lane]);
+		e.out[lane] = devnull;
+	}
+
+	double start = now();
+	RunEnsemble(&e, -1);
+	double elapsed = now() - start;
+
+	for (lane=0; lane<ENSEMBLE_LANES; lane++)
+	{
+		WORD regs[34];
+		GetEnsembleLane(&e, lane, regs);
+		if (regs[V_REG(1)] != prog->expected)
+		{
+			printf("  ERROR: ensemble lane %d $v1=0x%08x, expected 0x%08x\n",
+			       lane, regs[V_REG(1)], prog->expected);
+			elapsed = -1;
+		}
+	}
+
+	FreeEnsemble(&e);
+	fclose(devnull);
+	free(laneData);
+	return elapsed;
+}
+
+
+
+static int run_kernel(const BenchKernel *kernel, double scale,
+                      int useCaches, int useTlbs, int usePredictor,
+                      BenchProgram *prog)
+{
+	int reps = (int)(kernel->defaultReps * scale);
+	if (reps < 1)
+		reps = 1;
+
+	if (Bench_build(kernel, reps, prog) != 0)
+		return 1;
+
+	// the functional models write to memory, so they get their own copies
+	WORD *dataCopy = malloc(sizeof(prog->dataMemory));
+	WORD *thrData  = malloc(sizeof(prog->dataMemory));
+	WORD *jitData  = malloc(sizeof(prog->dataMemory));
+	if (dataCopy == NULL || thrData == NULL || jitData == NULL)
+	{
+		printf("ERROR: Out of memory.\n");
+		return 1;
+	}
+	memcpy(dataCopy, prog->dataMemory, sizeof(prog->dataMemory));
+	memcpy(thrData,  prog->dataMemory, sizeof(prog->dataMemory));
+	memcpy(jitData,  prog->dataMemory, sizeof(prog->dataMemory));
+
+	WORD funcRegs[34], thrRegs[34], jitRegs[34];
+	memcpy(funcRegs, prog->regs, sizeof(funcRegs));
+	memcpy(thrRegs,  prog->regs, sizeof(thrRegs));
+	memcpy(jitRegs,  prog->regs, sizeof(jitRegs));
+
+
+	printf("%s: %s, %d reps\n", kernel->name, kernel->description, reps);
+
+	MachineState m;
+	InitMachine(&m, prog->instMemory, BENCH_CODE_SIZE, prog->regs,
+	            prog->dataMemory, BENCH_DATA_SIZE, BENCH_CODE_OFFSET);
+
+	Cache icache, dcache;
+	if (useCaches)
+	{
+		Cache_init(&icache, &l1iConfig);
+		Cache_init(&dcache, &l1dConfig);
+		m.icache = &icache;
+		m.dcache = &dcache;
+	}
+
+	Tlb itlb, dtlb;
+	if (useTlbs)
+	{
+		Tlb_init(&itlb, &itlbConfig);
+		Tlb_init(&dtlb, &dtlbConfig);
+		m.itlb = &itlb;
+		m.dtlb = &dtlb;
+	}
+
+	Predictor bpred;
+	if (usePredictor)
+	{
+		Predictor_init(&bpred, &bpredConfig);
+		m.bpred = &bpred;
+	}
+
+	double start = now();
+	RunMachine(&m);
+	double pipeTime = now() - start;
+
+	FreeMachine(&m);
+
+	start = now();
+	ExecFunctional(prog->instMemory, BENCH_CODE_SIZE, funcRegs,
+	               dataCopy, BENCH_DATA_SIZE, BENCH_CODE_OFFSET);
+	double funcTime = now() - start;
+
+	start = now();
+	ExecThreaded(prog->instMemory, BENCH_CODE_SIZE, thrRegs,
+	             thrData, BENCH_DATA_SIZE, BENCH_CODE_OFFSET);
+	double thrTime = now() - start;
+
+	start = now();
+	ExecJIT(prog->instMemory, BENCH_CODE_SIZE, jitRegs,
+	        jitData, BENCH_DATA_SIZE, BENCH_CODE_OFFSET);
+	double jitTime = now() - start;
+
+	free(dataCopy);
+	free(thrData);
+	free(jitData);
+
+
+	/* the functional model doesn't count instructions, but it runs the
+	 * same ones (plus the couple that were still in the pipeline when
+	 * the program ended).
+	 */
+	double insts = (double)m.perf.retired;
+
+	printf("  %lld instructions, %lld cycles, CPI %.3f\n",
+	       m.perf.retired, m.perf.cycles,
+	       (double)m.perf.cycles / m.perf.retired);
+	printf("  stalls: %lld load-use, %lld ID operand\n",
+	       m.perf.stalls[STALL_LOAD_USE], m.perf.stalls[STALL_ID_OPERAND]);
+	printf("  pipelined:  %8.2f M inst/sec  (%.3f sec)\n",
+	       insts / pipeTime / 1e6, pipeTime);
+	printf("  functional: %8.2f M inst/sec  (%.3f sec)\n",
+	       insts / funcTime / 1e6, funcTime);
+	printf("  threaded:   %8.2f M inst/sec  (%.3f sec)\n",
+	       insts / thrTime / 1e6, thrTime);
+	printf("  JIT:        %8.2f M inst/sec  (%.3f sec)\n",
+	       insts / jitTime / 1e6, jitTime);
+
+	if (useCaches)
+	{
+		printf("  stalls: %lld I-cache, %lld D-cache\n",
+		       m.perf.stalls[STALL_ICACHE], m.perf.stalls[STALL_DCACHE]);
+		PrintCacheStats(stdout, "L1 I-cache", &icache);
+		PrintCacheStats(stdout, "L1 D-cache", &dcache);
+		Cache_free(&icache);
+		Cache_free(&dcache);
+	}
+
+	if (useTlbs)
+	{
+		printf("  stalls: %lld I-TLB, %lld D-TLB\n",
+		       m.perf.stalls[STALL_ITLB], m.perf.stalls[STALL_DTLB]);
+		PrintTlbStats(stdout, "I-TLB", &itlb);
+		PrintTlbStats(stdout, "D-TLB", &dtlb);
+		Tlb_free(&itlb);
+		Tlb_free(&dtlb);
+	}
+
+	if (usePredictor)
+	{
+		printf("  stalls: %lld mispredict\n", m.perf.stalls[STALL_MISPREDICT]);
+		PrintPredictorStats(stdout, &bpred, 5);
+		Predictor_free(&bpred);
+	}
+
+	int rc = 0;
+
+	// the program has run, so rebuild it with the original data
+	Bench_build(kernel, reps, prog);
+	double ensTime = time_ensemble(prog);
+	if (ensTime < 0)
+		rc = 1;
+	else
+		printf("  ensemble:   %8.2f M inst/sec  (%.3f sec, %d lanes)\n",
+		       insts * ENSEMBLE_LANES / ensTime / 1e6, ensTime, ENSEMBLE_LANES);
+
+	if (m.regs[V_REG(1)] != prog->expected)
+	{
+		printf("  ERROR: pipelined $v1=0x%08x, expected 0x%08x\n",
+		       m.regs[V_REG(1)], prog->expected);
+		rc = 1;
+	}
+	if (funcRegs[V_REG(1)] != prog->expected)
+	{
+		printf("  ERROR: functional $v1=0x%08x, expected 0x%08x\n",
+		       funcRegs[V_REG(1)], prog->expected);
+		rc = 1;
+	}
+	if (thrRegs[V_REG(1)] != prog->expected)
+	{
+		printf("  ERROR: threaded $v1=0x%08x, expected 0x%08x\n",
+		       thrRegs[V_REG(1)], prog->expected);
+		rc = 1;
+	}
+	if (jitRegs[V_REG(1)] != prog->expected)
+	{
+		printf("  ERROR: JIT $v1=0x%08x, expected 0x%08x\n",
+		       jitRegs[V_REG(1)], prog->expected);
+		rc = 1;
+	}
+
+	printf("\n");
+	return rc;
+}
+
+
+
+int main(int argc, char **argv)
+{
+	double scale = 1.0;
+	int    useCaches = 0, useTlbs = 0, usePredictor = 0;
+
+	int argi = 1;
+	while (argi < argc && argv[argi][0] == '-')
+	{
+		if (argi+1 < argc && strcmp(argv[argi], "-s") == 0)
+		{
+			scale = atof(argv[argi+1]);
+			argi += 2;
+		}
+		else if (strcmp(argv[argi], "-c") == 0)
+		{
+			useCaches = 1;
+			argi++;
+		}
+		else if (strcmp(argv[argi], "-t") == 0)
+		{
+			useTlbs = 1;
+			argi++;
+		}
+		else if (argi+1 < argc && strcmp(argv[argi], "-p") == 0 &&
+		         (bpredConfig.type = Predictor_parse(argv[argi+1])) >= 0)
+		{
+			usePredictor = 1;
+			argi += 2;
+		}
+		else
+		{
+			scale = 0;
+			break;
+		}
+	}
+
+	if (scale <= 0)
+	{
+		printf("Usage: %s [-s <scale>] [-c] [-t] [-p nt|1bit|2bit|gshare] [kernel ...]\n", argv[0]);
+		return 1;
+	}
+
+	BenchProgram *prog = malloc(sizeof(BenchProgram));
+	if (prog == NULL)
+	{
+		printf("ERROR: Out of memory.\n");
+		return 1;
+	}
+
+	int rc = 0;
+	int i;
+
+	if (argi == argc)
+	{
+		for (i=0; i<benchKernelCount; i++)
+			rc |= run_kernel(&benchKernels[i], scale, useCaches, useTlbs, usePredictor, prog);
+	}
+	else
+	{
+		for (i=argi; i<argc; i++)
+		{
+			const BenchKernel *kernel = Bench_find(argv[i]);
+			if (kernel == NULL)
+			{
+				printf("ERROR: There is no kernel named '%s'.\n", argv[i]);
+				rc = 1;
+				continue;
+			}
+
+			rc |= run_kernel(kernel, scale, useCaches, useTlbs, usePredictor, prog);
+		}
+	}
+
+	free(prog);
+	return rc;
+}
+
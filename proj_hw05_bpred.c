@@ -0,0 +1,296 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <memory.h>
+#include <string.h>
+
+#include "proj_hw05_bpred.h"
+
+
+
+static int isPow2(int x)
+{
+	return x > 0 && (x & (x-1)) == 0;
+}
+
+
+
+int Predictor_init(Predictor *p, const PredictorConfig *config)
+{
+	memset(p, 0, sizeof(*p));
+
+	if (config->type < BPRED_NOT_TAKEN || config->type > BPRED_GSHARE ||
+	    config->tableBits   < 0 || config->tableBits > 24           ||
+	    config->historyBits < 0 || config->historyBits > config->tableBits ||
+	    (config->btbEntries != 0 && !isPow2(config->btbEntries))  ||
+	    config->penalty < 0 || config->penalty > 1000)
+	{
+		printf("Predictor_init(): Invalid predictor configuration.\n");
+		return -1;
+	}
+
+	p->config    = *config;
+	p->tableMask = (1u << config->tableBits) - 1;
+
+	p->table = malloc((size_t)1 << config->tableBits);
+	if (p->table == NULL)
+		goto NO_MEMORY;
+
+	// the 2-bit counters start at "weakly not taken"
+	memset(p->table, (config->type == BPRED_ONE_BIT) ? 0 : 1,
+	       (size_t)1 << config->tableBits);
+
+	if (config->btbEntries > 0)
+	{
+		p->btbTags    = malloc(config->btbEntries * sizeof(WORD));
+		p->btbTargets = calloc(config->btbEntries,  sizeof(WORD));
+		if (p->btbTags == NULL || p->btbTargets == NULL)
+			goto NO_MEMORY;
+
+		memset(p->btbTags, 0xff, config->btbEntries * sizeof(WORD));
+	}
+
+	p->siteCapacity = 64;
+	p->sites = calloc(p->siteCapacity, sizeof(BranchSite));
+	if (p->sites == NULL)
+		goto NO_MEMORY;
+
+	return 0;
+
+NO_MEMORY:
+	printf("Predictor_init(): Out of memory.\n");
+	Predictor_free(p);
+	return -1;
+}
+
+
+
+void Predictor_free(Predictor *p)
+{
+	free(p->table);
+	free(p->btbTags);
+	free(p->btbTargets);
+	free(p->sites);
+
+	p->table      = NULL;
+	p->btbTags    = NULL;
+	p->btbTargets = NULL;
+	p->sites      = NULL;
+}
+
+
+
+int Predictor_parse(const char *name)
+{
+	if (strcmp(name, "nt")     == 0) return BPRED_NOT_TAKEN;
+	if (strcmp(name, "1bit")   == 0) return BPRED_ONE_BIT;
+	if (strcmp(name, "2bit")   == 0) return BPRED_TWO_BIT;
+	if (strcmp(name, "gshare") == 0) return BPRED_GSHARE;
+	return -1;
+}
+
+
+
+/* the per-PC table: open addressing, kept at most half full.  Entries
+ * with executed == 0 are empty.
+ */
+static unsigned site_hash(WORD pc)
+{
+	return ((unsigned)pc >> 2) * 2654435761u;
+}
+
+static BranchSite *site_find(Predictor *p, WORD pc)
+{
+	unsigned mask = p->siteCapacity-1;
+	unsigned i    = site_hash(pc) & mask;
+
+	while (p->sites[i].executed != 0 && p->sites[i].pc != pc)
+		i = (i+1) & mask;
+	return &p->sites[i];
+}
+
+static BranchSite *site_get(Predictor *p, WORD pc, int isBranch)
+{
+	BranchSite *site = site_find(p, pc);
+	if (site->executed != 0)
+		return site;
+
+	if (2*(p->siteCount+1) > p->siteCapacity)
+	{
+		BranchSite *old = p->sites;
+		int oldCapacity = p->siteCapacity;
+
+		BranchSite *grown = calloc(2*oldCapacity, sizeof(BranchSite));
+		if (grown == NULL)
+			return NULL;
+
+		p->sites        = grown;
+		p->siteCapacity = 2*oldCapacity;
+
+		int i;
+		for (i=0; i<oldCapacity; i++)
+			if (old[i].executed != 0)
+				*site_find(p, old[i].pc) = old[i];
+		free(old);
+
+		site = site_find(p, pc);
+	}
+
+	p->siteCount++;
+	site->pc       = pc;
+	site->isBranch = isBranch;
+	return site;
+}
+
+
+
+int Predictor_resolve(Predictor *p, WORD pc, int isBranch, int taken, WORD nextPC)
+{
+	PredictorConfig *config = &p->config;
+	unsigned pcWord = (unsigned)pc >> 2;
+
+	// the direction
+	unsigned char *counter = NULL;
+	int predictTaken = 1;
+
+	if (isBranch)
+	{
+		unsigned indx = pcWord;
+		if (config->type == BPRED_GSHARE)
+			indx ^= p->history & ((1u << config->historyBits) - 1);
+		counter = &p->table[indx & p->tableMask];
+
+		if (config->type == BPRED_NOT_TAKEN)
+			predictTaken = 0;
+		else if (config->type == BPRED_ONE_BIT)
+			predictTaken = *counter;
+		else
+			predictTaken = (*counter >= 2);
+	}
+
+	// the target
+	int wrong;
+	if (config->btbEntries > 0)
+	{
+		int  slot   = pcWord & (config->btbEntries-1);
+		int  btbHit = (p->btbTags[slot] == pc);
+		WORD guess  = pc+4;
+
+		p->stats.btbLookups++;
+		p->stats.btbHits += btbHit;
+
+		if (btbHit && predictTaken)
+			guess = p->btbTargets[slot];
+		wrong = (guess != nextPC);
+
+		if (taken)
+		{
+			p->btbTags   [slot] = pc;
+			p->btbTargets[slot] = nextPC;
+		}
+	}
+	else
+		wrong = (predictTaken != taken);
+
+	// train
+	if (isBranch)
+	{
+		if (config->type == BPRED_ONE_BIT)
+			*counter = taken;
+		else if (taken && *counter < 3)
+			(*counter)++;
+		else if (!taken && *counter > 0)
+			(*counter)--;
+
+		p->history = (p->history << 1) | taken;
+	}
+
+	if (isBranch)
+	{
+		p->stats.branches++;
+		p->stats.branchMispredicts += wrong;
+	}
+	else
+	{
+		p->stats.jumps++;
+		p->stats.jumpMispredicts += wrong;
+	}
+
+	BranchSite *site = site_get(p, pc, isBranch);
+	if (site != NULL)
+	{
+		site->executed++;
+		site->taken       += taken;
+		site->mispredicts += wrong;
+	}
+
+	return wrong ? config->penalty : 0;
+}
+
+
+
+static int site_compare(const void *a, const void *b)
+{
+	const BranchSite *x = a, *y = b;
+
+	if (x->mispredicts != y->mispredicts)
+		return (x->mispredicts < y->mispredicts) ? 1 : -1;
+	if (x->pc != y->pc)
+		return ((unsigned)x->pc < (unsigned)y->pc) ? -1 : 1;
+	return 0;
+}
+
+static double percent(long long part, long long whole)
+{
+	return whole > 0 ? 100.0 * part / whole : 0;
+}
+
+void PrintPredictorStats(FILE *fp, Predictor *p, int maxSites)
+{
+	static const char *names[] = { "static not-taken", "1-bit", "2-bit bimodal", "gshare" };
+
+	PredictorConfig *config = &p->config;
+	PredictorStats  *st     = &p->stats;
+
+	fprintf(fp, "--- branch predictor: %s, %d-entry table", names[config->type], 1 << config->tableBits);
+	if (config->type == BPRED_GSHARE)
+		fprintf(fp, ", %d bits of history", config->historyBits);
+	if (config->btbEntries > 0)
+		fprintf(fp, ", %d-entry BTB", config->btbEntries);
+	fprintf(fp, ", %d-clock penalty\n", config->penalty);
+
+	fprintf(fp, "  branches = %lld, %lld mispredicted (%.2f%% accuracy)\n",
+	        st->branches, st->branchMispredicts,
+	        100 - percent(st->branchMispredicts, st->branches));
+	fprintf(fp, "  jumps    = %lld, %lld mispredicted\n", st->jumps, st->jumpMispredicts);
+	if (config->btbEntries > 0)
+		fprintf(fp, "  BTB hits = %lld of %lld (%.2f%%)\n",
+		        st->btbHits, st->btbLookups, percent(st->btbHits, st->btbLookups));
+
+	// the worst sites first
+	BranchSite *sorted = malloc(p->siteCount * sizeof(BranchSite) + 1);
+	if (sorted == NULL)
+		return;
+
+	int i, count = 0;
+	for (i=0; i<p->siteCapacity; i++)
+		if (p->sites[i].executed != 0)
+			sorted[count++] = p->sites[i];
+	qsort(sorted, count, sizeof(BranchSite), site_compare);
+
+	if (maxSites >= 0 && count > maxSites)
+		count = maxSites;
+
+	if (count > 0)
+		fprintf(fp, "  %-10s  %-6s  %10s  %7s  %10s\n", "pc", "type", "executed", "taken", "mispredict");
+	for (i=0; i<count; i++)
+	{
+		BranchSite *site = &sorted[i];
+		fprintf(fp, "  0x%08x  %-6s  %10lld  %6.1f%%  %10lld\n",
+		        site->pc, site->isBranch ? "branch" : "jump",
+		        site->executed, percent(site->taken, site->executed),
+		        site->mispredicts);
+	}
+
+	free(sorted);
+}
+
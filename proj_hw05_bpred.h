@@ -0,0 +1,111 @@
+#ifndef PROJ_HW05_BPRED_H
+#define PROJ_HW05_BPRED_H
+
+
+#include <stdio.h>
+
+#include "proj_hw05.h"
+
+
+
+/* a timing model of a branch predictor, and (optionally) a branch target
+ * buffer, in the fetch path.  Our pipeline resolves branches and jumps
+ * in ID, and the next fetch always goes to the right place; so, like the
+ * caches, the predictor only changes how many clocks a program takes.
+ *
+ * When an instruction is fetched, IF guesses the next PC: if the BTB has
+ * an entry for it, and it is a jump, or a branch that the direction
+ * predictor says is taken, the guess is the BTB's target; otherwise it
+ * is PC+4.  When the instruction resolves in ID, a wrong guess costs
+ * 'penalty' clocks of bubbles, while IF is flushed and refetches.
+ *
+ * With no BTB (btbEntries == 0), the target of a taken branch or jump is
+ * assumed to be known in time, so only the direction is predicted, and
+ * jumps are free.
+ *
+ * The direction predictors:
+ *     BPRED_NOT_TAKEN    always predicts not taken
+ *     BPRED_ONE_BIT      a table of 1-bit "last outcome" entries
+ *     BPRED_TWO_BIT      a table of 2-bit saturating counters (bimodal)
+ *     BPRED_GSHARE       2-bit counters, indexed by PC xor global history
+ * The tables have 2^tableBits entries, indexed by the word address of the
+ * branch; gshare keeps 'historyBits' bits of history (at most tableBits).
+ *
+ * The simulator makes the prediction and checks it in the same call, when
+ * the instruction resolves; since nothing else can update the predictor
+ * between the two, that gives the same answer.
+ */
+
+#define BPRED_NOT_TAKEN  0
+#define BPRED_ONE_BIT    1
+#define BPRED_TWO_BIT    2
+#define BPRED_GSHARE     3
+
+typedef struct PredictorConfig
+{
+	int type;                    // BPRED_*
+	int tableBits;
+	int historyBits;             // gshare only
+	int btbEntries;              // 0, or a power of two (direct-mapped)
+	int penalty;                 // clocks lost on a misprediction
+} PredictorConfig;
+
+typedef struct PredictorStats
+{
+	long long branches,    branchMispredicts;     // conditional
+	long long jumps,       jumpMispredicts;
+	long long btbLookups,  btbHits;
+} PredictorStats;
+
+/* the per-PC statistics: one entry for every branch or jump executed */
+typedef struct BranchSite
+{
+	WORD      pc;
+	int       isBranch;          // 0 for a jump
+	long long executed, taken, mispredicts;
+} BranchSite;
+
+typedef struct Predictor
+{
+	PredictorConfig config;
+	PredictorStats  stats;
+
+	unsigned char *table;        // direction counters
+	unsigned       tableMask;
+	unsigned       history;
+
+	WORD          *btbTags;      // the PC of each entry, or -1
+	WORD          *btbTargets;
+
+	BranchSite    *sites;        // open-addressed hash table, by PC
+	int            siteCount, siteCapacity;
+} Predictor;
+
+
+/* Predictor_init() checks the configuration, and sets up an empty
+ * predictor (every counter at "weakly not taken").  It returns 0 on
+ * success, or prints a message and returns -1.  Predictor_free() frees
+ * it.
+ *
+ * Predictor_parse() turns a name ("nt", "1bit", "2bit", "gshare") into a
+ * BPRED_* type, or returns -1.
+ */
+int  Predictor_init (Predictor *p, const PredictorConfig *config);
+void Predictor_free (Predictor *p);
+int  Predictor_parse(const char *name);
+
+/* Predictor_resolve() is called when a branch or jump at 'pc' resolves:
+ * 'isBranch' is 0 for jumps, and 'nextPC' is where it actually went.  It
+ * checks the prediction, trains the predictor, and returns the number of
+ * clocks that the misprediction costs (0 if it was right).
+ */
+int Predictor_resolve(Predictor *p, WORD pc, int isBranch, int taken, WORD nextPC);
+
+/* prints the accuracy, and then the 'maxSites' branches with the most
+ * mispredictions (all of them, if negative).
+ */
+void PrintPredictorStats(FILE *fp, Predictor *p, int maxSites);
+
+
+#endif
+
@@ -0,0 +1,234 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <memory.h>
+#include <string.h>
+
+#include "proj_hw05_cache.h"
+
+
+
+#define CACHE_VALID  0x01
+#define CACHE_DIRTY  0x02
+
+
+static int isPow2(int x)
+{
+	return x > 0 && (x & (x-1)) == 0;
+}
+
+static int log2i(int x)
+{
+	int n = 0;
+	while ((1 << n) < x)
+		n++;
+	return n;
+}
+
+
+
+int Cache_init(Cache *c, const CacheConfig *config)
+{
+	memset(c, 0, sizeof(*c));
+
+	if (!isPow2(config->sizeBytes) || !isPow2(config->assoc) ||
+	    !isPow2(config->lineBytes) || config->lineBytes < 4   ||
+	    config->assoc > 64         ||
+	    config->sizeBytes < config->assoc * config->lineBytes ||
+	    config->missLatency < 0 || config->missLatency > CACHE_MAX_LATENCY)
+	{
+		printf("Cache_init(): Invalid cache configuration: %d bytes, %d-way, %d-byte lines.\n",
+		       config->sizeBytes, config->assoc, config->lineBytes);
+		return -1;
+	}
+
+	c->config    = *config;
+	c->sets      = config->sizeBytes / (config->assoc * config->lineBytes);
+	c->lineShift = log2i(config->lineBytes);
+	c->setMask   = c->sets-1;
+
+	int lines = c->sets * config->assoc;
+	c->tags    = calloc(lines, sizeof(WORD));
+	c->flags   = calloc(lines, sizeof(unsigned char));
+	c->lastUse = calloc(lines, sizeof(unsigned));
+	c->plru    = calloc(c->sets, sizeof(unsigned long long));
+
+	if (c->tags == NULL || c->flags == NULL || c->lastUse == NULL || c->plru == NULL)
+	{
+		printf("Cache_init(): Out of memory.\n");
+		Cache_free(c);
+		return -1;
+	}
+	return 0;
+}
+
+
+
+void Cache_free(Cache *c)
+{
+	free(c->tags);
+	free(c->flags);
+	free(c->lastUse);
+	free(c->plru);
+
+	c->tags    = NULL;
+	c->flags   = NULL;
+	c->lastUse = NULL;
+	c->plru    = NULL;
+}
+
+
+
+void Cache_flush(Cache *c)
+{
+	int lines = c->sets * c->config.assoc;
+
+	memset(c->flags,   0, lines   * sizeof(unsigned char));
+	memset(c->lastUse, 0, lines   * sizeof(unsigned));
+	memset(c->plru,    0, c->sets * sizeof(unsigned long long));
+	memset(&c->stats,  0, sizeof(c->stats));
+	c->clock = 0;
+}
+
+
+
+/* tree PLRU: the tree for a set has a node for every internal branch,
+ * numbered like a heap (the root is 1).  Each node's bit says which half
+ * to replace next: 0 for the lower-numbered ways, 1 for the upper.
+ */
+static void plru_touch(Cache *c, int set, int way)
+{
+	int levels = log2i(c->config.assoc);
+	int node = 1, level;
+
+	for (level=levels-1; level>=0; level--)
+	{
+		int dir = (way >> level) & 1;
+
+		// point away from the way we just used
+		if (dir)
+			c->plru[set] &= ~(1ULL << node);
+		else
+			c->plru[set] |=  (1ULL << node);
+
+		node = 2*node + dir;
+	}
+}
+
+static int plru_victim(Cache *c, int set)
+{
+	int levels = log2i(c->config.assoc);
+	int node = 1, way = 0, level;
+
+	for (level=0; level<levels; level++)
+	{
+		int dir = (c->plru[set] >> node) & 1;
+		way  = (way << 1) | dir;
+		node = 2*node + dir;
+	}
+	return way;
+}
+
+
+static void cache_touch(Cache *c, int set, int way)
+{
+	if (c->config.replacement == CACHE_PLRU)
+		plru_touch(c, set, way);
+	else
+		c->lastUse[set*c->config.assoc + way] = ++c->clock;
+}
+
+static int cache_victim(Cache *c, int set)
+{
+	int assoc = c->config.assoc;
+	int base  = set*assoc;
+	int way;
+
+	// an empty way, if there is one
+	for (way=0; way<assoc; way++)
+		if ((c->flags[base+way] & CACHE_VALID) == 0)
+			return way;
+
+	if (c->config.replacement == CACHE_PLRU)
+		return plru_victim(c, set);
+
+	int oldest = 0;
+	for (way=1; way<assoc; way++)
+		if (c->clock - c->lastUse[base+way] > c->clock - c->lastUse[base+oldest])
+			oldest = way;
+	return oldest;
+}
+
+
+
+int Cache_access(Cache *c, WORD addr, int isWrite)
+{
+	WORD line  = (WORD)((unsigned)addr >> c->lineShift);
+	int  set   = line & c->setMask;
+	int  assoc = c->config.assoc;
+	int  base  = set*assoc;
+	int  way;
+
+	if (isWrite)
+		c->stats.writes++;
+	else
+		c->stats.reads++;
+
+	for (way=0; way<assoc; way++)
+	{
+		if ((c->flags[base+way] & CACHE_VALID) && c->tags[base+way] == line)
+		{
+			cache_touch(c, set, way);
+			if (isWrite && c->config.writeBack)
+				c->flags[base+way] |= CACHE_DIRTY;
+			return 0;
+		}
+	}
+
+	// a miss
+	if (isWrite)
+	{
+		c->stats.writeMisses++;
+		if (!c->config.writeAllocate)
+			return 0;
+	}
+	else
+		c->stats.readMisses++;
+
+	int cost = c->config.missLatency;
+
+	way = cache_victim(c, set);
+	if ((c->flags[base+way] & (CACHE_VALID|CACHE_DIRTY)) == (CACHE_VALID|CACHE_DIRTY))
+	{
+		c->stats.writebacks++;
+		cost += c->config.missLatency;
+	}
+
+	c->tags [base+way] = line;
+	c->flags[base+way] = CACHE_VALID;
+	if (isWrite && c->config.writeBack)
+		c->flags[base+way] |= CACHE_DIRTY;
+	cache_touch(c, set, way);
+
+	return cost;
+}
+
+
+
+void PrintCacheStats(FILE *fp, const char *name, Cache *c)
+{
+	CacheStats *st = &c->stats;
+	long long accesses = st->reads + st->writes;
+	long long misses   = st->readMisses + st->writeMisses;
+
+	fprintf(fp, "--- %s: %d bytes, %d-way, %d-byte lines, %s, %s%s\n",
+	        name, c->config.sizeBytes, c->config.assoc, c->config.lineBytes,
+	        c->config.replacement == CACHE_PLRU ? "PLRU" : "LRU",
+	        c->config.writeBack ? "write-back" : "write-through",
+	        c->config.writeAllocate ? ", write-allocate" : "");
+	fprintf(fp, "  reads   = %lld, %lld misses\n", st->reads,  st->readMisses);
+	fprintf(fp, "  writes  = %lld, %lld misses\n", st->writes, st->writeMisses);
+	if (accesses > 0)
+		fprintf(fp, "  miss rate = %.2f%%\n", 100.0 * misses / accesses);
+	fprintf(fp, "  writebacks = %lld\n", st->writebacks);
+}
+
@@ -0,0 +1,78 @@
+#ifndef PROJ_HW05_CACHE_H
+#define PROJ_HW05_CACHE_H
+
+
+#include <stdio.h>
+
+#include "proj_hw05.h"
+
+
+
+/* a timing model of one level of set-associative cache.  It only tracks
+ * which lines are present (and dirty); the data itself stays in the
+ * simulator's memory arrays, so a cache never changes what a program
+ * computes - only how many clocks it takes.
+ *
+ * Cache_access() looks up one access, updates the cache, and returns the
+ * number of extra clocks it costs: 0 on a hit, 'missLatency' to fill a
+ * line, plus another 'missLatency' if a dirty line had to be written back
+ * first.  Writes that don't allocate, and write-through traffic, are
+ * assumed to go through a write buffer, and cost nothing.
+ */
+
+#define CACHE_LRU   0
+#define CACHE_PLRU  1                // tree pseudo-LRU
+
+#define CACHE_MAX_LATENCY  16383     // so that a miss costs < 32K clocks
+
+typedef struct CacheConfig
+{
+	int sizeBytes;
+	int assoc;                   // ways per set
+	int lineBytes;
+	int replacement;             // CACHE_LRU or CACHE_PLRU
+	int writeBack;               // 0 means write-through
+	int writeAllocate;
+	int missLatency;             // clocks
+} CacheConfig;
+
+typedef struct CacheStats
+{
+	long long reads,  readMisses;
+	long long writes, writeMisses;
+	long long writebacks;        // dirty lines written back
+} CacheStats;
+
+typedef struct Cache
+{
+	CacheConfig config;
+	CacheStats  stats;
+
+	int   sets;
+	int   lineShift, setMask;
+
+	WORD      *tags;             // [set*assoc + way]
+	unsigned char *flags;        // CACHE_VALID | CACHE_DIRTY
+	unsigned  *lastUse;          // LRU: when each way was last touched
+	unsigned long long *plru;    // PLRU: one tree of assoc-1 bits per set
+	unsigned   clock;
+} Cache;
+
+
+/* Cache_init() checks the configuration (the size, associativity and line
+ * size must be powers of two, with at least one set and at most 64 ways),
+ * and allocates the cache, empty.  It returns 0 on success, or prints a
+ * message and returns -1.  Cache_free() frees it; Cache_flush() empties
+ * it and zeroes the stats.
+ */
+int  Cache_init (Cache *c, const CacheConfig *config);
+void Cache_free (Cache *c);
+void Cache_flush(Cache *c);
+
+int  Cache_access(Cache *c, WORD addr, int isWrite);
+
+void PrintCacheStats(FILE *fp, const char *name, Cache *c);
+
+
+#endif
+
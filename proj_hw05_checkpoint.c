@@ -0,0 +1,252 @@
+#include <stdio.h>
+#include <memory.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "proj_hw05.h"
+#include "proj_hw05_checkpoint.h"
+
+
+
+#define CKPT_MAGIC    "HW5CKPT"
+#define CKPT_VERSION  8
+
+/* the memory images start on a page boundary, so that the pages which
+ * the program writes (and which get copied on write) are not shared with
+ * the header.
+ */
+#define CKPT_ALIGN    4096
+
+
+typedef struct CheckpointHeader
+{
+	char     magic[8];
+	uint32_t version;
+	uint32_t pipeRegsSize;       // sizeof(PipelineRegs) when saved
+
+	int32_t  codeOffset;
+	int32_t  instMemSizeWords;
+	int32_t  dataMemSizeWords;
+	int32_t  codeInData;         // instMemory was dataMemory + this many
+	                             // words, or -1 if they didn't overlap
+	int32_t  halted;
+	int64_t  cycles;
+
+	uint64_t instOffset;         // file offsets of the two memory images
+	uint64_t dataOffset;
+
+	WORD         regs[34];
+	PipelineRegs pipe[2];
+	PerfCounters perf;
+	Reservation  resv;
+} CheckpointHeader;
+
+
+static uint64_t align_up(uint64_t val)
+{
+	return (val + CKPT_ALIGN-1) & ~(uint64_t)(CKPT_ALIGN-1);
+}
+
+
+static int write_padded(FILE *fp, const void *buf, size_t len, uint64_t end)
+{
+	static const char zeroes[CKPT_ALIGN];
+
+	if (len > 0 && fwrite(buf, len, 1, fp) != 1)
+		return -1;
+
+	uint64_t pad = end - (uint64_t)ftell(fp);
+	if (pad > 0 && fwrite(zeroes, pad, 1, fp) != 1)
+		return -1;
+
+	return 0;
+}
+
+
+
+/* where instMemory is inside dataMemory, in words: -1 if they don't
+ * overlap, and -2 if they overlap, but the code isn't all inside the data
+ * (or isn't on a word boundary)
+ */
+static int64_t code_inData(MachineState *m)
+{
+	uintptr_t code    = (uintptr_t)m->instMemory;
+	uintptr_t codeEnd = code + (uintptr_t)m->instMemSizeWords * sizeof(WORD);
+	uintptr_t data    = (uintptr_t)m->dataMemory;
+	uintptr_t dataEnd = data + (uintptr_t)m->dataMemSizeWords * sizeof(WORD);
+
+	if (codeEnd <= data || dataEnd <= code)
+		return -1;
+	if (code < data || codeEnd > dataEnd || (code - data) % sizeof(WORD) != 0)
+		return -2;
+	return (code - data) / sizeof(WORD);
+}
+
+
+
+int SaveCheckpoint(const char *path, MachineState *m)
+{
+	if (m->pagedMemory != NULL)
+	{
+		printf("SaveCheckpoint(): A machine with paged memory can't be saved.\n");
+		return -1;
+	}
+	if (m->mmu != NULL)
+	{
+		printf("SaveCheckpoint(): A machine with an MMU can't be saved.\n");
+		return -1;
+	}
+
+	int64_t codeInData = code_inData(m);
+	if (codeInData == -2)
+	{
+		printf("SaveCheckpoint(): instMemory overlaps dataMemory, but isn't inside it.\n");
+		return -1;
+	}
+
+	CheckpointHeader hdr;
+	memset(&hdr, 0, sizeof(hdr));
+
+	memcpy(hdr.magic, CKPT_MAGIC, sizeof(CKPT_MAGIC));
+	hdr.version          = CKPT_VERSION;
+	hdr.pipeRegsSize     = sizeof(PipelineRegs);
+	hdr.codeOffset       = m->codeOffset;
+	hdr.instMemSizeWords = m->instMemSizeWords;
+	hdr.dataMemSizeWords = m->dataMemSizeWords;
+	hdr.codeInData       = codeInData;
+	hdr.halted           = m->halted;
+	hdr.cycles           = m->cycles;
+
+	memcpy(hdr.regs, m->regs, sizeof(hdr.regs));
+	memcpy(hdr.pipe, m->pipe, sizeof(hdr.pipe));
+	hdr.perf = m->perf;
+	hdr.resv = m->resv;
+
+	uint64_t instLen = (uint64_t)m->instMemSizeWords * sizeof(WORD);
+	uint64_t dataLen = (uint64_t)m->dataMemSizeWords * sizeof(WORD);
+
+	// code inside the data is only saved once, as data
+	if (hdr.codeInData >= 0)
+		instLen = 0;
+
+	hdr.instOffset = align_up(sizeof(hdr));
+	hdr.dataOffset = align_up(hdr.instOffset + instLen);
+
+	FILE *fp = fopen(path, "wb");
+	if (fp == NULL)
+	{
+		printf("SaveCheckpoint(): Could not create '%s': %s\n", path, strerror(errno));
+		return -1;
+	}
+
+	int rc = 0;
+	if (write_padded(fp, &hdr,          sizeof(hdr), hdr.instOffset) != 0 ||
+	    write_padded(fp, m->instMemory, instLen,     hdr.dataOffset) != 0 ||
+	    write_padded(fp, m->dataMemory, dataLen,     hdr.dataOffset + dataLen) != 0)
+	{
+		rc = -1;
+	}
+
+	if (fclose(fp) != 0)
+		rc = -1;
+
+	if (rc != 0)
+		printf("SaveCheckpoint(): Could not write '%s': %s\n", path, strerror(errno));
+	return rc;
+}
+
+
+
+int RestoreCheckpoint(const char *path, MachineState *m, Checkpoint *ckpt)
+{
+	ckpt->base   = NULL;
+	ckpt->length = 0;
+
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+	{
+		printf("RestoreCheckpoint(): Could not open '%s': %s\n", path, strerror(errno));
+		return -1;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(CheckpointHeader))
+	{
+		printf("RestoreCheckpoint(): '%s' is too short to be a checkpoint.\n", path);
+		close(fd);
+		return -1;
+	}
+
+	/* MAP_PRIVATE makes the mapping copy-on-write: the simulation can
+	 * write to the memories, but the file never changes.
+	 */
+	void *base = mmap(NULL, st.st_size, PROT_READ|PROT_WRITE, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if (base == MAP_FAILED)
+	{
+		printf("RestoreCheckpoint(): Could not map '%s': %s\n", path, strerror(errno));
+		return -1;
+	}
+
+	CheckpointHeader *hdr = base;
+
+	uint64_t instLen = (uint64_t)hdr->instMemSizeWords * sizeof(WORD);
+	uint64_t dataLen = (uint64_t)hdr->dataMemSizeWords * sizeof(WORD);
+
+	if (hdr->codeInData >= 0)
+		instLen = 0;
+
+	if (memcmp(hdr->magic, CKPT_MAGIC, sizeof(CKPT_MAGIC)) != 0 ||
+	    hdr->version      != CKPT_VERSION         ||
+	    hdr->pipeRegsSize != sizeof(PipelineRegs) ||
+	    (int64_t)hdr->codeInData + hdr->instMemSizeWords > hdr->dataMemSizeWords ||
+	    hdr->instOffset + instLen > (uint64_t)st.st_size ||
+	    hdr->dataOffset + dataLen > (uint64_t)st.st_size)
+	{
+		printf("RestoreCheckpoint(): '%s' is not a checkpoint from this version of the simulator.\n", path);
+		munmap(base, st.st_size);
+		return -1;
+	}
+
+	memset(m, 0, sizeof(*m));
+
+	m->codeOffset       = hdr->codeOffset;
+	m->instMemSizeWords = hdr->instMemSizeWords;
+	m->dataMemSizeWords = hdr->dataMemSizeWords;
+	m->halted           = hdr->halted;
+	m->cycles           = hdr->cycles;
+
+	memcpy(m->regs, hdr->regs, sizeof(m->regs));
+	memcpy(m->pipe, hdr->pipe, sizeof(m->pipe));
+	m->perf = hdr->perf;
+	m->resv = hdr->resv;
+
+	m->instMemory = (WORD*)((char*)base + hdr->instOffset);
+	m->dataMemory = (WORD*)((char*)base + hdr->dataOffset);
+
+	// keep self-modifying programs working
+	if (hdr->codeInData >= 0)
+		m->instMemory = m->dataMemory + hdr->codeInData;
+
+	ckpt->base   = base;
+	ckpt->length = st.st_size;
+	return 0;
+}
+
+
+
+void ReleaseCheckpoint(Checkpoint *ckpt)
+{
+	if (ckpt->base != NULL)
+		munmap(ckpt->base, ckpt->length);
+
+	ckpt->base   = NULL;
+	ckpt->length = 0;
+}
+
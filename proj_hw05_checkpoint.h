@@ -0,0 +1,51 @@
+#ifndef PROJ_HW05_CHECKPOINT_H
+#define PROJ_HW05_CHECKPOINT_H
+
+
+#include <stddef.h>
+
+#include "proj_hw05_test_commonCode.h"
+
+
+
+/* these functions save a MachineState to a file, and restore it later:
+ * the registers (including hi/lo), both sets of pipeline registers, the
+ * ll reservation, and both memories.
+ *
+ * RestoreCheckpoint() doesn't read the memory images; it maps the file
+ * (copy-on-write), and points the MachineState's instMemory and dataMemory
+ * into the mapping.  So restoring is cheap no matter how big the memories
+ * are, and running from a restored checkpoint never changes the file.
+ * Call ReleaseCheckpoint() when you are done with the MachineState (after
+ * FreeMachine(), if you ran it).
+ *
+ * If instMemory is inside dataMemory (a self-modifying program, with its
+ * code anywhere in its data), it is saved once, as part of the data, and
+ * restored there, so stores still reach the code.  Code that overlaps the
+ * data without being inside it can't be saved.
+ *
+ * The file is a snapshot of the host's structs, so it can only be
+ * restored by a build with the same pipeline register layout; the
+ * version and layout are checked on restore.
+ *
+ * The caches, TLBs and branch predictor (m->icache, m->dcache, m->itlb,
+ * m->dtlb and m->bpred) are not saved: a restored machine has none.
+ * Attach new ones before running it, if you want them.  A machine with
+ * paged memory (m->pagedMemory) can't be saved yet, and neither can one
+ * with an MMU (m->mmu), since its data is in the MMU's physical memory.
+ *
+ * Both return 0 on success, and print a message and return -1 on error.
+ */
+typedef struct Checkpoint
+{
+	void   *base;
+	size_t  length;
+} Checkpoint;
+
+int  SaveCheckpoint   (const char *path, MachineState *m);
+int  RestoreCheckpoint(const char *path, MachineState *m, Checkpoint *ckpt);
+void ReleaseCheckpoint(Checkpoint *ckpt);
+
+
+#endif
+
@@ -0,0 +1,117 @@
+#include <stdio.h>
+#include <memory.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "proj_hw05_datafile.h"
+
+
+
+int DataFile_open(DataFile *df, const char *path, int sizeWords, int mode)
+{
+	memset(df, 0, sizeof(*df));
+
+	int shared = (mode == DATAFILE_SHARED);
+	int fd     = shared ? open(path, O_RDWR|O_CREAT, 0644) : open(path, O_RDONLY);
+	if (fd < 0)
+	{
+		printf("DataFile_open(): Could not open '%s': %s\n", path, strerror(errno));
+		return -1;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0)
+	{
+		printf("DataFile_open(): Could not read the size of '%s': %s\n", path, strerror(errno));
+		close(fd);
+		return -1;
+	}
+
+	if (sizeWords == 0)
+	{
+		if (st.st_size / sizeof(WORD) > INT32_MAX)
+		{
+			printf("DataFile_open(): '%s' is too big.\n", path);
+			close(fd);
+			return -1;
+		}
+		sizeWords = st.st_size / sizeof(WORD);
+	}
+	if (sizeWords <= 0)
+	{
+		printf("DataFile_open(): '%s' is empty.\n", path);
+		close(fd);
+		return -1;
+	}
+
+	size_t length   = (size_t)sizeWords * sizeof(WORD);
+	size_t fileUsed = length;
+
+	if (shared && (uint64_t)st.st_size < length && ftruncate(fd, length) != 0)
+	{
+		printf("DataFile_open(): Could not extend '%s': %s\n", path, strerror(errno));
+		close(fd);
+		return -1;
+	}
+	if (!shared && (uint64_t)st.st_size < length)
+		fileUsed = st.st_size;
+
+	void *base;
+	if (shared)
+		base = mmap(NULL, length, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+	else
+	{
+		/* reserve the whole thing as zeroes, and then map the file
+		 * over the front of it.  The tail of the file's last page
+		 * reads as zeroes, too.
+		 */
+		base = mmap(NULL, length, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+		if (base != MAP_FAILED && fileUsed > 0 &&
+		    mmap(base, fileUsed, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_FIXED, fd, 0) == MAP_FAILED)
+		{
+			munmap(base, length);
+			base = MAP_FAILED;
+		}
+	}
+	close(fd);
+
+	if (base == MAP_FAILED)
+	{
+		printf("DataFile_open(): Could not map '%s': %s\n", path, strerror(errno));
+		return -1;
+	}
+
+	df->words     = base;
+	df->sizeWords = sizeWords;
+	df->base      = base;
+	df->length    = length;
+	return 0;
+}
+
+
+
+int DataFile_sync(DataFile *df)
+{
+	if (df->base != NULL && msync(df->base, df->length, MS_SYNC) != 0)
+	{
+		printf("DataFile_sync(): %s\n", strerror(errno));
+		return -1;
+	}
+	return 0;
+}
+
+
+
+void DataFile_close(DataFile *df)
+{
+	if (df->base != NULL)
+		munmap(df->base, df->length);
+
+	memset(df, 0, sizeof(*df));
+}
+
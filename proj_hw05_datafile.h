@@ -0,0 +1,48 @@
+#ifndef PROJ_HW05_DATAFILE_H
+#define PROJ_HW05_DATAFILE_H
+
+
+#include <stddef.h>
+
+#include "proj_hw05.h"
+
+
+
+/* a flat data memory which is a memory-mapped file, so it can be handed
+ * to ExecProcessor() (or any of the other Exec*() functions, or
+ * InitMachine()) in place of an array.  Nothing is read up front: the OS
+ * pages the file in as the program touches it, so opening a huge input
+ * image takes the same time as opening a small one.
+ *
+ * DATAFILE_SHARED writes go to the file, so the results are there once
+ * the run ends (DataFile_sync() forces them to disk).  The file is
+ * created if it doesn't exist, and extended (with zeroes, which take no
+ * space on disk) if it is shorter than 'sizeWords'.
+ *
+ * DATAFILE_PRIVATE writes are copy-on-write, and the file never changes;
+ * use it to run many times from the same input image.  The file must
+ * exist; anything past its end reads as zeroes.
+ *
+ * A 'sizeWords' of 0 means "the size of the file".  DataFile_open()
+ * returns 0, or prints a message and returns -1.
+ */
+
+#define DATAFILE_SHARED   0
+#define DATAFILE_PRIVATE  1
+
+typedef struct DataFile
+{
+	WORD   *words;
+	int     sizeWords;
+
+	void   *base;                // the whole mapping
+	size_t  length;
+} DataFile;
+
+int  DataFile_open (DataFile *df, const char *path, int sizeWords, int mode);
+int  DataFile_sync (DataFile *df);
+void DataFile_close(DataFile *df);
+
+
+#endif
+
@@ -0,0 +1,316 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <memory.h>
+#include <string.h>
+
+#include "proj_hw05.h"
+#include "proj_hw05_test_commonCode.h"
+#include "proj_hw05_ensemble.h"
+
+
+
+void InitEnsemble(Ensemble *e,
+                  WORD *instMemory, int instMemSizeWords,
+                  int   dataMemSizeWords,
+                  WORD  codeOffset)
+{
+	memset(e, 0, sizeof(*e));
+
+	e->instMemory       = instMemory;
+	e->instMemSizeWords = instMemSizeWords;
+	e->dataMemSizeWords = dataMemSizeWords;
+	e->codeOffset       = codeOffset;
+}
+
+
+
+void SetEnsembleLane(Ensemble *e, int lane, WORD *regs, WORD *dataMemory)
+{
+	int r;
+	for (r=0; r<34; r++)
+		e->regs[r][lane] = regs[r];
+
+	e->pc  [lane]       = e->codeOffset;
+	e->live[lane]       = -1;
+	e->resvValid[lane]  = 0;
+	e->dataMemory[lane] = dataMemory;
+}
+
+
+
+void GetEnsembleLane(Ensemble *e, int lane, WORD *regs)
+{
+	int r;
+	for (r=0; r<34; r++)
+		regs[r] = e->regs[r][lane];
+}
+
+
+
+void FreeEnsemble(Ensemble *e)
+{
+	free(e->decoded);
+	e->decoded = NULL;
+}
+
+
+
+static inline FILE *lane_out(Ensemble *e, int lane)
+{
+	return e->out[lane] != NULL ? e->out[lane] : stdout;
+}
+
+static inline int ensemble_validPC(Ensemble *e, WORD pc)
+{
+	int instIndx = (pc - e->codeOffset)/4;
+	return instIndx >= 0 && instIndx < e->instMemSizeWords && pc % 4 == 0;
+}
+
+// each lane of 'yes' where 'mask' is set, else the lane of 'no'
+#define BLEND(mask, yes, no)  (((yes) & (mask)) | ((no) & ~(mask)))
+
+
+
+/* executes one instruction, for the group of lanes at the lowest PC.
+ * Returns 0 if there are no lanes left to run.
+ */
+static int ensemble_step(Ensemble *e)
+{
+	const LaneVec zero = {0};
+
+	// find the group
+	int  lane, found = 0;
+	WORD pc = 0;
+	for (lane=0; lane<ENSEMBLE_LANES; lane++)
+	{
+		if (e->live[lane] && (!found || (unsigned)e->pc[lane] < (unsigned)pc))
+		{
+			pc    = e->pc[lane];
+			found = 1;
+		}
+	}
+	if (!found)
+		return 0;
+
+	LaneVec mask = (e->pc == zero+pc) & e->live;
+
+	int count = 0;
+	for (lane=0; lane<ENSEMBLE_LANES; lane++)
+		count += mask[lane] & 1;
+
+	e->steps++;
+	e->laneInstructions += count;
+
+
+	// every lane in the group has a valid PC: we check before moving it
+	int  instIndx    = (pc - e->codeOffset)/4;
+	WORD instruction = e->instMemory[instIndx];
+
+	LaneVec nextPC  = zero + (pc+4);
+	int     uniform = 1;             // nextPC is the same in every lane
+
+	if (instruction == SYSCALL())
+	{
+		for (lane=0; lane<ENSEMBLE_LANES; lane++)
+		{
+			if (!mask[lane])
+				continue;
+
+			WORD regs[34];
+			GetEnsembleLane(e, lane, regs);
+
+			if (execSyscallTo(lane_out(e, lane), regs, e->dataMemory[lane]) != 0)
+			{
+				e->live[lane] = 0;
+				mask   [lane] = 0;
+			}
+		}
+	}
+	else
+	{
+		DecodedInst *dec = &e->decoded[instIndx];
+		if (!dec->valid)
+		{
+			predecode_instruction(instruction, dec);
+			dec->valid = 1;
+		}
+
+		if (dec->rc == 0)
+		{
+			for (lane=0; lane<ENSEMBLE_LANES; lane++)
+			{
+				if (!mask[lane])
+					continue;
+
+				fprintf(lane_out(e, lane), "RunEnsemble(): Ending program because execute_ID() returned %d\n", dec->rc);
+				e->live[lane] = 0;
+			}
+			return 1;
+		}
+
+		InstructionFields *fields = &dec->fields;
+		ID_EX             *ctrl   = &dec->ctrl;
+
+		LaneVec rsVal = e->regs[fields->rs];
+		LaneVec rtVal = e->regs[fields->rt];
+
+
+		/* IF: the same decisions as IDtoIF_get_branchControl(), for
+		 * every lane at once
+		 */
+		if (fields->opcode == 0x04 || fields->opcode == 0x05)
+		{
+			LaneVec taken = (fields->opcode == 0x04) ? (rsVal == rtVal)
+			                                         : (rsVal != rtVal);
+			WORD target = calc_branchAddr(pc+4, fields);
+
+			nextPC  = BLEND(taken, zero+target, nextPC);
+			uniform = 0;
+		}
+		else if (fields->opcode == 0x02)
+			nextPC = zero + calc_jumpAddr(pc+4, fields);
+
+
+		// EX: the same as EX_getALUinput*() and execute_EX()
+		LaneVec input1 = dec->passRsVal ? rsVal : zero;
+		LaneVec exRtVal = dec->passRtVal ? rtVal : zero;
+		LaneVec input2;
+
+		if (ctrl->ALUsrc == 2)
+			input2 = zero + (WORD)ctrl->imm16;
+		else if (ctrl->ALUsrc == 1)
+			input2 = zero + ctrl->imm32;
+		else
+			input2 = exRtVal;
+
+		LaneVec aluResult;
+		if (ctrl->extra2)
+			aluResult = zero + (WORD)((unsigned)ctrl->imm16 << 16);
+		else if (ctrl->ALU.op == 3)
+			aluResult = (input1 < input2) & 1;
+		else
+		{
+			if (ctrl->ALU.bNegate)
+				input2 = -input2;
+
+			if (ctrl->ALU.op == 0)
+				aluResult = input1 & input2;
+			else if (ctrl->ALU.op == 1)
+				aluResult = ctrl->extra1 ? ~(input1 | input2) : (input1 | input2);
+			else if (ctrl->ALU.op == 2)
+				aluResult = input1 + input2;
+			else
+				aluResult = zero;
+		}
+
+		int writeReg = ctrl->ALUsrc ? ctrl->rt : ctrl->rd;
+
+
+		/* MEM, one lane at a time: the same as execute_MEM().  An ll
+		 * also reserves its word, in each lane; an sc uses up the
+		 * reservation, and only stores (and sets rt to 1) in the lanes
+		 * which held one on the same word, as in ExecFunctional().
+		 */
+		LaneVec memResult = zero;
+		LaneVec stores    = mask;
+		if (ctrl->extra3)
+		{
+			LaneVec indx = aluResult / 4;
+			if (ctrl->memRead)
+			{
+				e->resvValid = BLEND(mask, zero-1, e->resvValid);
+				e->resvIndx  = BLEND(mask, indx,   e->resvIndx);
+			}
+			else
+			{
+				stores       = mask & e->resvValid & (e->resvIndx == indx);
+				memResult    = stores & 1;
+				e->resvValid = BLEND(mask, zero, e->resvValid);
+			}
+		}
+
+		if (ctrl->memRead)
+		{
+			for (lane=0; lane<ENSEMBLE_LANES; lane++)
+				if (mask[lane])
+					memResult[lane] = e->dataMemory[lane][aluResult[lane]/4];
+		}
+		else if (ctrl->memWrite)
+		{
+			for (lane=0; lane<ENSEMBLE_LANES; lane++)
+				if (stores[lane])
+					e->dataMemory[lane][aluResult[lane]/4] = exRtVal[lane];
+		}
+
+
+		// WB: the same as execute_WB()
+		if (ctrl->regWrite)
+		{
+			LaneVec result = ctrl->memToReg ? memResult : aluResult;
+			e->regs[writeReg] = BLEND(mask, result, e->regs[writeReg]);
+		}
+	}
+
+
+	// move the group to the next PC, unless it isn't in the program
+	if (uniform)
+	{
+		if (!ensemble_validPC(e, nextPC[0]))
+		{
+			for (lane=0; lane<ENSEMBLE_LANES; lane++)
+			{
+				if (!mask[lane])
+					continue;
+
+				fprintf(lane_out(e, lane), "ERROR: Invalid Program Counter 0x%08x\n", pc);
+				e->live[lane] = 0;
+			}
+			return 1;
+		}
+	}
+	else
+	{
+		for (lane=0; lane<ENSEMBLE_LANES; lane++)
+		{
+			if (mask[lane] && !ensemble_validPC(e, nextPC[lane]))
+			{
+				fprintf(lane_out(e, lane), "ERROR: Invalid Program Counter 0x%08x\n", pc);
+				e->live[lane] = 0;
+				mask   [lane] = 0;
+			}
+		}
+	}
+
+	e->pc = BLEND(mask, nextPC, e->pc);
+	return 1;
+}
+
+
+
+int RunEnsemble(Ensemble *e, long long maxSteps)
+{
+	if (e->decoded == NULL)
+	{
+		e->decoded = calloc(e->instMemSizeWords, sizeof(DecodedInst));
+		if (e->decoded == NULL)
+		{
+			printf("RunEnsemble(): Could not allocate the predecode cache.\n");
+			return 1;
+		}
+	}
+
+	long long steps;
+	for (steps=0; maxSteps < 0 || steps < maxSteps; steps++)
+	{
+		if (!ensemble_step(e))
+			return 1;
+	}
+
+	// we ran out of steps; but maybe the last one ended everything
+	int lane;
+	for (lane=0; lane<ENSEMBLE_LANES; lane++)
+		if (e->live[lane])
+			return 0;
+	return 1;
+}
+
@@ -0,0 +1,77 @@
+#ifndef PROJ_HW05_ENSEMBLE_H
+#define PROJ_HW05_ENSEMBLE_H
+
+
+#include <stdio.h>
+
+#include "proj_hw05_test_commonCode.h"
+
+
+
+/* runs up to ENSEMBLE_LANES copies of one program in lockstep, each with
+ * its own registers and data memory - for sweeping one program over many
+ * inputs.  This is the functional model (like ExecFunctional()), so each
+ * lane ends with exactly the state that ExecFunctional() would give it.
+ *
+ * The registers are kept as structure-of-arrays: regs[r] holds register
+ * r of every lane, as one vector.  Each instruction is fetched and
+ * decoded once, for every lane that is at that PC, and its ALU operation
+ * is done for all of the lanes at once.  Loads, stores and syscalls are
+ * done lane by lane.
+ *
+ * When a branch goes different ways in different lanes, the lanes split
+ * into groups by PC.  Each step runs the group with the lowest PC; the
+ * others wait (masked off) until the group catches up with them, so lanes
+ * come back together after the usual loops and if/else blocks.
+ *
+ * Code is shared by all the lanes, so stores into instMemory aren't
+ * supported; instMemory must not overlap any lane's data memory.
+ */
+
+#define ENSEMBLE_LANES  16
+
+typedef WORD LaneVec __attribute__((vector_size(ENSEMBLE_LANES * sizeof(WORD))));
+
+typedef struct Ensemble
+{
+	LaneVec regs[34];            // regs[r][lane]
+	LaneVec pc;
+	LaneVec live;                // -1 for lanes still running, else 0
+	LaneVec resvValid;           // each lane's ll/sc reservation: -1 if
+	LaneVec resvIndx;            // it holds one, on word resvIndx
+
+	WORD *instMemory;
+	int   instMemSizeWords;
+	WORD  codeOffset;
+
+	WORD *dataMemory[ENSEMBLE_LANES];
+	int   dataMemSizeWords;
+	FILE *out[ENSEMBLE_LANES];   // NULL means stdout
+
+	long long steps;             // instructions fetched (once per group)
+	long long laneInstructions;  // instructions executed, over all lanes
+
+	struct DecodedInst *decoded;
+} Ensemble;
+
+
+/* InitEnsemble() sets up an ensemble with no lanes; SetEnsembleLane()
+ * then starts a lane at the first instruction, with a copy of 'regs' and
+ * its own 'dataMemory'.
+ *
+ * RunEnsemble() runs for up to 'maxSteps' steps (or to the end, if
+ * negative), and returns 1 once every lane has ended.  GetEnsembleLane()
+ * copies out a lane's registers.  FreeEnsemble() frees the decode cache.
+ */
+void InitEnsemble(Ensemble *e,
+                  WORD *instMemory, int instMemSizeWords,
+                  int   dataMemSizeWords,
+                  WORD  codeOffset);
+void SetEnsembleLane(Ensemble *e, int lane, WORD *regs, WORD *dataMemory);
+void GetEnsembleLane(Ensemble *e, int lane, WORD *regs);
+int  RunEnsemble    (Ensemble *e, long long maxSteps);
+void FreeEnsemble   (Ensemble *e);
+
+
+#endif
+
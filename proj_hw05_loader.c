@@ -0,0 +1,344 @@
+#include <stdio.h>
+#include <memory.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <elf.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "proj_hw05_loader.h"
+
+
+
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define HOST_BYTE_ORDER  LOADER_BIG_ENDIAN
+#else
+#define HOST_BYTE_ORDER  LOADER_LITTLE_ENDIAN
+#endif
+
+
+static uint32_t swap32(uint32_t x)
+{
+	return __builtin_bswap32(x);
+}
+
+static uint16_t swap16(uint16_t x)
+{
+	return __builtin_bswap16(x);
+}
+
+
+
+/* maps 'len' bytes of the file, starting at 'offset', privately; the
+ * mapping starts on a host page, so the pointer returned is
+ * 'offset % pagesize' bytes into it.
+ */
+static char *loader_map(ProgramImage *img, int fd, const char *path,
+                        uint32_t offset, uint32_t len)
+{
+	if (img->mapCount == LOADER_MAX_MAPS)
+	{
+		printf("Loader: '%s' has too many segments.\n", path);
+		return NULL;
+	}
+
+	long   pageSize = sysconf(_SC_PAGESIZE);
+	size_t skew     = offset % pageSize;
+
+	void *base = mmap(NULL, len + skew, PROT_READ|PROT_WRITE, MAP_PRIVATE,
+	                  fd, offset - skew);
+	if (base == MAP_FAILED)
+	{
+		printf("Loader: Could not map '%s': %s\n", path, strerror(errno));
+		return NULL;
+	}
+
+	img->maps   [img->mapCount] = base;
+	img->mapLens[img->mapCount] = len + skew;
+	img->mapCount++;
+
+	return (char*)base + skew;
+}
+
+
+static void swap_words(char *start, uint32_t bytes)
+{
+	uint32_t *words = (uint32_t*)start;
+	uint32_t  i;
+	for (i=0; i < bytes/4; i++)
+		words[i] = swap32(words[i]);
+}
+
+
+/* copies 'bytes' of host memory into guest memory at 'vaddr' (a multiple
+ * of 4); a partial word at the end is padded with zeroes
+ */
+static int copy_bytes(GuestMemory *data, uint32_t vaddr, const char *src, uint32_t bytes)
+{
+	if (GuestMem_copyIn(data, vaddr, (const WORD*)src, bytes/4) != 0)
+		return -1;
+
+	if (bytes % 4 != 0)
+	{
+		WORD last = 0;
+		memcpy(&last, src + (bytes & ~3u), bytes % 4);
+		if (GuestMem_copyIn(data, vaddr + (bytes & ~3u), &last, 1) != 0)
+			return -1;
+	}
+	return 0;
+}
+
+
+/* puts one segment into data memory, from its own private mapping (so
+ * that the program's stores never show up in instMemory).  Pages that the
+ * segment fills completely are attached; the rest is copied.  Nothing is
+ * needed for .bss, since untouched pages read as zeroes.
+ */
+static int load_segment(ProgramImage *img, int fd, const char *path,
+                        uint32_t offset, uint32_t vaddr, uint32_t filesz,
+                        int swap, GuestMemory *data)
+{
+	if (filesz == 0)
+		return 0;
+
+	char *start = loader_map(img, fd, path, offset, filesz);
+	if (start == NULL)
+		return -1;
+	if (swap)
+		swap_words(start, filesz);
+
+	uint32_t end       = vaddr + filesz;
+	uint32_t firstFull = (vaddr + GMEM_PAGE_MASK) & ~(uint32_t)GMEM_PAGE_MASK;
+	uint32_t lastFull  = end & ~(uint32_t)GMEM_PAGE_MASK;
+
+	// pages can only be attached if the file and the address line up
+	if ((vaddr & GMEM_PAGE_MASK) != (offset & GMEM_PAGE_MASK) || firstFull >= lastFull)
+		return copy_bytes(data, vaddr, start, filesz);
+
+	if (copy_bytes(data, vaddr, start, firstFull - vaddr) != 0 ||
+	    GuestMem_attach(data, firstFull, start + (firstFull - vaddr), lastFull - firstFull) != 0)
+	{
+		return -1;
+	}
+	img->attachAddrs[img->mapCount-1] = firstFull;
+	img->attachLens [img->mapCount-1] = lastFull - firstFull;
+
+	return copy_bytes(data, lastFull, start + (lastFull - vaddr), end - lastFull);
+}
+
+
+/* a load failed: detaches whatever it had attached to 'data' (before the
+ * mappings go away), and frees the image
+ */
+static void loader_fail(ProgramImage *img, GuestMemory *data)
+{
+	int i;
+	for (i=0; data != NULL && i < img->mapCount; i++)
+	{
+		if (img->attachLens[i] != 0)
+			GuestMem_detach(data, img->attachAddrs[i], img->attachLens[i]);
+	}
+	Loader_free(img);
+}
+
+
+/* maps the text, for instMemory */
+static int load_text(ProgramImage *img, int fd, const char *path,
+                     uint32_t offset, uint32_t vaddr, uint32_t filesz, int swap)
+{
+	if (offset % 4 != 0 || vaddr % 4 != 0 || filesz < 4)
+	{
+		printf("Loader: The text in '%s' is empty, or not word aligned.\n", path);
+		return -1;
+	}
+
+	char *start = loader_map(img, fd, path, offset, filesz);
+	if (start == NULL)
+		return -1;
+	if (swap)
+		swap_words(start, filesz);
+
+	img->instMemory       = (WORD*)start;
+	img->instMemSizeWords = filesz / 4;
+	img->codeOffset       = vaddr;
+	img->entry            = vaddr;
+	return 0;
+}
+
+
+
+int Loader_loadRaw(ProgramImage *img, const char *path,
+                   WORD codeOffset, int byteOrder, GuestMemory *data)
+{
+	memset(img, 0, sizeof(*img));
+
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+	{
+		printf("Loader: Could not open '%s': %s\n", path, strerror(errno));
+		return -1;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size > UINT32_MAX)
+	{
+		printf("Loader: Could not read the size of '%s'.\n", path);
+		close(fd);
+		return -1;
+	}
+
+	int swap = (byteOrder != HOST_BYTE_ORDER);
+	int rc   = load_text(img, fd, path, 0, codeOffset, st.st_size, swap);
+	if (rc == 0 && data != NULL)
+		rc = load_segment(img, fd, path, 0, codeOffset, st.st_size, swap, data);
+
+	close(fd);
+	if (rc != 0)
+		loader_fail(img, data);
+	return rc;
+}
+
+
+
+int Loader_loadELF(ProgramImage *img, const char *path, GuestMemory *data)
+{
+	memset(img, 0, sizeof(*img));
+
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+	{
+		printf("Loader: Could not open '%s': %s\n", path, strerror(errno));
+		return -1;
+	}
+
+	struct stat st;
+	Elf32_Ehdr  eh;
+	if (fstat(fd, &st) != 0 || pread(fd, &eh, sizeof(eh), 0) != sizeof(eh) ||
+	    memcmp(eh.e_ident, ELFMAG, SELFMAG) != 0 ||
+	    eh.e_ident[EI_CLASS] != ELFCLASS32 ||
+	    (eh.e_ident[EI_DATA] != ELFDATA2LSB && eh.e_ident[EI_DATA] != ELFDATA2MSB))
+	{
+		printf("Loader: '%s' is not an ELF32 file.\n", path);
+		close(fd);
+		return -1;
+	}
+
+	int byteOrder = (eh.e_ident[EI_DATA] == ELFDATA2MSB) ? LOADER_BIG_ENDIAN
+	                                                      : LOADER_LITTLE_ENDIAN;
+	int swap      = (byteOrder != HOST_BYTE_ORDER);
+	if (swap)
+	{
+		eh.e_type      = swap16(eh.e_type);
+		eh.e_machine   = swap16(eh.e_machine);
+		eh.e_entry     = swap32(eh.e_entry);
+		eh.e_phoff     = swap32(eh.e_phoff);
+		eh.e_phentsize = swap16(eh.e_phentsize);
+		eh.e_phnum     = swap16(eh.e_phnum);
+	}
+
+	if (eh.e_type != ET_EXEC || eh.e_machine != EM_MIPS ||
+	    eh.e_phentsize != sizeof(Elf32_Phdr) || eh.e_phnum == 0)
+	{
+		printf("Loader: '%s' is not a MIPS executable.\n", path);
+		close(fd);
+		return -1;
+	}
+
+	int rc = 0, haveText = 0;
+	int i;
+	for (i=0; rc == 0 && i < eh.e_phnum; i++)
+	{
+		Elf32_Phdr ph;
+		if (pread(fd, &ph, sizeof(ph), eh.e_phoff + i*sizeof(ph)) != sizeof(ph))
+		{
+			printf("Loader: '%s' is truncated.\n", path);
+			rc = -1;
+			break;
+		}
+		if (swap)
+		{
+			ph.p_type   = swap32(ph.p_type);
+			ph.p_offset = swap32(ph.p_offset);
+			ph.p_vaddr  = swap32(ph.p_vaddr);
+			ph.p_filesz = swap32(ph.p_filesz);
+			ph.p_memsz  = swap32(ph.p_memsz);
+			ph.p_flags  = swap32(ph.p_flags);
+		}
+
+		if (ph.p_type != PT_LOAD)
+			continue;
+
+		if ((uint64_t)ph.p_offset + ph.p_filesz > (uint64_t)st.st_size ||
+		    ph.p_filesz > ph.p_memsz || ph.p_vaddr % 4 != 0)
+		{
+			printf("Loader: Segment %d of '%s' is invalid.\n", i, path);
+			rc = -1;
+			break;
+		}
+
+		if (ph.p_flags & PF_X)
+		{
+			if (haveText)
+			{
+				printf("Loader: '%s' has more than one text segment.\n", path);
+				rc = -1;
+				break;
+			}
+			haveText = 1;
+			rc = load_text(img, fd, path, ph.p_offset, ph.p_vaddr, ph.p_filesz, swap);
+		}
+
+		if (rc == 0 && data != NULL)
+			rc = load_segment(img, fd, path, ph.p_offset, ph.p_vaddr, ph.p_filesz, swap, data);
+	}
+	close(fd);
+
+	if (rc == 0 && !haveText)
+	{
+		printf("Loader: '%s' has no text segment.\n", path);
+		rc = -1;
+	}
+
+	if (rc == 0)
+	{
+		uint32_t entryIndx = (uint32_t)(eh.e_entry - img->codeOffset) / 4;
+		if (eh.e_entry % 4 != 0 || entryIndx >= (uint32_t)img->instMemSizeWords)
+		{
+			printf("Loader: The entry point 0x%08x of '%s' is not in its text.\n", eh.e_entry, path);
+			rc = -1;
+		}
+		img->entry = eh.e_entry;
+	}
+
+	if (rc != 0)
+		loader_fail(img, data);
+	return rc;
+}
+
+
+
+void Loader_initMachine(MachineState *m, ProgramImage *img,
+                        WORD *regs, GuestMemory *data)
+{
+	InitMachine(m, img->instMemory, img->instMemSizeWords, regs,
+	            NULL, 0, img->codeOffset);
+	m->pagedMemory = data;
+
+	m->pipe[0].pc          = img->entry;
+	m->pipe[0].instruction = img->instMemory[(img->entry - img->codeOffset)/4];
+}
+
+
+
+void Loader_free(ProgramImage *img)
+{
+	int i;
+	for (i=0; i < img->mapCount; i++)
+		munmap(img->maps[i], img->mapLens[i]);
+
+	memset(img, 0, sizeof(*img));
+}
+
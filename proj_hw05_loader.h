@@ -0,0 +1,80 @@
+#ifndef PROJ_HW05_LOADER_H
+#define PROJ_HW05_LOADER_H
+
+
+#include <stddef.h>
+
+#include "proj_hw05.h"
+#include "proj_hw05_memory.h"
+#include "proj_hw05_test_commonCode.h"
+
+
+
+/* loads a program from a file, instead of building it in an array: either
+ * a raw binary (nothing but instructions), or an ELF32 MIPS executable.
+ *
+ * Nothing is read up front.  The text is mapped (privately) from the file,
+ * and instMemory points straight into the mapping, so each page of code
+ * is read from disk the first time that it is fetched.  If 'data' is not
+ * NULL, every loadable segment (the text included, for its constants) is
+ * also put into that paged memory at its address: whole pages are
+ * attached straight from the file with GuestMem_attach(), and only the
+ * partial pages at either end are copied.  Whatever is past the end of a
+ * segment's file data (.bss) reads as zeroes.
+ *
+ * The simulator works in host byte order.  So an image of the other byte
+ * order (for instance, big-endian MIPS on x86) has its words swapped as
+ * it is loaded, and is no longer zero-copy: every page of it is read and
+ * copied on write.  Single bytes (the strings for print_str) are not
+ * swapped back, so they read in host order.
+ *
+ * Loader_loadRaw() and Loader_loadELF() return 0, or print a message and
+ * return -1 (having freed anything that they had mapped).  On failure,
+ * every page that the call attached to 'data' is detached again, so
+ * nothing in it points into the unmapped file; but the words that it had
+ * already copied into the partial pages stay there.
+ */
+
+#define LOADER_LITTLE_ENDIAN  0
+#define LOADER_BIG_ENDIAN     1
+
+#define LOADER_MAX_MAPS       16
+
+typedef struct ProgramImage
+{
+	WORD *instMemory;
+	int   instMemSizeWords;
+	WORD  codeOffset;            // the address of instMemory[0]
+	WORD  entry;                 // the first PC
+
+	int    mapCount;
+	void  *maps   [LOADER_MAX_MAPS];
+	size_t mapLens[LOADER_MAX_MAPS];
+
+	// the pages attached from each mapping (attachLens[i] is 0 if none)
+	uint32_t attachAddrs[LOADER_MAX_MAPS];
+	uint32_t attachLens [LOADER_MAX_MAPS];
+} ProgramImage;
+
+int Loader_loadRaw(ProgramImage *img, const char *path,
+                   WORD codeOffset, int byteOrder, GuestMemory *data);
+int Loader_loadELF(ProgramImage *img, const char *path, GuestMemory *data);
+
+
+/* InitMachine() for a loaded program: the data memory is 'data' (which
+ * may be the one that the program was loaded into), and the first
+ * instruction is the one at the entry point.
+ */
+void Loader_initMachine(MachineState *m, ProgramImage *img,
+                        WORD *regs, GuestMemory *data);
+
+
+/* unmaps the file.  Call it only once everything that uses the image is
+ * gone: after FreeMachine(), and after GuestMem_free() on any memory it
+ * was loaded into.
+ */
+void Loader_free(ProgramImage *img);
+
+
+#endif
+
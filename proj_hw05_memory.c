@@ -0,0 +1,224 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <memory.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "proj_hw05_memory.h"
+
+
+
+#define L2_ENTRIES  (1 << GMEM_L2_BITS)
+
+#define L1_INDEX(addr)  ((addr) >> (GMEM_L2_BITS + GMEM_PAGE_BITS))
+#define L2_INDEX(addr)  (((addr) >> GMEM_PAGE_BITS) & (L2_ENTRIES-1))
+
+
+
+void GuestMem_init(GuestMemory *m)
+{
+	memset(m, 0, sizeof(*m));
+	m->lastPage  = GMEM_NO_PAGE;
+	m->lastWords = NULL;
+}
+
+
+
+void GuestMem_free(GuestMemory *m)
+{
+	int i, j;
+	for (i=0; i < (1 << GMEM_L1_BITS); i++)
+	{
+		GuestTable *table = m->tables[i];
+		if (table == NULL)
+			continue;
+
+		for (j=0; j < L2_ENTRIES; j++)
+		{
+			if (!(table->attached[j/32] & (1u << (j%32))))
+				free(table->pages[j]);
+		}
+		free(table);
+	}
+
+	GuestMem_init(m);
+}
+
+
+
+WORD *GuestMem_findPage(GuestMemory *m, uint32_t addr)
+{
+	GuestTable *table = m->tables[L1_INDEX(addr)];
+	if (table == NULL)
+		return NULL;
+	return table->pages[L2_INDEX(addr)];
+}
+
+
+
+static GuestTable *find_table(GuestMemory *m, uint32_t addr)
+{
+	GuestTable *table = m->tables[L1_INDEX(addr)];
+	if (table == NULL)
+	{
+		table = calloc(1, sizeof(GuestTable));
+		if (table == NULL)
+		{
+			printf("GuestMem_page(): Out of memory for the page table at 0x%08x.\n", addr);
+			return NULL;
+		}
+		m->tables[L1_INDEX(addr)] = table;
+	}
+	return table;
+}
+
+
+
+WORD *GuestMem_pageSlow(GuestMemory *m, uint32_t addr)
+{
+	GuestTable *table = find_table(m, addr);
+	if (table == NULL)
+		return NULL;
+
+	WORD *page = table->pages[L2_INDEX(addr)];
+	if (page == NULL)
+	{
+		page = calloc(GMEM_PAGE_WORDS, sizeof(WORD));
+		if (page == NULL)
+		{
+			printf("GuestMem_page(): Out of memory for the page at 0x%08x.\n", addr);
+			return NULL;
+		}
+		table->pages[L2_INDEX(addr)] = page;
+		m->pages++;
+	}
+
+	m->lastPage  = addr >> GMEM_PAGE_BITS;
+	m->lastWords = page;
+	return page;
+}
+
+
+
+int GuestMem_attach(GuestMemory *m, uint32_t addr, void *host, uint32_t bytes)
+{
+	if ((addr & GMEM_PAGE_MASK) != 0 || ((uintptr_t)host & GMEM_PAGE_MASK) != 0)
+	{
+		printf("GuestMem_attach(): 0x%08x is not page aligned.\n", addr);
+		return -1;
+	}
+
+	uint64_t n = ((uint64_t)bytes + GMEM_PAGE_MASK) >> GMEM_PAGE_BITS;
+	if ((addr >> GMEM_PAGE_BITS) + n > (1u << (32 - GMEM_PAGE_BITS)))
+	{
+		printf("GuestMem_attach(): 0x%x bytes at 0x%08x run off the end of memory.\n", bytes, addr);
+		return -1;
+	}
+
+	/* the tables are allocated here, so that once the checks pass,
+	 * attaching every page can't fail halfway
+	 */
+	uint64_t i;
+	for (i=0; i<n; i++)
+	{
+		uint32_t    pageAddr = addr + i*GMEM_PAGE_SIZE;
+		GuestTable *table    = find_table(m, pageAddr);
+		if (table == NULL)
+			return -1;
+
+		if (table->pages[L2_INDEX(pageAddr)] != NULL)
+		{
+			printf("GuestMem_attach(): The page at 0x%08x is already in use.\n", pageAddr);
+			return -1;
+		}
+	}
+
+	for (i=0; i<n; i++)
+	{
+		uint32_t    pageAddr = addr + i*GMEM_PAGE_SIZE;
+		GuestTable *table    = m->tables[L1_INDEX(pageAddr)];
+
+		int indx = L2_INDEX(pageAddr);
+		table->pages[indx]        = (WORD*)((char*)host + i*GMEM_PAGE_SIZE);
+		table->attached[indx/32] |= 1u << (indx%32);
+		m->attachedPages++;
+	}
+	return 0;
+}
+
+
+
+void GuestMem_detach(GuestMemory *m, uint32_t addr, uint32_t bytes)
+{
+	uint64_t n = ((uint64_t)bytes + GMEM_PAGE_MASK) >> GMEM_PAGE_BITS;
+	if ((addr >> GMEM_PAGE_BITS) + n > (1u << (32 - GMEM_PAGE_BITS)))
+		n = (1u << (32 - GMEM_PAGE_BITS)) - (addr >> GMEM_PAGE_BITS);
+
+	uint64_t i;
+	for (i=0; i<n; i++)
+	{
+		uint32_t    pageAddr = addr + i*GMEM_PAGE_SIZE;
+		GuestTable *table    = m->tables[L1_INDEX(pageAddr)];
+		int         indx     = L2_INDEX(pageAddr);
+
+		if (table == NULL || !(table->attached[indx/32] & (1u << (indx%32))))
+			continue;
+
+		table->pages[indx]        = NULL;
+		table->attached[indx/32] &= ~(1u << (indx%32));
+		m->attachedPages--;
+	}
+
+	// the last page used may have been one of them
+	m->lastPage  = GMEM_NO_PAGE;
+	m->lastWords = NULL;
+}
+
+
+
+int GuestMem_copyIn(GuestMemory *m, uint32_t addr, const WORD *words, int count)
+{
+	while (count > 0)
+	{
+		WORD *page = GuestMem_page(m, addr);
+		if (page == NULL)
+			return -1;
+
+		// the rest of this page, or the rest of the words
+		int offset = (addr & GMEM_PAGE_MASK) / 4;
+		int n      = GMEM_PAGE_WORDS - offset;
+		if (n > count)
+			n = count;
+
+		memcpy(page+offset, words, n*sizeof(WORD));
+		addr  += n*4;
+		words += n;
+		count -= n;
+	}
+	return 0;
+}
+
+
+
+void GuestMem_copyOut(GuestMemory *m, uint32_t addr, WORD *words, int count)
+{
+	while (count > 0)
+	{
+		WORD *page = GuestMem_findPage(m, addr);
+
+		int offset = (addr & GMEM_PAGE_MASK) / 4;
+		int n      = GMEM_PAGE_WORDS - offset;
+		if (n > count)
+			n = count;
+
+		if (page != NULL)
+			memcpy(words, page+offset, n*sizeof(WORD));
+		else
+			memset(words, 0, n*sizeof(WORD));
+
+		addr  += n*4;
+		words += n;
+		count -= n;
+	}
+}
+
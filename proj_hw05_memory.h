@@ -0,0 +1,129 @@
+#ifndef PROJ_HW05_MEMORY_H
+#define PROJ_HW05_MEMORY_H
+
+
+#include <stdint.h>
+
+#include "proj_hw05.h"
+
+
+
+/* a sparse data memory, covering the whole 32-bit address space.  It is
+ * split into 4KB pages, found through a two-level page table: the top 10
+ * bits of an address pick a second-level table, the next 10 bits pick the
+ * page in it, and the low 12 bits are the offset in the page.  Tables and
+ * pages are allocated the first time that anything in them is touched
+ * (read or written), and start out zeroed.  So a program can put its data
+ * at 0x10010000 and its stack just under 0x80000000, and only pay for the
+ * pages that it actually uses.
+ *
+ * The last page used is remembered, so that a run of accesses to the same
+ * page (a loop walking an array, or the stack) skips the table walk.
+ *
+ * Pages can also be attached from somewhere else (the program loader
+ * attaches pages of a memory-mapped file); those are never freed here.
+ *
+ * To use it, set MachineState.pagedMemory (or call ExecFunctionalPaged());
+ * see proj_hw05_test_commonCode.h.
+ */
+
+#define GMEM_PAGE_BITS   12
+#define GMEM_PAGE_SIZE   (1 << GMEM_PAGE_BITS)         // bytes
+#define GMEM_PAGE_WORDS  (GMEM_PAGE_SIZE / 4)
+#define GMEM_PAGE_MASK   (GMEM_PAGE_SIZE - 1)
+
+#define GMEM_L2_BITS     10                            // pages per table
+#define GMEM_L1_BITS     (32 - GMEM_L2_BITS - GMEM_PAGE_BITS)
+
+#define GMEM_NO_PAGE     0xffffffffu                   // never a page number
+
+typedef struct GuestTable
+{
+	WORD    *pages[1 << GMEM_L2_BITS];
+	uint32_t attached[(1 << GMEM_L2_BITS) / 32];   // bit set: not ours
+} GuestTable;
+
+typedef struct GuestMemory
+{
+	GuestTable *tables[1 << GMEM_L1_BITS];
+
+	uint32_t lastPage;                     // page number of lastWords
+	WORD    *lastWords;
+
+	long long pages;                       // pages allocated so far
+	long long attachedPages;
+} GuestMemory;
+
+
+/* GuestMem_init() sets up an empty address space (it allocates nothing);
+ * GuestMem_free() frees every page.
+ */
+void GuestMem_init(GuestMemory *m);
+void GuestMem_free(GuestMemory *m);
+
+
+/* returns the page holding 'addr', allocating it if this is the first
+ * touch; or prints a message and returns NULL if we're out of memory.
+ * GuestMem_findPage() is the same, but returns NULL for a page that was
+ * never touched, without allocating it.
+ */
+WORD *GuestMem_pageSlow(GuestMemory *m, uint32_t addr);
+WORD *GuestMem_findPage(GuestMemory *m, uint32_t addr);
+
+/* makes the 'bytes' (rounded up to whole pages) at 'host' the memory at
+ * 'addr'; both must be page aligned, and none of the pages may have been
+ * touched yet.  The memory still belongs to the caller, and must outlive
+ * the GuestMemory.  Returns 0, or prints a message and returns -1.
+ */
+int GuestMem_attach(GuestMemory *m, uint32_t addr, void *host, uint32_t bytes);
+
+/* undoes GuestMem_attach(): every attached page in the 'bytes' (rounded
+ * up to whole pages) at 'addr' goes back to never touched.  Pages that
+ * the GuestMemory allocated itself are left alone.
+ */
+void GuestMem_detach(GuestMemory *m, uint32_t addr, uint32_t bytes);
+
+static inline WORD *GuestMem_page(GuestMemory *m, uint32_t addr)
+{
+	if ((addr >> GMEM_PAGE_BITS) == m->lastPage)
+		return m->lastWords;
+	return GuestMem_pageSlow(m, addr);
+}
+
+
+/* single words and bytes, for the simulator's own use (syscalls, tracing,
+ * and loading programs).  The address of a word is rounded down to a
+ * multiple of 4; bytes are in host order, as in a flat WORD array.  They
+ * return 0 (and write nothing) if we're out of memory.
+ */
+static inline WORD GuestMem_read(GuestMemory *m, uint32_t addr)
+{
+	WORD *page = GuestMem_page(m, addr);
+	return (page != NULL) ? page[(addr & GMEM_PAGE_MASK) / 4] : 0;
+}
+
+static inline void GuestMem_write(GuestMemory *m, uint32_t addr, WORD val)
+{
+	WORD *page = GuestMem_page(m, addr);
+	if (page != NULL)
+		page[(addr & GMEM_PAGE_MASK) / 4] = val;
+}
+
+static inline int GuestMem_readByte(GuestMemory *m, uint32_t addr)
+{
+	WORD *page = GuestMem_page(m, addr);
+	return (page != NULL) ? ((unsigned char*)page)[addr & GMEM_PAGE_MASK] : 0;
+}
+
+
+/* copies 'count' words into (or out of) memory, starting at 'addr' (a
+ * multiple of 4).  GuestMem_copyIn() returns 0, or -1 if we ran out of
+ * memory; GuestMem_copyOut() reads untouched pages as zeroes, and never
+ * allocates.
+ */
+int  GuestMem_copyIn (GuestMemory *m, uint32_t addr, const WORD *words, int count);
+void GuestMem_copyOut(GuestMemory *m, uint32_t addr, WORD *words, int count);
+
+
+#endif
+
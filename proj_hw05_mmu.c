@@ -0,0 +1,159 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <memory.h>
+#include <string.h>
+
+#include "proj_hw05_mmu.h"
+
+
+
+static int isPow2(int x)
+{
+	return x > 0 && (x & (x-1)) == 0;
+}
+
+
+
+int Tlb_init(Tlb *t, const TlbConfig *config)
+{
+	memset(t, 0, sizeof(*t));
+
+	if (!isPow2(config->entries) || !isPow2(config->assoc) ||
+	    config->assoc > 64 || config->assoc > config->entries ||
+	    config->entries > (1 << (31 - GMEM_PAGE_BITS))       ||
+	    config->missLatency < 0 || config->missLatency > TLB_MAX_LATENCY)
+	{
+		printf("Tlb_init(): Invalid TLB configuration: %d entries, %d-way, %d clocks.\n",
+		       config->entries, config->assoc, config->missLatency);
+		return -1;
+	}
+
+	// TLBs are never written, so the write policy doesn't matter
+	CacheConfig lines = { config->entries * GMEM_PAGE_SIZE, config->assoc,
+	                      GMEM_PAGE_SIZE, CACHE_LRU, 0, 0,
+	                      config->missLatency };
+
+	t->config = *config;
+	return Cache_init(&t->lines, &lines);
+}
+
+
+
+void Tlb_free(Tlb *t)
+{
+	Cache_free(&t->lines);
+}
+
+
+
+void Tlb_flush(Tlb *t)
+{
+	Cache_flush(&t->lines);
+}
+
+
+
+void PrintTlbStats(FILE *fp, const char *name, Tlb *t)
+{
+	CacheStats *st = &t->lines.stats;
+
+	fprintf(fp, "--- %s: %d entries, %d-way, %d-byte pages, %d clocks per miss\n",
+	        name, t->config.entries, t->config.assoc, GMEM_PAGE_SIZE,
+	        t->config.missLatency);
+	fprintf(fp, "  lookups = %lld, %lld misses\n", st->reads, st->readMisses);
+	if (st->reads > 0)
+		fprintf(fp, "  miss rate = %.2f%%\n", 100.0 * st->readMisses / st->reads);
+}
+
+
+
+static void soft_flush(Mmu *mmu)
+{
+	int i;
+	for (i=0; i<MMU_SOFT_TLB_SIZE; i++)
+	{
+		mmu->soft[i].vpn  = GMEM_NO_PAGE;
+		mmu->soft[i].ppn  = 0;
+		mmu->soft[i].host = NULL;
+	}
+}
+
+
+
+void Mmu_init(Mmu *mmu, GuestMemory *phys)
+{
+	memset(mmu, 0, sizeof(*mmu));
+	mmu->phys = phys;
+	GuestMem_init(&mmu->pageTable);
+	soft_flush(mmu);
+}
+
+
+
+void Mmu_free(Mmu *mmu)
+{
+	GuestMem_free(&mmu->pageTable);
+	soft_flush(mmu);
+}
+
+
+
+int Mmu_map(Mmu *mmu, uint32_t vaddr, uint32_t paddr, uint32_t bytes)
+{
+	if ((vaddr & GMEM_PAGE_MASK) != 0 || (paddr & GMEM_PAGE_MASK) != 0)
+	{
+		printf("Mmu_map(): 0x%08x and 0x%08x must both be page aligned.\n", vaddr, paddr);
+		return -1;
+	}
+
+	uint32_t vpn = vaddr >> GMEM_PAGE_BITS;
+	uint32_t ppn = paddr >> GMEM_PAGE_BITS;
+	uint64_t n   = ((uint64_t)bytes + GMEM_PAGE_MASK) >> GMEM_PAGE_BITS;
+
+	if (vpn + n > (1u << (32 - GMEM_PAGE_BITS)) || ppn + n > (1u << (32 - GMEM_PAGE_BITS)))
+	{
+		printf("Mmu_map(): 0x%x bytes at 0x%08x -> 0x%08x runs off the end of memory.\n",
+		       bytes, vaddr, paddr);
+		return -1;
+	}
+
+	uint64_t i;
+	for (i=0; i<n; i++)
+	{
+		// the PTE is never 0, so this tells us if the write worked
+		WORD pte = (WORD)(((ppn + i) << 1) | 1);
+		GuestMem_write(&mmu->pageTable, (vpn + i)*4, pte);
+		if (GuestMem_read(&mmu->pageTable, (vpn + i)*4) != pte)
+			return -1;
+	}
+
+	soft_flush(mmu);
+	return 0;
+}
+
+
+
+SoftTlbEntry *Mmu_fill(Mmu *mmu, uint32_t vaddr)
+{
+	uint32_t vpn = vaddr >> GMEM_PAGE_BITS;
+	uint32_t ppn = vpn;
+
+	// GuestMem_copyOut() doesn't allocate page table pages just to look
+	WORD pte;
+	GuestMem_copyOut(&mmu->pageTable, vpn*4, &pte, 1);
+	if (pte & 1)
+		ppn = (uint32_t)pte >> 1;
+
+	WORD *host = GuestMem_page(mmu->phys, ppn << GMEM_PAGE_BITS);
+	if (host == NULL)
+		return NULL;
+
+	SoftTlbEntry *e = &mmu->soft[vpn & (MMU_SOFT_TLB_SIZE-1)];
+	e->vpn  = vpn;
+	e->ppn  = ppn;
+	e->host = host;
+
+	mmu->softMisses++;
+	return e;
+}
+
@@ -0,0 +1,127 @@
+#ifndef PROJ_HW05_MMU_H
+#define PROJ_HW05_MMU_H
+
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "proj_hw05.h"
+#include "proj_hw05_cache.h"
+#include "proj_hw05_memory.h"
+
+
+
+/* a timing model of a TLB: which virtual pages have a translation cached.
+ * It is the cache model with one page per line, so Tlb_access() returns 0
+ * on a hit, and 'missLatency' (the page walk) on a miss; like the caches,
+ * it never changes what a program computes.
+ *
+ * 'entries' and 'assoc' must be powers of two, with at most 64 ways; a
+ * fully-associative TLB has assoc == entries.  Replacement is LRU.
+ */
+
+#define TLB_MAX_LATENCY  255
+
+typedef struct TlbConfig
+{
+	int entries;
+	int assoc;
+	int missLatency;             // clocks
+} TlbConfig;
+
+typedef struct Tlb
+{
+	TlbConfig config;
+	Cache     lines;             // one GMEM_PAGE_SIZE line per entry
+} Tlb;
+
+
+/* Tlb_init() returns 0 on success, or prints a message and returns -1 */
+int  Tlb_init (Tlb *t, const TlbConfig *config);
+void Tlb_free (Tlb *t);
+void Tlb_flush(Tlb *t);
+
+static inline int Tlb_access(Tlb *t, WORD vaddr)
+{
+	return Cache_access(&t->lines, vaddr, 0);
+}
+
+void PrintTlbStats(FILE *fp, const char *name, Tlb *t);
+
+
+
+/* virtual to physical translation, onto a GuestMemory (which is then the
+ * physical memory).  The page table maps virtual page numbers to physical
+ * ones; a page that was never mapped translates to itself, so an empty
+ * page table gives the same results as no MMU at all.
+ *
+ * The simulator doesn't walk the page table on every access: the soft
+ * TLB, a direct-mapped cache of recent translations, holds the host
+ * pointer to each page as well as its physical page number, so a hit is
+ * one compare.  (This is entirely separate from the Tlb above, which
+ * models the target's TLB for timing.)  Mmu_map() flushes it.
+ */
+
+#define MMU_SOFT_TLB_SIZE  256           // a power of two
+
+typedef struct SoftTlbEntry
+{
+	uint32_t vpn;                         // GMEM_NO_PAGE if empty
+	uint32_t ppn;
+	WORD    *host;
+} SoftTlbEntry;
+
+typedef struct Mmu
+{
+	GuestMemory *phys;
+	GuestMemory  pageTable;               // word n: (ppn << 1) | 1, or 0
+
+	SoftTlbEntry soft[MMU_SOFT_TLB_SIZE];
+	long long    softMisses;
+} Mmu;
+
+
+/* Mmu_init() sets up an empty page table on top of 'phys', which belongs
+ * to the caller; Mmu_free() frees the page table.
+ *
+ * Mmu_map() maps 'bytes' (rounded up to whole pages) starting at virtual
+ * address 'vaddr' onto physical memory starting at 'paddr'; both must be
+ * page aligned.  It returns 0, or prints a message and returns -1.
+ */
+void Mmu_init(Mmu *mmu, GuestMemory *phys);
+void Mmu_free(Mmu *mmu);
+int  Mmu_map (Mmu *mmu, uint32_t vaddr, uint32_t paddr, uint32_t bytes);
+
+/* fills the soft TLB entry for 'vaddr'; NULL if we're out of memory */
+SoftTlbEntry *Mmu_fill(Mmu *mmu, uint32_t vaddr);
+
+static inline SoftTlbEntry *Mmu_lookup(Mmu *mmu, uint32_t vaddr)
+{
+	uint32_t      vpn = vaddr >> GMEM_PAGE_BITS;
+	SoftTlbEntry *e   = &mmu->soft[vpn & (MMU_SOFT_TLB_SIZE-1)];
+
+	if (e->vpn == vpn)
+		return e;
+	return Mmu_fill(mmu, vaddr);
+}
+
+/* the host pointer to the page holding 'vaddr' (allocating the physical
+ * page on first touch), or NULL if we're out of memory
+ */
+static inline WORD *Mmu_hostPage(Mmu *mmu, uint32_t vaddr)
+{
+	SoftTlbEntry *e = Mmu_lookup(mmu, vaddr);
+	return (e != NULL) ? e->host : NULL;
+}
+
+static inline uint32_t Mmu_translate(Mmu *mmu, uint32_t vaddr)
+{
+	SoftTlbEntry *e = Mmu_lookup(mmu, vaddr);
+	if (e == NULL)
+		return vaddr;
+	return (e->ppn << GMEM_PAGE_BITS) | (vaddr & GMEM_PAGE_MASK);
+}
+
+
+#endif
+
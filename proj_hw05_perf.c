@@ -0,0 +1,113 @@
+#include <stdio.h>
+
+#include "proj_hw05_perf.h"
+
+
+
+static const char *opClassNames[OPCLASS_COUNT] = {
+	[OPCLASS(0x02, 0)]    = "j",
+	[OPCLASS(0x03, 0)]    = "jal",
+	[OPCLASS(0x04, 0)]    = "beq",
+	[OPCLASS(0x05, 0)]    = "bne",
+	[OPCLASS(0x08, 0)]    = "addi",
+	[OPCLASS(0x09, 0)]    = "addiu",
+	[OPCLASS(0x0a, 0)]    = "slti",
+	[OPCLASS(0x0b, 0)]    = "sltiu",
+	[OPCLASS(0x0c, 0)]    = "andi",
+	[OPCLASS(0x0d, 0)]    = "ori",
+	[OPCLASS(0x0f, 0)]    = "lui",
+	[OPCLASS(0x23, 0)]    = "lw",
+	[OPCLASS(0x2b, 0)]    = "sw",
+	[OPCLASS(0x30, 0)]    = "ll",
+	[OPCLASS(0x38, 0)]    = "sc",
+
+	[OPCLASS(0x00, 0x00)] = "nop",
+	[OPCLASS(0x00, 0x02)] = "srl",
+	[OPCLASS(0x00, 0x03)] = "sra",
+	[OPCLASS(0x00, 0x08)] = "jr",
+	[OPCLASS(0x00, 0x0c)] = "syscall",
+	[OPCLASS(0x00, 0x20)] = "add",
+	[OPCLASS(0x00, 0x21)] = "addu",
+	[OPCLASS(0x00, 0x22)] = "sub",
+	[OPCLASS(0x00, 0x23)] = "subu",
+	[OPCLASS(0x00, 0x24)] = "and",
+	[OPCLASS(0x00, 0x25)] = "or",
+	[OPCLASS(0x00, 0x27)] = "nor",
+	[OPCLASS(0x00, 0x2a)] = "slt",
+	[OPCLASS(0x00, 0x2b)] = "sltu",
+};
+
+const char *OpClass_name(int opClass)
+{
+	if (opClass < 0 || opClass >= OPCLASS_COUNT)
+		return NULL;
+	return opClassNames[opClass];
+}
+
+
+
+static const char *stallCauseNames[STALL_CAUSES] = {
+	[STALL_LOAD_USE]   = "load-use",
+	[STALL_ICACHE]     = "I-cache miss",
+	[STALL_DCACHE]     = "D-cache miss",
+	[STALL_MISPREDICT] = "mispredict",
+	[STALL_ID_OPERAND] = "ID operand",
+	[STALL_ITLB]       = "I-TLB miss",
+	[STALL_DTLB]       = "D-TLB miss",
+	[STALL_MEMPORT]    = "memory port",
+};
+
+const char *StallCause_name(int cause)
+{
+	if (cause < 0 || cause >= STALL_CAUSES)
+		return NULL;
+	return stallCauseNames[cause];
+}
+
+
+
+void PrintPerfCounters(FILE *fp, PerfCounters *perf)
+{
+	fprintf(fp, "--- performance counters:\n");
+	fprintf(fp, "  cycles                = %lld\n", perf->cycles);
+	fprintf(fp, "  instructions retired  = %lld\n", perf->retired);
+	if (perf->retired > 0)
+		fprintf(fp, "  CPI                   = %.3f\n",
+		        (double)perf->cycles / perf->retired);
+	fprintf(fp, "  ---\n");
+	fprintf(fp, "  stalls (load-use)     = %lld\n", perf->stalls[STALL_LOAD_USE]);
+	fprintf(fp, "  stalls (I-cache miss) = %lld\n", perf->stalls[STALL_ICACHE]);
+	fprintf(fp, "  stalls (D-cache miss) = %lld\n", perf->stalls[STALL_DCACHE]);
+	fprintf(fp, "  stalls (mispredict)   = %lld\n", perf->stalls[STALL_MISPREDICT]);
+	fprintf(fp, "  stalls (ID operand)   = %lld\n", perf->stalls[STALL_ID_OPERAND]);
+	fprintf(fp, "  stalls (I-TLB miss)   = %lld\n", perf->stalls[STALL_ITLB]);
+	fprintf(fp, "  stalls (D-TLB miss)   = %lld\n", perf->stalls[STALL_DTLB]);
+	fprintf(fp, "  stalls (memory port)  = %lld\n", perf->stalls[STALL_MEMPORT]);
+	fprintf(fp, "  ---\n");
+	fprintf(fp, "  ALU input1 forwarded  = %lld from EX/MEM, %lld from MEM/WB\n",
+	        perf->forwardExMem[0], perf->forwardMemWb[0]);
+	fprintf(fp, "  ALU input2 forwarded  = %lld from EX/MEM, %lld from MEM/WB\n",
+	        perf->forwardExMem[1], perf->forwardMemWb[1]);
+	fprintf(fp, "  ---\n");
+	fprintf(fp, "  branches taken        = %lld\n", perf->branchesTaken);
+	fprintf(fp, "  branches not taken    = %lld\n", perf->branchesNotTaken);
+	fprintf(fp, "  jumps                 = %lld\n", perf->jumps);
+	fprintf(fp, "  ---\n");
+	fprintf(fp, "  retired, by instruction:\n");
+
+	int i;
+	for (i=0; i<OPCLASS_COUNT; i++)
+	{
+		if (perf->retiredByOp[i] == 0)
+			continue;
+
+		const char *name = OpClass_name(i);
+		if (name != NULL)
+			fprintf(fp, "    %-8s %lld\n", name, perf->retiredByOp[i]);
+		else if (i < 64)
+			fprintf(fp, "    op 0x%02x  %lld\n", i, perf->retiredByOp[i]);
+		else
+			fprintf(fp, "    fn 0x%02x  %lld\n", i-64, perf->retiredByOp[i]);
+	}
+}
+
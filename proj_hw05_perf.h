@@ -0,0 +1,67 @@
+#ifndef PROJ_HW05_PERF_H
+#define PROJ_HW05_PERF_H
+
+
+#include <stdio.h>
+
+
+
+/* every instruction gets an "op class", used to index the per-instruction
+ * histogram: I and J format instructions use their opcode (1-63), and R
+ * format instructions (including syscall) use 64+funct.
+ */
+#define OPCLASS(opcode, funct)  ((opcode) != 0 ? (opcode) : 64+(funct))
+#define OPCLASS_COUNT           128
+#define OPCLASS_NONE            0xff      // a bubble
+
+
+/* the reasons that the pipeline can stall */
+#define STALL_LOAD_USE          0         // IDtoIF_get_hazard(): an ALU input
+#define STALL_ICACHE            1         // IF waiting on an I-cache miss
+#define STALL_DCACHE            2         // MEM waiting on a D-cache miss
+#define STALL_MISPREDICT        3         // IF flushed after a misprediction
+#define STALL_ID_OPERAND        4         // a branch or syscall in ID waiting
+                                          // for a register (or a SW)
+#define STALL_ITLB              5         // IF waiting on an I-TLB miss
+#define STALL_DTLB              6         // MEM waiting on a D-TLB miss
+#define STALL_MEMPORT           7         // MEM waiting for another core to
+                                          // free the data memory port
+#define STALL_CAUSES            8
+
+
+/* counters for the pipelined model.  The simulator updates these every
+ * clock; they cost a handful of increments per clock.
+ *
+ * An instruction "retires" when it leaves WB; the syscall that ends the
+ * program also counts, even though it never gets past ID.
+ */
+typedef struct PerfCounters
+{
+	long long cycles;
+	long long retired;
+	long long retiredByOp[OPCLASS_COUNT];
+
+	long long stalls[STALL_CAUSES];       // cycles lost, by cause
+
+	// [0] is ALU input 1 (rs), [1] is input 2 (rt, for R format)
+	long long forwardExMem[2];
+	long long forwardMemWb[2];
+
+	// from IDtoIF_get_branchControl(), counted when the instruction issues
+	long long branchesTaken;
+	long long branchesNotTaken;
+	long long jumps;
+} PerfCounters;
+
+
+/* returns the mnemonic for an op class (or NULL if we don't know it) */
+const char *OpClass_name(int opClass);
+
+/* returns a short description of a STALL_* cause (or NULL) */
+const char *StallCause_name(int cause);
+
+void PrintPerfCounters(FILE *fp, PerfCounters *perf);
+
+
+#endif
+
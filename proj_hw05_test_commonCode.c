@@ -4,13 +4,14 @@
 
 #include "proj_hw05.h"
 #include "proj_hw05_test_commonCode.h"
+#include "proj_hw05_trace.h"
 
 
 
 int Test_ID(WORD pcPlus4, WORD instruction,
             WORD *regs,
             ID_EX *out,
-            ID_EX *old_idex)
+            ID_EX *old_idex, EX_MEM *old_exMem)
 {
 	WORD regs_save[34];
 	  memcpy(regs_save, regs, sizeof(regs_save));
@@ -20,12 +21,16 @@ int Test_ID(WORD pcPlus4, WORD instruction,
 
 	memset(out, -1, sizeof(*out));
 
-	// if the caller didn't provide an old ID/EX version, then we'll
-	// provide a NOP.
+	// if the caller didn't provide an old ID/EX or EX/MEM version, then
+	// we'll provide a NOP.
 	ID_EX nop;
+	EX_MEM nop_exMem;
 	  memset(&nop, 0, sizeof(nop));
+	  memset(&nop_exMem, 0, sizeof(nop_exMem));
 	if (old_idex == NULL)
 		old_idex = &nop;
+	if (old_exMem == NULL)
+		old_exMem = &nop_exMem;
 
 	ID_EX old_idex_save;
 	  memcpy(&old_idex_save, old_idex, sizeof(old_idex_save));
@@ -59,12 +64,16 @@ int Test_ID(WORD pcPlus4, WORD instruction,
 
 	printf("  ---\n");
 
-	int stall = IDtoIF_get_stall(&fields, old_idex);
+	// a branch can also wait on a LW in MEM, so look at both
+	int stall = (IDtoIF_get_hazard(&fields, old_idex, old_exMem) != HAZARD_NONE);
 	printf("  IDtoIF_get_stall = %d\n", stall);
 
+	// branches compare in ID, with the operands forwarded from EX/MEM
 	WORD rsVal = regs[fields.rs];
 	WORD rtVal = regs[fields.rt];
-	int branchControl = IDtoIF_get_branchControl(&fields, rsVal,rtVal);
+	int branchControl = IDtoIF_get_branchControl(&fields,
+	                        ID_getBranchOperand(fields.rs, rsVal, old_exMem),
+	                        ID_getBranchOperand(fields.rt, rtVal, old_exMem));
 	printf("  IDtoIF_get_branchControl = %d\n", branchControl);
 
 	WORD   jumpAddr =   calc_jumpAddr(pcPlus4, &fields);
@@ -167,6 +176,9 @@ void Test_EX(ID_EX *in, EX_MEM *out, EX_MEM *old_exMem, MEM_WB *old_memWb)
 	if (memcmp(&old_memWb_save, old_memWb, sizeof(*old_memWb)) != 0)
 		printf("ERROR: execute_EX() modified the (old) MEM_WB struct.\n");
 
+	// execute_EX() copied rtVal as it was read in ID; the SW data
+	// needs the same forwarding as the ALU inputs.
+	out->rtVal = EX_getStoreData(in, old_exMem, old_memWb);
 
 	printf("  ---\n");
 	printf("  EX_MEM.rtVal = 0x%04x_%04x\n",
@@ -194,13 +206,18 @@ void Test_MEM(EX_MEM *in, WORD *mem, int memSizeWords, MEM_WB *out)
 	EX_MEM in_save;
 	  memcpy(&in_save, in, sizeof(in_save));
 
-	WORD *mem_save = malloc(sizeof(WORD)*memSizeWords);
-	  memcpy(mem_save, mem, sizeof(WORD)*memSizeWords);
+	/* the only word that a SW may legally write is the one at the
+	 * ALU result; save it, so that we can report the old value.
+	 */
+	int  storeIndx = in->aluResult/4;
+	WORD mem_save  = 0;
+	if (storeIndx >= 0 && storeIndx < memSizeWords)
+		mem_save = mem[storeIndx];
 
 	memset(out, -1, sizeof(*out));
 
 
-	execute_MEM(in, mem, out);
+	int i = execute_MEM(in, mem, out);
 
 
 	if (memcmp(&in_save, in, sizeof(in_save)) != 0)
@@ -208,17 +225,22 @@ void Test_MEM(EX_MEM *in, WORD *mem, int memSizeWords, MEM_WB *out)
 
 
 	// memory modifications are normal - at least, for SW instructions
-	int i;
-	for (i=0; i<memSizeWords; i++)
-	if (mem[i] != mem_save[i])
+	if (i >= 0 && (i != storeIndx || i >= memSizeWords))
+	{
+		printf("ERROR: execute_MEM() reported a write to word %d, but EX_MEM.aluResult is 0x%04x_%04x\n",
+		       i,
+		       (in->aluResult >> 16) & 0xffff,
+		       (in->aluResult      ) & 0xffff);
+	}
+	else if (i >= 0 && mem[i] != mem_save)
 	{
 		int addr = i*4;
 
 		printf("  MEM CHANGED: Address=0x%04x_%04x   Was: 0x%04x_%04x Now: 0x%04x_%04x\n",
 		       (addr        >> 16) & 0xffff,
 		       (addr             ) & 0xffff,
-		       (mem_save[i] >> 16) & 0xffff,
-		       (mem_save[i]      ) & 0xffff,
+		       (mem_save    >> 16) & 0xffff,
+		       (mem_save         ) & 0xffff,
 		       (mem     [i] >> 16) & 0xffff,
 		       (mem     [i]      ) & 0xffff);
 		printf("\n");
@@ -237,7 +259,6 @@ void Test_MEM(EX_MEM *in, WORD *mem, int memSizeWords, MEM_WB *out)
 	printf("  MEM_WB.regWrite = %d\n", out->regWrite);
 	printf("\n");
 
-	free(mem_save);
 	return;
 }
 
@@ -316,7 +337,7 @@ void Test_Pipelined_FixedSequence(WORD *instructions, WORD *pcs, int instCount,
 		Test_WB(&memwb[0], regs);
 
 		printf("ID phase:\n");
-		Test_ID(pcs[i], instructions[i], regs, &idex[1], &idex[0]);
+		Test_ID(pcs[i], instructions[i], regs, &idex[1], &idex[0], &exmem[0]);
 
 		printf("EX phase:\n");
 		Test_EX (&idex[0], &exmem[1], &exmem[0], &memwb[0]);
@@ -336,6 +357,32 @@ void Test_Pipelined_FixedSequence(WORD *instructions, WORD *pcs, int instCount,
 
 
 
+/* a syscall reads $v0 and $a0 (and, for print_str, memory) straight
+ * from the register file in ID, with no forwarding; so it waits until
+ * nothing in EX or MEM is about to write any of them.
+ *
+ * The exit syscall (v0 == 10) also waits until EX and MEM are empty:
+ * nothing runs after it, so anything still in flight would be lost.
+ * v0 is only trustworthy once the checks above pass, which is why it
+ * is tested last.  (WB has already run by the time ID looks at this.)
+ */
+static inline int syscall_getStall(ID_EX *old_idex, EX_MEM *old_exMem, WORD v0)
+{
+	int exReg = old_idex->ALUsrc ? old_idex->rt : old_idex->rd;
+
+	if (old_idex->memWrite || old_exMem->memWrite)
+		return 1;
+	if (old_idex->regWrite && (exReg == 2 || exReg == 4))
+		return 1;
+	if (old_exMem->regWrite && (old_exMem->writeReg == 2 || old_exMem->writeReg == 4))
+		return 1;
+	if (v0 == 10 && (old_idex->regWrite || old_exMem->regWrite))
+		return 1;
+	return 0;
+}
+
+
+
 void Test_FullProcessor(WORD *instMemory, int instMemSizeWords,
                         WORD *regs,
                         WORD *dataMemory, int dataMemSizeWords,
@@ -390,12 +437,20 @@ void Test_FullProcessor(WORD *instMemory, int instMemSizeWords,
 
 		if (instructions[0] == SYSCALL())
 		{
+			// wait for its registers (and memory) to be written
+			if (syscall_getStall(&idex[0], &exmem[0], regs[2]))
+			{
+				printf("  syscall stalled\n");
+				stall = 1;
+			}
+
 			// handle syscalls locally
-			if (execSyscall(regs, dataMemory) != 0)
+			else if (execSyscall(regs, dataMemory) != 0)
 				return;
+			else
+				stall = 0;
 
 			// turn it into a NOP
-			stall = 0;
 			branchControl = 0;
 			memset(&idex[1], 0, sizeof(idex[1]));
 		}
@@ -406,12 +461,15 @@ void Test_FullProcessor(WORD *instMemory, int instMemSizeWords,
 
 			// see above.  [0] is the *OLD* value for the
 			// pipeline register, and [1] is the *NEW*
-			stall = IDtoIF_get_stall(&fields, &idex[0]);
+			int hazard = IDtoIF_get_hazard(&fields, &idex[0], &exmem[0]);
+			stall = (hazard != HAZARD_NONE);
 
 			rsVal = regs[fields.rs];
 			rtVal = regs[fields.rt];
 
-			branchControl = IDtoIF_get_branchControl(&fields, rsVal,rtVal);
+			branchControl = IDtoIF_get_branchControl(&fields,
+			                    ID_getBranchOperand(fields.rs, rsVal, &exmem[0]),
+			                    ID_getBranchOperand(fields.rt, rtVal, &exmem[0]));
 
 			branchAddr = calc_branchAddr(pcs[0]+4, &fields);
 			jumpAddr   = calc_jumpAddr  (pcs[0]+4, &fields);
@@ -420,12 +478,15 @@ void Test_FullProcessor(WORD *instMemory, int instMemSizeWords,
 			int rc = Test_ID( pcs[0]+4, instructions[0],
 			                  regs,
 			                 &idex[1],
-			                 &idex[0]);
+			                 &idex[0], &exmem[0]);
 			if (rc == 0)
 			{
 				printf("Test_FullProcessor(): Ending program because execute_ID() returned %d\n", rc);
 				return;
 			}
+
+			if (hazard == HAZARD_BRANCH)
+				printf("  branch stalled\n");
 		}
 
 		// figure out the proper PC for the new IF/ID; also, fill in
@@ -466,6 +527,7 @@ void Test_FullProcessor(WORD *instMemory, int instMemSizeWords,
 		Test_EX (&idex[0], &exmem[1], &exmem[0], &memwb[0]);
 
 		printf("MEM phase:\n");
+		exmem[0].rtVal = MEM_getStoreData(&exmem[0], &memwb[0]);
 		Test_MEM(&exmem[0], dataMemory, dataMemSizeWords, &memwb[1]);
 
 
@@ -483,131 +545,1385 @@ void Test_FullProcessor(WORD *instMemory, int instMemSizeWords,
 
 
 
-void ExecProcessor(WORD *instMemory, int instMemSizeWords,
-                   WORD *regs,
-                   WORD *dataMemory, int dataMemSizeWords,
-                   WORD  codeOffset)
+void predecode_instruction(WORD instruction, DecodedInst *out)
 {
-	/* this is basically the same function as Test_FullProcessor(),
-	 * except that it calls the user functions directly, instead of
-	 * using the Test*() functions (which do too much printing).
+	ID_EX other;
+
+	memset(out, 0, sizeof(*out));
+	extract_instructionFields(instruction, &out->fields);
+
+	/* decode twice, with different register values; any field which
+	 * changes is one that execute_ID() copies from rsVal/rtVal.
 	 */
+	out->rc = execute_ID(0, &out->fields,  0, 0, &out->ctrl);
+	          execute_ID(0, &out->fields, -1,-1, &other);
 
-	WORD   instructions[2], pcs[2];
-	ID_EX  idex [2];
-	EX_MEM exmem[2];
-	MEM_WB memwb[2];
+	out->passRsVal = (other.rsVal != out->ctrl.rsVal);
+	out->passRtVal = (other.rtVal != out->ctrl.rtVal);
 
-	instructions[0] = instructions[1] = pcs[0] = pcs[1] = 0;
-	memset(idex , 0, sizeof(idex));
-	memset(exmem, 0, sizeof(exmem));
-	memset(memwb, 0, sizeof(memwb));
+	out->opClass = OPCLASS(out->fields.opcode, out->fields.funct);
+	out->valid = 1;
+}
 
-	pcs[0]          = codeOffset;
-	instructions[0] = instMemory[0];
 
-	while (1)
+
+int execute_ID_decoded(int IDstall,
+                       DecodedInst *dec,
+                       WORD rsVal, WORD rtVal,
+                       ID_EX *new_idex)
+{
+	// stalls are rare; let execute_ID() build the bubble
+	if (IDstall)
+		return execute_ID(1, &dec->fields, rsVal,rtVal, new_idex);
+
+	*new_idex = dec->ctrl;
+	if (dec->passRsVal)
+		new_idex->rsVal = rsVal;
+	if (dec->passRtVal)
+		new_idex->rtVal = rtVal;
+
+	return dec->rc;
+}
+
+
+
+/* ExecProcessor(), ExecFunctional() and ExecSampled() all share this
+ * state: the caller's memories and registers, plus the predecode cache.
+ * If 'paged' is set, it is the data memory, and dataMemory is unused.
+ */
+typedef struct SimState
+{
+	const char  *name;               // used in error messages
+	WORD        *instMemory;
+	int          instMemSizeWords;
+	WORD        *regs;
+	WORD        *dataMemory;
+	int          dataMemSizeWords;
+	GuestMemory *paged;              // NULL for the flat dataMemory
+	Mmu         *mmu;                // NULL for no translation
+	WORD         codeOffset;
+	DecodedInst *decoded;            // one per word of instMemory
+
+	Tracer      *trace;              // NULL unless tracing
+	uint64_t     traceCycle;
+
+	PerfCounters *perf;              // never NULL
+	PerfCounters  ownPerf;           // used if the caller doesn't want them
+
+	FILE         *out;               // syscall output, and run-time errors
+
+	Cache        *icache, *dcache;   // NULL for a perfect memory
+	Predictor    *bpred;             // NULL for free branches
+	Tlb          *itlb, *dtlb;       // NULL for no TLB misses
+
+	Reservation  *resv;              // never NULL
+	Reservation   ownResv;           // used if there's no MachineState
+	Multicore    *mc;                // NULL unless other cores share memory
+} SimState;
+
+#define SIM_RUNNING 0
+#define SIM_HALTED  1
+
+static void sim_init(SimState *s, const char *name,
+                     WORD *instMemory, int instMemSizeWords,
+                     WORD *regs,
+                     WORD *dataMemory, int dataMemSizeWords,
+                     WORD  codeOffset)
+{
+	s->name             = name;
+	s->instMemory       = instMemory;
+	s->instMemSizeWords = instMemSizeWords;
+	s->regs             = regs;
+	s->dataMemory       = dataMemory;
+	s->dataMemSizeWords = dataMemSizeWords;
+	s->paged            = NULL;
+	s->mmu              = NULL;
+	s->codeOffset       = codeOffset;
+	s->trace            = NULL;
+	s->traceCycle       = 0;
+
+	s->decoded          = NULL;
+	s->out              = stdout;
+	s->icache           = NULL;
+	s->dcache           = NULL;
+	s->bpred            = NULL;
+	s->itlb             = NULL;
+	s->dtlb             = NULL;
+
+	s->ownResv.valid    = 0;
+	s->resv             = &s->ownResv;
+	s->mc               = NULL;
+
+	memset(&s->ownPerf, 0, sizeof(s->ownPerf));
+	s->perf = &s->ownPerf;
+}
+
+static int sim_open(SimState *s, const char *name,
+                    WORD *instMemory, int instMemSizeWords,
+                    WORD *regs,
+                    WORD *dataMemory, int dataMemSizeWords,
+                    WORD  codeOffset)
+{
+	sim_init(s, name, instMemory, instMemSizeWords, regs,
+	         dataMemory, dataMemSizeWords, codeOffset);
+
+	s->decoded = calloc(instMemSizeWords, sizeof(DecodedInst));
+	if (s->decoded == NULL)
 	{
-		execute_WB(&memwb[0], regs);
+		printf("%s(): Could not allocate the predecode cache.\n", name);
+		return -1;
+	}
+	return 0;
+}
 
-		int stall, branchControl;
-		WORD rsVal, rtVal;
-		WORD branchAddr, jumpAddr;
+/* the physical address for 'addr': the same, unless there is an MMU */
+static inline WORD sim_physAddr(SimState *s, WORD addr)
+{
+	if (s->mmu != NULL)
+		return Mmu_translate(s->mmu, addr);
+	return addr;
+}
 
-		if (instructions[0] == SYSCALL())
-		{
-			if (execSyscall(regs, dataMemory) != 0)
-				return;
+/* sends the fetch of 'pc' to the I-TLB and I-cache, and sets how long
+ * IF/ID has to wait for it
+ */
+static inline void sim_fetch(SimState *s, PipelineRegs *r, WORD pc)
+{
+	r->fetchTlbWait = 0;
+	if (s->itlb != NULL)
+		r->fetchTlbWait = Tlb_access(s->itlb, pc);
 
-			/* pretend that "something" happened - and that
-			 * NOP is the correct operation to pass forward
-			 * through EX.
-			 */
-			stall = 0;
-			branchControl = 0;
-			memset(&idex[1], 0, sizeof(idex[1]));
-		}
-		else
+	r->fetchWait = r->fetchTlbWait;
+	if (s->icache != NULL)
+		r->fetchWait += Cache_access(s->icache, sim_physAddr(s, pc), 0);
+}
+
+/* the same, for a MachineState: it keeps its predecode cache and its
+ * counters from one call to the next.  There is no sim_close() for these;
+ * see FreeMachine().
+ */
+static int sim_openMachine(SimState *s, const char *name, MachineState *m)
+{
+	sim_init(s, name, m->instMemory, m->instMemSizeWords, m->regs,
+	         m->dataMemory, m->dataMemSizeWords, m->codeOffset);
+
+	if (m->decoded == NULL)
+	{
+		m->decoded = calloc(m->instMemSizeWords, sizeof(DecodedInst));
+		if (m->decoded == NULL)
 		{
-			InstructionFields fields;
-			extract_instructionFields(instructions[0], &fields);
+			printf("%s(): Could not allocate the predecode cache.\n", name);
+			return -1;
+		}
+	}
 
-			// see above.  [0] is the *OLD* value for the
-			// pipeline register, and [1] is the *NEW*
-			stall = IDtoIF_get_stall(&fields, &idex[0]);
+	s->decoded = m->decoded;
+	s->perf    = &m->perf;
+	if (m->out != NULL)
+		s->out = m->out;
+
+	s->icache = m->icache;
+	s->dcache = m->dcache;
+	s->bpred  = m->bpred;
+	s->paged  = m->pagedMemory;
+	s->itlb   = m->itlb;
+	s->dtlb   = m->dtlb;
+	s->resv   = &m->resv;
+
+	s->mmu = m->mmu;
+	if (s->mmu != NULL)
+		s->paged = s->mmu->phys;
+
+	/* InitMachine() put the first instruction straight into IF/ID; if
+	 * there is an I-TLB or I-cache, that fetch has to go through it, too.
+	 */
+	if ((s->icache != NULL || s->itlb != NULL) &&
+	    m->cycles == 0 && m->pipe[0].fetchWait == 0)
+	{
+		sim_fetch(s, &m->pipe[0], m->pipe[0].pc);
+	}
+	return 0;
+}
 
-			rsVal = regs[fields.rs];
-			rtVal = regs[fields.rt];
+static void sim_close(SimState *s)
+{
+	free(s->decoded);
+	s->decoded = NULL;
+}
 
-			branchControl = IDtoIF_get_branchControl(&fields, rsVal,rtVal);
 
-			branchAddr = calc_branchAddr(pcs[0]+4, &fields);
-			jumpAddr   = calc_jumpAddr  (pcs[0]+4, &fields);
+/* returns the index into instMemory for 'pc', or -1 if the PC is not
+ * inside the program.
+ */
+static inline int sim_instIndex(SimState *s, WORD pc)
+{
+	int instIndx = (pc - s->codeOffset)/4;
 
-			int rc = execute_ID( stall,
-			                    &fields,
-			                     rsVal,rtVal,
-			                    &idex[1]);
-			if (rc == 0)
-			{
-				printf("ExecProcessor(): Ending program because execute_ID() returned %d\n", rc);
-				return;
-			}
-		}
+	if (instIndx <  0                   ||
+	    instIndx >= s->instMemSizeWords ||
+	    pc % 4 != 0)
+	{
+		return -1;
+	}
+	return instIndx;
+}
 
-		if (stall)
+
+static inline DecodedInst *sim_decode(SimState *s, int instIndx, WORD instruction)
+{
+	DecodedInst *dec = &s->decoded[instIndx];
+	if (!dec->valid)
+	{
+		predecode_instruction(instruction, dec);
+
+		/* if a SW overwrote this word after we fetched it, then use
+		 * the decode for this one cycle, but don't keep it.
+		 */
+		dec->valid = (s->instMemory[instIndx] == instruction);
+	}
+	return dec;
+}
+
+
+/* if the caller handed us the same buffer for code and data, then a SW
+ * can overwrite an instruction; throw away the stale decode.  Call this
+ * with the return value from execute_MEM().
+ */
+static inline void sim_checkStore(SimState *s, int writtenIndx)
+{
+	if (writtenIndx >= 0 && s->paged == NULL)
+	{
+		WORD *dest = s->dataMemory + writtenIndx;
+		if (dest >= s->instMemory && dest < s->instMemory+s->instMemSizeWords)
+			s->decoded[dest - s->instMemory].valid = 0;
+	}
+}
+
+
+/* the host page holding data address 'addr', for paged memory (through
+ * the MMU, if there is one); NULL if we're out of memory
+ */
+static inline WORD *sim_dataPage(SimState *s, uint32_t addr)
+{
+	if (s->mmu != NULL)
+		return Mmu_hostPage(s->mmu, addr);
+	return GuestMem_page(s->paged, addr);
+}
+
+/* ll and sc (extra3 in EX/MEM).  An ll reserves its word.  An sc uses up
+ * the reservation, and if it didn't hold one on its own word, it goes to
+ * execute_MEM() with memWrite cleared, which fails it.  Returns the EX/MEM
+ * register to use; 'copy' is the space for a changed one.
+ */
+static EX_MEM *sim_linked(SimState *s, EX_MEM *in, EX_MEM *copy)
+{
+	uint32_t indx = (uint32_t)in->aluResult / 4;
+
+	if (in->memRead)
+	{
+		s->resv->valid = 1;
+		s->resv->indx  = indx;
+		return in;
+	}
+
+	int held = s->resv->valid && s->resv->indx == indx;
+	s->resv->valid = 0;
+	if (held)
+		return in;
+
+	*copy = *in;
+	copy->memWrite = 0;
+	return copy;
+}
+
+/* a store to word 'indx' takes away every other core's reservation on it */
+static void sim_breakReservations(SimState *s, int indx)
+{
+	int i;
+	for (i=0; i < s->mc->coreCount; i++)
+	{
+		Reservation *r = &s->mc->cores[i]->resv;
+		if (r != s->resv && r->valid && r->indx == (uint32_t)indx)
+			r->valid = 0;
+	}
+}
+
+/* runs execute_MEM() on whichever data memory we have.  For paged memory,
+ * execute_MEM() only sees the one page, with aluResult turned into the
+ * offset in that page.  Either way, '*written' is the index of the word
+ * written (counting from address 0), or -1.
+ *
+ * Returns SIM_HALTED if the page couldn't be allocated.
+ */
+static inline int sim_accessData(SimState *s, EX_MEM *in, MEM_WB *out, int *written)
+{
+	if (s->paged == NULL || !(in->memToReg || in->memWrite))
+	{
+		*written = execute_MEM(in, s->dataMemory, out);
+		return SIM_RUNNING;
+	}
+
+	uint32_t addr = (uint32_t)in->aluResult;
+	WORD    *page = sim_dataPage(s, addr);
+	if (page == NULL)
+	{
+		fprintf(s->out, "%s(): Ending program because there is no memory for address 0x%08x\n",
+		        s->name, addr);
+		return SIM_HALTED;
+	}
+
+	EX_MEM local = *in;
+	local.aluResult = addr & GMEM_PAGE_MASK;
+
+	int indx = execute_MEM(&local, page, out);
+	out->aluResult = in->aluResult;
+
+	*written = (indx < 0) ? -1 : (int)((addr & ~(uint32_t)GMEM_PAGE_MASK)/4) + indx;
+	return SIM_RUNNING;
+}
+
+/* the MEM phase: sim_accessData(), plus the reservations for ll/sc */
+static inline int sim_execMEM(SimState *s, EX_MEM *in, MEM_WB *out, int *written)
+{
+	EX_MEM copy;
+	if (in->extra3)
+		in = sim_linked(s, in, &copy);
+
+	if (sim_accessData(s, in, out, written) != SIM_RUNNING)
+		return SIM_HALTED;
+
+	if (s->mc != NULL && *written >= 0)
+		sim_breakReservations(s, *written);
+	return SIM_RUNNING;
+}
+
+/* one word of data memory, by index; for tracing */
+static inline WORD sim_readData(SimState *s, int indx)
+{
+	if (s->paged != NULL)
+	{
+		uint32_t addr = (uint32_t)indx*4;
+		WORD    *page = sim_dataPage(s, addr);
+		return (page != NULL) ? page[(addr & GMEM_PAGE_MASK)/4] : 0;
+	}
+	return s->dataMemory[indx];
+}
+
+/* execSyscallTo(), on whichever data memory we have.  Only print_str
+ * reads memory; with paged memory, the string can cross pages.
+ */
+static int sim_syscall(SimState *s)
+{
+	WORD *regs = s->regs;
+
+	if (s->paged != NULL && regs[2] == 4)
+	{
+		uint32_t addr = regs[4];
+		while (1)
 		{
-			/* in a stall, the IF/ID register doesn't change;
-			 * nor do the program counter or instruction
-			 */
-			instructions[1] = instructions[0];
-			pcs         [1] = pcs         [0];
+			WORD *page = sim_dataPage(s, addr);
+			int   c    = (page != NULL) ? ((unsigned char*)page)[addr & GMEM_PAGE_MASK] : 0;
+			if (c == 0)
+				break;
+			fputc(c, s->out);
+			addr++;
 		}
-		else
-		{
-			if (branchControl == 1)
-				pcs[1] = branchAddr;
-			else if (branchControl == 2)
-				pcs[1] = jumpAddr;
-			else if (branchControl == 3)
-				pcs[1] = rsVal;
-			else
-				pcs[1] = pcs[0]+4;
+		return 0;
+	}
 
-			int instIndx = (pcs[1] - codeOffset)/4;
+	return execSyscallTo(s->out, regs, s->dataMemory);
+}
 
-			if (instIndx <  0                ||
-			    instIndx >= instMemSizeWords ||
-			    pcs[1] % 4 != 0)
-			{
-				printf("ERROR: Invalid Program Counter 0x%08x\n", pcs[0]);
-				return;
-			}
 
-			instructions[1] = instMemory[instIndx];
+
+/* tracing: trace_begin() is called at the start of the clock, to save
+ * the old values of anything that WB and MEM might overwrite;
+ * trace_end() fills in the rest once the clock is complete.
+ */
+static TraceRecord *trace_begin(SimState *s, PipelineRegs *cur)
+{
+	TraceRecord *rec = Trace_reserve(s->trace);
+
+	rec->cycle       = s->traceCycle;
+	rec->pc          = cur->pc;
+	rec->instruction = cur->instruction;
+
+	rec->regNum = 0xff;
+	if (cur->memwb.regWrite)
+	{
+		rec->regNum = cur->memwb.writeReg;
+		rec->regOld = s->regs[rec->regNum];
+	}
+
+	rec->memOld = 0;
+	if (cur->exmem.memWrite)
+		rec->memOld = sim_readData(s, (uint32_t)cur->exmem.aluResult/4);
+
+	return rec;
+}
+
+static void trace_end(SimState *s, TraceRecord *rec,
+                      PipelineRegs *cur, PipelineRegs *next,
+                      int stall, int stallCause, int branchControl,
+                      WORD aluInput1, WORD aluInput2,
+                      int written)
+{
+	rec->flags = 0;
+	if (stall)
+		rec->flags |= TRACE_STALL | TRACE_SET_CAUSE(stallCause);
+	if (cur->instruction == SYSCALL())
+		rec->flags |= TRACE_SYSCALL;
+
+	rec->branchControl = branchControl;
+
+	rec->fwd1 = EX_getForwardSource(cur->idex.rs, &cur->exmem, &cur->memwb);
+	rec->fwd2 = FWD_NONE;
+	if (cur->idex.ALUsrc == 0)
+		rec->fwd2 = EX_getForwardSource(cur->idex.rt, &cur->exmem, &cur->memwb);
+	rec->aluInput1 = aluInput1;
+	rec->aluInput2 = aluInput2;
+
+	if (rec->regNum != 0xff)
+		rec->regNew = s->regs[rec->regNum];
+
+	rec->memIndx = written;
+	rec->memNew  = (written >= 0) ? sim_readData(s, written) : 0;
+
+	rec->idex  = next->idex;
+	rec->exmem = next->exmem;
+	rec->memwb = next->memwb;
+
+	Trace_commit(s->trace);
+	s->traceCycle++;
+}
+
+
+
+/* empties the pipeline (every register is a NOP), and puts the
+ * instruction at 'pc' into IF/ID.  'pc' must be a valid PC.
+ */
+static void pipeline_reset(SimState *s, PipelineRegs *cur, PipelineRegs *next,
+                           WORD pc)
+{
+	memset(cur,  0, sizeof(*cur));
+	memset(next, 0, sizeof(*next));
+	memset(cur->opClass,  OPCLASS_NONE, sizeof(cur->opClass));
+	memset(next->opClass, OPCLASS_NONE, sizeof(next->opClass));
+
+	cur->pc          = pc;
+	cur->instruction = s->instMemory[sim_instIndex(s, pc)];
+}
+
+
+/* runs one clock of the pipeline, reading 'cur' and writing all of 'next'.
+ * The caller swaps the two afterwards.
+ *
+ * If 'drain' is set, ID does not issue the instruction in IF/ID; it sends
+ * a bubble into EX instead (and IF/ID holds, like a stall).  This lets the
+ * instructions already in the pipeline finish.  ID does the same while IF
+ * is being flushed after a branch misprediction, or is waiting on an
+ * I-TLB or I-cache miss.
+ *
+ * While MEM is waiting on a D-TLB or D-cache miss, nothing moves at all:
+ * the clock just copies 'cur' to 'next'.
+ *
+ * '*issued' is set to 1 if an instruction left ID this clock.
+ */
+static inline int pipeline_clock(SimState *s,
+                                 PipelineRegs *cur, PipelineRegs *next,
+                                 int drain, int *issued)
+{
+	WORD *regs = s->regs;
+	PerfCounters *perf = s->perf;
+
+	/* MEM sends its access to the D-TLB and D-cache once; if either
+	 * misses, the pipeline holds until the translation and the line
+	 * arrive.
+	 */
+	if ((s->dcache != NULL || s->dtlb != NULL) && !cur->memStarted &&
+	    (cur->exmem.memToReg || cur->exmem.memWrite))
+	{
+		WORD addr = cur->exmem.aluResult;
+		int  tlbWait = 0, wait = 0;
+
+		if (s->dtlb != NULL)
+			tlbWait = Tlb_access(s->dtlb, addr);
+		if (s->dcache != NULL)
+			wait = Cache_access(s->dcache, sim_physAddr(s, addr),
+			                    cur->exmem.memWrite);
+		if (tlbWait + wait > 0)
+		{
+			cur->memStarted = 1;
+			cur->memWait    = tlbWait + wait;
+			cur->memTlbWait = tlbWait;
 		}
+	}
+
+	if (cur->memWait > 0)
+	{
+		perf->cycles++;
+		perf->stalls[cur->memTlbWait > 0 ? STALL_DTLB : STALL_DCACHE]++;
 
-		WORD aluInput1 = EX_getALUinput1(&idex[0], &exmem[0], &memwb[0]);
-		WORD aluInput2 = EX_getALUinput2(&idex[0], &exmem[0], &memwb[0]);
+		*next = *cur;
+		next->memWait--;
+		if (next->memTlbWait > 0)
+			next->memTlbWait--;
 
-		execute_EX (&idex [0], aluInput1,aluInput2, &exmem[1]);
-		execute_MEM(&exmem[0], dataMemory, &memwb[1]);
+		*issued = 0;
+		return SIM_RUNNING;
+	}
 
+	TraceRecord *rec = NULL;
+	if (s->trace != NULL)
+		rec = trace_begin(s, cur);
 
-		// copy each [1] back into [0] to be the input for the next
-		// clock cycle.
-		memcpy(&instructions[0], &instructions[1],
-		                      sizeof(instructions[0]));
-		memcpy(&pcs  [0], &pcs  [1], sizeof(pcs  [0]));
-		memcpy(&idex [0], &idex [1], sizeof(idex [0]));
-		memcpy(&exmem[0], &exmem[1], sizeof(exmem[0]));
-		memcpy(&memwb[0], &memwb[1], sizeof(memwb[0]));
+	perf->cycles++;
+
+	if (cur->opClass[2] != OPCLASS_NONE)
+	{
+		perf->retired++;
+		perf->retiredByOp[cur->opClass[2]]++;
 	}
-}
 
+	execute_WB(&cur->memwb, regs);
 
+	int stall, branchControl;
+	int stallCause = STALL_LOAD_USE;
+	int opClass;
+	WORD rsVal, rtVal;
+	WORD branchAddr, jumpAddr;
 
-int execSyscall(WORD *regs, WORD *dataMemory)
+	if (drain || cur->flushWait > 0 || cur->fetchWait > 0)
+	{
+		stall = 1;
+		if (cur->flushWait > 0)
+			stallCause = STALL_MISPREDICT;
+		else if (cur->fetchWait > 0)
+			stallCause = (cur->fetchTlbWait > 0) ? STALL_ITLB : STALL_ICACHE;
+		branchControl = 0;
+		opClass = OPCLASS_NONE;
+		memset(&next->idex, 0, sizeof(next->idex));
+	}
+	else if (cur->instruction == SYSCALL())
+	{
+		opClass = OPCLASS(0x00, 0x0c);
+
+		stall = syscall_getStall(&cur->idex, &cur->exmem, regs[2]);
+		stallCause = STALL_ID_OPERAND;
+
+		if (!stall && sim_syscall(s) != 0)
+		{
+			perf->retired++;
+			perf->retiredByOp[opClass]++;
+			return SIM_HALTED;
+		}
+
+		/* pretend that "something" happened - and that
+		 * NOP is the correct operation to pass forward
+		 * through EX.
+		 */
+		branchControl = 0;
+		memset(&next->idex, 0, sizeof(next->idex));
+	}
+	else
+	{
+		/* cur->pc was range-checked when it was fetched, so
+		 * this is always a valid index.
+		 */
+		DecodedInst *dec = sim_decode(s, (cur->pc - s->codeOffset)/4,
+		                              cur->instruction);
+
+		InstructionFields *fields = &dec->fields;
+		opClass = dec->opClass;
+
+		int hazard = IDtoIF_get_hazard(fields, &cur->idex, &cur->exmem);
+		stall = (hazard != HAZARD_NONE);
+		if (hazard == HAZARD_BRANCH)
+			stallCause = STALL_ID_OPERAND;
+
+		rsVal = regs[fields->rs];
+		rtVal = regs[fields->rt];
+
+		branchControl = IDtoIF_get_branchControl(fields,
+		                    ID_getBranchOperand(fields->rs, rsVal, &cur->exmem),
+		                    ID_getBranchOperand(fields->rt, rtVal, &cur->exmem));
+
+		branchAddr = calc_branchAddr(cur->pc+4, fields);
+		jumpAddr   = calc_jumpAddr  (cur->pc+4, fields);
+
+		int rc = execute_ID_decoded( stall,
+		                             dec,
+		                             rsVal,rtVal,
+		                            &next->idex);
+		if (rc == 0)
+		{
+			fprintf(s->out, "%s(): Ending program because execute_ID() returned %d\n", s->name, rc);
+			return SIM_HALTED;
+		}
+	}
+
+	if (stall)
+	{
+		/* in a stall, the IF/ID register doesn't change;
+		 * nor do the program counter or instruction
+		 */
+		next->instruction  = cur->instruction;
+		next->pc           = cur->pc;
+		next->fetchWait    = 0;
+		next->fetchTlbWait = 0;
+		next->flushWait    = 0;
+
+		// the refetch after a flush can miss in the I-cache, too
+		if (cur->flushWait > 0)
+		{
+			next->flushWait    = cur->flushWait-1;
+			next->fetchWait    = cur->fetchWait;
+			next->fetchTlbWait = cur->fetchTlbWait;
+		}
+		else if (cur->fetchWait > 0)
+		{
+			next->fetchWait = cur->fetchWait-1;
+			if (cur->fetchTlbWait > 0)
+				next->fetchTlbWait = cur->fetchTlbWait-1;
+		}
+
+		if (!drain)
+			perf->stalls[stallCause]++;
+	}
+	else
+	{
+		if (branchControl == 1)
+		{
+			next->pc = branchAddr;
+			perf->branchesTaken++;
+		}
+		else if (branchControl == 2)
+		{
+			next->pc = jumpAddr;
+			perf->jumps++;
+		}
+		else if (branchControl == 3)
+		{
+			next->pc = rsVal;
+			perf->jumps++;
+		}
+		else
+		{
+			next->pc = cur->pc+4;
+			if (opClass == OPCLASS(0x04,0) || opClass == OPCLASS(0x05,0))
+				perf->branchesNotTaken++;
+		}
+
+		int instIndx = sim_instIndex(s, next->pc);
+		if (instIndx < 0)
+		{
+			fprintf(s->out, "ERROR: Invalid Program Counter 0x%08x\n", cur->pc);
+			return SIM_HALTED;
+		}
+
+		next->instruction = s->instMemory[instIndx];
+
+		sim_fetch(s, next, next->pc);
+
+		next->flushWait = 0;
+		if (s->bpred != NULL)
+		{
+			int isBranch = (opClass == OPCLASS(0x04,0) || opClass == OPCLASS(0x05,0));
+			if (isBranch || branchControl != 0)
+				next->flushWait = Predictor_resolve(s->bpred, cur->pc, isBranch,
+				                                    branchControl != 0, next->pc);
+		}
+	}
+
+	next->memStarted = 0;
+	next->memWait    = 0;
+	next->memTlbWait = 0;
+
+	// the op class follows its instruction down the pipeline
+	next->opClass[0] = stall ? OPCLASS_NONE : opClass;
+	next->opClass[1] = cur->opClass[0];
+	next->opClass[2] = cur->opClass[1];
+
+	WORD aluInput1 = EX_getALUinput1(&cur->idex, &cur->exmem, &cur->memwb);
+	WORD aluInput2 = EX_getALUinput2(&cur->idex, &cur->exmem, &cur->memwb);
+
+	if (cur->opClass[0] != OPCLASS_NONE)
+	{
+		int fwd1 = EX_getForwardSource(cur->idex.rs, &cur->exmem, &cur->memwb);
+		perf->forwardExMem[0] += (fwd1 == FWD_EXMEM);
+		perf->forwardMemWb[0] += (fwd1 == FWD_MEMWB);
+
+		if (cur->idex.ALUsrc == 0)
+		{
+			int fwd2 = EX_getForwardSource(cur->idex.rt, &cur->exmem, &cur->memwb);
+			perf->forwardExMem[1] += (fwd2 == FWD_EXMEM);
+			perf->forwardMemWb[1] += (fwd2 == FWD_MEMWB);
+		}
+	}
+
+	execute_EX (&cur->idex , aluInput1,aluInput2, &next->exmem);
+	next->exmem.rtVal = EX_getStoreData(&cur->idex, &cur->exmem, &cur->memwb);
+
+	// a SW gets its data forwarded once more, in MEM
+	EX_MEM *memIn = &cur->exmem, store;
+	if (cur->exmem.memWrite)
+	{
+		store       = cur->exmem;
+		store.rtVal = MEM_getStoreData(&cur->exmem, &cur->memwb);
+		memIn       = &store;
+	}
+	int written;
+	if (sim_execMEM(s, memIn, &next->memwb, &written) != SIM_RUNNING)
+		return SIM_HALTED;
+
+	sim_checkStore(s, written);
+
+	if (rec != NULL)
+		trace_end(s, rec, cur,next, stall, drain ? -1 : stallCause, branchControl,
+		          aluInput1,aluInput2, written);
+
+	*issued = !stall;
+	return SIM_RUNNING;
+}
+
+
+/* clocks the pipeline until 'maxIssued' instructions have left ID, or
+ * for 'maxCycles' clocks, or until the program ends.  A negative limit
+ * means "no limit".  '*cycles' and '*issuedCount' are incremented as we
+ * go.
+ *
+ * 'cur' and 'next' are swapped every clock; on return, *cur holds the
+ * pipeline registers for the start of the next clock.
+ */
+static int pipeline_run(SimState *s, PipelineRegs **cur, PipelineRegs **next,
+                        long long maxIssued, long long maxCycles,
+                        long long *cycles, long long *issuedCount)
+{
+	PipelineRegs *c = *cur, *n = *next;
+	long long count = 0, clocks = 0;
+	int status = SIM_RUNNING;
+
+	while ((maxIssued < 0 || count  < maxIssued) &&
+	       (maxCycles < 0 || clocks < maxCycles))
+	{
+		int issued;
+
+		status = pipeline_clock(s, c,n, 0, &issued);
+		if (status != SIM_RUNNING)
+			break;
+
+		// every field of 'n' has been written this clock, so it
+		// becomes the input for the next clock cycle.
+		PipelineRegs *tmp = c;
+		c = n;
+		n = tmp;
+
+		count  += issued;
+		clocks++;
+	}
+
+	*cur  = c;
+	*next = n;
+	*cycles      += clocks;
+	*issuedCount += count;
+	return status;
+}
+
+
+/* lets every instruction which has already left ID finish WB.  Afterwards
+ * the pipeline is empty, all of the architectural state is up to date, and
+ * cur->pc is the next instruction to execute.
+ */
+static void pipeline_drain(SimState *s, PipelineRegs **cur, PipelineRegs **next)
+{
+	int i, issued;
+
+	// ID/EX, EX/MEM and MEM/WB: three clocks to get the last one out
+	for (i=0; i<3; i++)
+	{
+		pipeline_clock(s, *cur,*next, 1, &issued);
+
+		PipelineRegs *tmp = *cur;
+		*cur  = *next;
+		*next = tmp;
+	}
+}
+
+
+/* executes a single instruction (through all of the phases), and moves
+ * '*pc' to the next instruction.
+ */
+static inline int functional_step(SimState *s, WORD *pc)
+{
+	// never written; they just stand for "nothing to forward"
+	static EX_MEM noExMem;
+	static MEM_WB noMemWb;
+
+	ID_EX  idex;
+	EX_MEM exmem;
+	MEM_WB memwb;
+
+	WORD *regs     = s->regs;
+	int   instIndx = (*pc - s->codeOffset)/4;
+
+	WORD instruction = s->instMemory[instIndx];
+	WORD nextPC      = *pc+4;
+
+	if (instruction == SYSCALL())
+	{
+		if (sim_syscall(s) != 0)
+			return SIM_HALTED;
+	}
+	else
+	{
+		DecodedInst *dec = sim_decode(s, instIndx, instruction);
+
+		InstructionFields *fields = &dec->fields;
+
+		WORD rsVal = regs[fields->rs];
+		WORD rtVal = regs[fields->rt];
+
+		int branchControl = IDtoIF_get_branchControl(fields, rsVal,rtVal);
+
+		if (branchControl == 1)
+			nextPC = calc_branchAddr(*pc+4, fields);
+		else if (branchControl == 2)
+			nextPC = calc_jumpAddr  (*pc+4, fields);
+		else if (branchControl == 3)
+			nextPC = rsVal;
+
+		int rc = execute_ID_decoded(0, dec, rsVal,rtVal, &idex);
+		if (rc == 0)
+		{
+			fprintf(s->out, "%s(): Ending program because execute_ID() returned %d\n", s->name, rc);
+			return SIM_HALTED;
+		}
+
+		WORD aluInput1 = EX_getALUinput1(&idex, &noExMem, &noMemWb);
+		WORD aluInput2 = EX_getALUinput2(&idex, &noExMem, &noMemWb);
+
+		execute_EX (&idex , aluInput1,aluInput2, &exmem);
+		int written;
+		if (sim_execMEM(s, &exmem, &memwb, &written) != SIM_RUNNING)
+			return SIM_HALTED;
+		execute_WB (&memwb, regs);
+
+		sim_checkStore(s, written);
+	}
+
+	if (sim_instIndex(s, nextPC) < 0)
+	{
+		fprintf(s->out, "ERROR: Invalid Program Counter 0x%08x\n", *pc);
+		return SIM_HALTED;
+	}
+
+	*pc = nextPC;
+	return SIM_RUNNING;
+}
+
+
+/* runs up to 'maxInsts' instructions (or forever, if it is negative) */
+static int functional_run(SimState *s, WORD *pc, long long maxInsts,
+                          long long *instCount)
+{
+	long long count = 0;
+	int status = SIM_RUNNING;
+
+	while (maxInsts < 0 || count < maxInsts)
+	{
+		status = functional_step(s, pc);
+		count++;
+		if (status != SIM_RUNNING)
+			break;
+	}
+
+	*instCount += count;
+	return status;
+}
+
+
+
+void ExecProcessor(WORD *instMemory, int instMemSizeWords,
+                   WORD *regs,
+                   WORD *dataMemory, int dataMemSizeWords,
+                   WORD  codeOffset)
+{
+	/* this is basically the same function as Test_FullProcessor(),
+	 * except that it calls the user functions directly, instead of
+	 * using the Test*() functions (which do too much printing).
+	 *
+	 * It also keeps a predecode cache, with one entry per word of
+	 * instruction memory, so that each PC is only decoded once.
+	 *
+	 * 'cur' is the set of pipeline registers at the start of the clock
+	 * (what the debug functions call [0]), and 'next' is the set being
+	 * built (what they call [1]).  At the end of the clock we swap the
+	 * two pointers rather than copying.
+	 */
+
+	SimState s;
+	if (sim_open(&s, "ExecProcessor", instMemory, instMemSizeWords,
+	             regs, dataMemory, dataMemSizeWords, codeOffset) != 0)
+		return;
+
+	PipelineRegs  regSets[2];
+	PipelineRegs *cur  = &regSets[0];
+	PipelineRegs *next = &regSets[1];
+
+	pipeline_reset(&s, cur,next, codeOffset);
+
+	long long cycles = 0, issued = 0;
+	pipeline_run(&s, &cur,&next, -1,-1, &cycles, &issued);
+
+	sim_close(&s);
+}
+
+
+
+void ExecProcessorTraced(WORD *instMemory, int instMemSizeWords,
+                         WORD *regs,
+                         WORD *dataMemory, int dataMemSizeWords,
+                         WORD  codeOffset,
+                         const char *tracePath)
+{
+	SimState s;
+	if (sim_open(&s, "ExecProcessorTraced", instMemory, instMemSizeWords,
+	             regs, dataMemory, dataMemSizeWords, codeOffset) != 0)
+		return;
+
+	s.trace = Trace_open(tracePath);
+	if (s.trace == NULL)
+	{
+		sim_close(&s);
+		return;
+	}
+
+	PipelineRegs  regSets[2];
+	PipelineRegs *cur  = &regSets[0];
+	PipelineRegs *next = &regSets[1];
+
+	pipeline_reset(&s, cur,next, codeOffset);
+
+	long long cycles = 0, issued = 0;
+	pipeline_run(&s, &cur,&next, -1,-1, &cycles, &issued);
+
+	Trace_close(s.trace);
+	sim_close(&s);
+}
+
+
+
+void ExecFunctional(WORD *instMemory, int instMemSizeWords,
+                    WORD *regs,
+                    WORD *dataMemory, int dataMemSizeWords,
+                    WORD  codeOffset)
+{
+	/* this runs the same program as ExecProcessor(), but without the
+	 * pipeline: every instruction goes all the way through ID, EX, MEM
+	 * and WB before the next one is fetched.  So there are no stalls and
+	 * nothing to forward; we pass empty EX/MEM and MEM/WB registers to
+	 * the EX_getALUinput*() functions, which makes them simply select
+	 * rsVal, rtVal or the immediate.
+	 *
+	 * Since we call the same phase functions, and the pipeline
+	 * interlocks on every hazard, the architectural results are exactly
+	 * the same as the pipelined model's.  (The one exception is a
+	 * program which writes something other than 0 into $zero: the
+	 * pipeline never forwards $zero.)
+	 */
+
+	SimState s;
+	if (sim_open(&s, "ExecFunctional", instMemory, instMemSizeWords,
+	             regs, dataMemory, dataMemSizeWords, codeOffset) != 0)
+		return;
+
+	WORD pc = codeOffset;
+	long long count = 0;
+	functional_run(&s, &pc, -1, &count);
+
+	sim_close(&s);
+}
+
+
+
+void ExecFunctionalPaged(WORD *instMemory, int instMemSizeWords,
+                         WORD *regs,
+                         GuestMemory *dataMemory,
+                         WORD  codeOffset)
+{
+	SimState s;
+	if (sim_open(&s, "ExecFunctionalPaged", instMemory, instMemSizeWords,
+	             regs, NULL, 0, codeOffset) != 0)
+		return;
+	s.paged = dataMemory;
+
+	WORD pc = codeOffset;
+	long long count = 0;
+	functional_run(&s, &pc, -1, &count);
+
+	sim_close(&s);
+}
+
+
+
+void ExecSampled(WORD *instMemory, int instMemSizeWords,
+                 WORD *regs,
+                 WORD *dataMemory, int dataMemSizeWords,
+                 WORD  codeOffset,
+                 SampleConfig *config,
+                 SampleResult *result)
+{
+	/* alternates between the two models.  The handoff is simple,
+	 * because both models use the same registers and memory: the only
+	 * other state is the PC.
+	 *
+	 * Going into the pipeline, we start with every pipeline register
+	 * empty, and the next instruction in IF/ID.  Coming out, we stop
+	 * issuing and let the pipeline drain, so that every instruction
+	 * which left ID has finished WB; then IF/ID holds the PC to resume
+	 * from.
+	 */
+
+	memset(result, 0, sizeof(*result));
+
+	SimState s;
+	if (sim_open(&s, "ExecSampled", instMemory, instMemSizeWords,
+	             regs, dataMemory, dataMemSizeWords, codeOffset) != 0)
+		return;
+
+	PipelineRegs  regSets[2];
+	PipelineRegs *cur  = &regSets[0];
+	PipelineRegs *next = &regSets[1];
+
+	WORD pc = codeOffset;
+	int  status = SIM_RUNNING;
+
+	while (config->maxWindows == 0 || result->windows < config->maxWindows)
+	{
+		status = functional_run(&s, &pc, config->fastForward,
+		                        &result->ffInstructions);
+		if (status != SIM_RUNNING)
+			break;
+
+		pipeline_reset(&s, cur,next, pc);
+
+		long long warmCycles = 0, warmInsts = 0;
+		status = pipeline_run(&s, &cur,&next, config->warmup, -1,
+		                      &warmCycles, &warmInsts);
+		result->warmupInstructions += warmInsts;
+		if (status != SIM_RUNNING)
+			break;
+
+		long long cycles = 0, insts = 0;
+		status = pipeline_run(&s, &cur,&next, config->measure, -1,
+		                      &cycles, &insts);
+
+		/* a window that was cut short by the end of the program
+		 * still counts; it's just shorter.
+		 */
+		result->windows++;
+		result->cycles       += cycles;
+		result->instructions += insts;
+
+		if (config->onWindow != NULL)
+			config->onWindow(result->windows-1, insts, cycles,
+			                 config->arg);
+
+		if (status != SIM_RUNNING)
+			break;
+
+		pipeline_drain(&s, &cur,&next);
+		pc = cur->pc;
+	}
+
+	/* if we ran out of windows before the program ended, finish it
+	 * off in the fast model.
+	 */
+	if (status == SIM_RUNNING)
+		functional_run(&s, &pc, -1, &result->ffInstructions);
+
+	sim_close(&s);
+}
+
+
+
+void InitMachine(MachineState *m,
+                 WORD *instMemory, int instMemSizeWords,
+                 WORD *regs,
+                 WORD *dataMemory, int dataMemSizeWords,
+                 WORD  codeOffset)
+{
+	memset(m, 0, sizeof(*m));
+
+	m->instMemory       = instMemory;
+	m->instMemSizeWords = instMemSizeWords;
+	m->dataMemory       = dataMemory;
+	m->dataMemSizeWords = dataMemSizeWords;
+	m->codeOffset       = codeOffset;
+	memcpy(m->regs, regs, sizeof(m->regs));
+
+	// this is the same starting state that ExecProcessor() uses
+	m->pipe[0].pc          = codeOffset;
+	m->pipe[0].instruction = instMemory[0];
+	memset(m->pipe[0].opClass, OPCLASS_NONE, sizeof(m->pipe[0].opClass));
+	memset(m->pipe[1].opClass, OPCLASS_NONE, sizeof(m->pipe[1].opClass));
+}
+
+
+
+void FreeMachine(MachineState *m)
+{
+	free(m->decoded);
+	m->decoded = NULL;
+}
+
+
+
+/* the end of every Exec/RunMachine call: puts the current pipeline
+ * registers back in pipe[0], and notes whether the program has ended.
+ */
+static int machine_finish(MachineState *m, PipelineRegs *cur, int status)
+{
+	/* we swap pointers every clock, so the current registers may have
+	 * ended up in pipe[1]; the caller expects them in pipe[0].
+	 */
+	if (cur != &m->pipe[0])
+	{
+		PipelineRegs tmp = m->pipe[0];
+		m->pipe[0] = m->pipe[1];
+		m->pipe[1] = tmp;
+	}
+
+	m->halted = (status != SIM_RUNNING);
+
+	if (m->halted && m->printPerfAtExit)
+		PrintPerfCounters(m->out != NULL ? m->out : stdout, &m->perf);
+
+	return m->halted;
+}
+
+
+
+int ExecMachine(MachineState *m, long long maxCycles)
+{
+	if (m->halted)
+		return 1;
+
+	SimState s;
+	if (sim_openMachine(&s, "ExecMachine", m) != 0)
+		return 1;
+
+	PipelineRegs *cur  = &m->pipe[0];
+	PipelineRegs *next = &m->pipe[1];
+
+	long long issued = 0;
+	int status = pipeline_run(&s, &cur,&next, -1, maxCycles,
+	                          &m->cycles, &issued);
+
+	return machine_finish(m, cur, status);
+}
+
+
+
+int RunMachine(MachineState *m)
+{
+	return ExecMachine(m, -1);
+}
+
+
+
+int RunMachineUntil(MachineState *m, const StopCondition *stop)
+{
+	if (m->halted)
+		return 1;
+
+	SimState s;
+	if (sim_openMachine(&s, "RunMachineUntil", m) != 0)
+		return 1;
+
+	PipelineRegs *cur  = &m->pipe[0];
+	PipelineRegs *next = &m->pipe[1];
+
+	int  flags  = stop->flags;
+	WORD stopPC = stop->pc;
+
+	// a cycle limit doesn't need to be checked every clock
+	long long maxCycles = -1;
+	if (flags & STOP_AT_CYCLE)
+	{
+		maxCycles = stop->cycle - m->cycles;
+		if (maxCycles < 1)
+			maxCycles = 1;
+	}
+
+	// the same loop as pipeline_run(), with the checks added
+	int status = SIM_RUNNING;
+	long long clocks = 0;
+
+	while (maxCycles < 0 || clocks < maxCycles)
+	{
+		int issued;
+
+		status = pipeline_clock(&s, cur,next, 0, &issued);
+		if (status != SIM_RUNNING)
+			break;
+
+		PipelineRegs *tmp = cur;
+		cur  = next;
+		next = tmp;
+
+		m->cycles++;
+		clocks++;
+
+		// on a stall, IF/ID still holds the same instruction
+		if ((flags & STOP_AT_PC) && issued && cur->pc == stopPC)
+			break;
+
+		if ((flags & STOP_ON_CALLBACK) && stop->callback(m, cur, stop->arg))
+			break;
+	}
+
+	return machine_finish(m, cur, status);
+}
+
+
+
+void InitMulticore(Multicore *mc, int memPorts)
+{
+	memset(mc, 0, sizeof(*mc));
+	mc->memPorts = memPorts;
+}
+
+
+
+int AddCore(Multicore *mc, MachineState *m)
+{
+	if (mc->coreCount == MULTICORE_MAX_CORES)
+	{
+		printf("AddCore(): There can only be %d cores.\n", MULTICORE_MAX_CORES);
+		return -1;
+	}
+
+	mc->cores[mc->coreCount++] = m;
+	mc->halted = 0;
+	return 0;
+}
+
+
+
+int ExecMulticore(Multicore *mc, long long maxCycles)
+{
+	int n = mc->coreCount;
+
+	SimState      sims[MULTICORE_MAX_CORES];
+	PipelineRegs *cur [MULTICORE_MAX_CORES];
+	PipelineRegs *next[MULTICORE_MAX_CORES];
+
+	int i, live = 0;
+	for (i=0; i<n; i++)
+	{
+		MachineState *m = mc->cores[i];
+		if (m->halted)
+			continue;
+
+		if (sim_openMachine(&sims[i], "ExecMulticore", m) != 0)
+		{
+			m->halted = 1;
+			continue;
+		}
+		sims[i].mc = mc;
+		cur [i] = &m->pipe[0];
+		next[i] = &m->pipe[1];
+		live++;
+	}
+
+	long long clocks = 0;
+	while (live > 0 && (maxCycles < 0 || clocks < maxCycles))
+	{
+		int first   = mc->cycles % n;
+		int granted = 0;
+		int k;
+
+		for (k=0; k<n; k++)
+		{
+			i = (first + k) % n;
+
+			MachineState *m = mc->cores[i];
+			if (m->halted)
+				continue;
+
+			SimState     *s = &sims[i];
+			PipelineRegs *c = cur[i], *nx = next[i];
+
+			/* an access which is just arriving in MEM needs a port;
+			 * if they are all taken, the core holds, like on a miss
+			 */
+			int holds = 0;
+			if (mc->memPorts > 0 && !c->memStarted &&
+			    (c->exmem.memToReg || c->exmem.memWrite))
+			{
+				if (granted == mc->memPorts)
+					holds = 1;
+				else
+					granted++;
+			}
+
+			if (holds)
+			{
+				s->perf->cycles++;
+				s->perf->stalls[STALL_MEMPORT]++;
+				*nx = *c;
+			}
+			else
+			{
+				int issued;
+				int status = pipeline_clock(s, c,nx, 0, &issued);
+				if (status != SIM_RUNNING)
+				{
+					machine_finish(m, c, status);
+					live--;
+					continue;
+				}
+			}
+
+			cur [i] = nx;
+			next[i] = c;
+			m->cycles++;
+		}
+
+		// like a single machine, the clock that ends the program doesn't count
+		if (live == 0)
+			break;
+
+		mc->cycles++;
+		clocks++;
+	}
+
+	for (i=0; i<n; i++)
+		if (!mc->cores[i]->halted)
+			machine_finish(mc->cores[i], cur[i], SIM_RUNNING);
+
+	mc->halted = (live == 0);
+	return mc->halted;
+}
+
+
+
+int RunMulticore(Multicore *mc)
+{
+	return ExecMulticore(mc, -1);
+}
+
+
+
+int execSyscall(WORD *regs, WORD *dataMemory)
+{
+	return execSyscallTo(stdout, regs, dataMemory);
+}
+
+
+
+int execSyscallTo(FILE *out, WORD *regs, WORD *dataMemory)
 {
 	WORD v0 = regs[2];
 	WORD a0 = regs[4];
@@ -615,28 +1931,28 @@ int execSyscall(WORD *regs, WORD *dataMemory)
 	// syscall 10: exit
 	if (v0 == 10)
 	{
-		printf("--- syscall 10 executed: Normal termination of the assembly language program.\n");
+		fprintf(out, "--- syscall 10 executed: Normal termination of the assembly language program.\n");
 		return 1;
 	}
 
 
 	// syscall 1: print_int
 	if (v0 == 1)
-		printf("%d", a0);
+		fprintf(out, "%d", a0);
 
 	// syscall 11: print_char
 	else if (v0 == 11)
-		printf("%c", a0);
+		fprintf(out, "%c", a0);
 
 
 	// syscall 4: print_str
 	else if (v0 == 4)
-		printf("%s", ((char*)dataMemory)+a0);
+		fprintf(out, "%s", ((char*)dataMemory)+a0);
 
 
 	// unrecognized syscall
 	else
-		printf("--- ERROR: Unrecognized syscall $v0=%d\n", v0);
+		fprintf(out, "--- ERROR: Unrecognized syscall $v0=%d\n", v0);
 
 	return 0;
 }
@@ -2,7 +2,14 @@
 #define TEST_COMMONCODE_H
 
 
+#include <stdio.h>
+
 #include "proj_hw05.h"
+#include "proj_hw05_perf.h"
+#include "proj_hw05_cache.h"
+#include "proj_hw05_bpred.h"
+#include "proj_hw05_memory.h"
+#include "proj_hw05_mmu.h"
 
 
 
@@ -11,7 +18,7 @@
 int Test_ID(WORD pcPlus4, WORD instruction,
             WORD *regs,
             ID_EX *out,
-            ID_EX *old_idex);
+            ID_EX *old_idex, EX_MEM *old_exMem);
 void Test_EX (ID_EX *in, EX_MEM *out, EX_MEM *old_exMem, MEM_WB *old_memWb);
 void Test_MEM(EX_MEM *in, WORD *mem, int memSizeWords, MEM_WB *out);
 void Test_WB (MEM_WB *in, WORD *regs);
@@ -38,6 +45,43 @@ void Test_FullProcessor(WORD *instMemory, int instMemSizeWords,
                         WORD  codeOffset);
 
 
+/* one copy of every pipeline register, including IF/ID.  ExecProcessor()
+ * double-buffers these: one set holds the values at the start of the
+ * clock, the other is filled in during the clock, and the two pointers
+ * are swapped at the end.  Each set is exactly one cache line.
+ *
+ * opClass[] isn't part of the hardware: it is the OPCLASS() of the
+ * instruction in ID/EX, EX/MEM and MEM/WB (or OPCLASS_NONE for a bubble),
+ * so that the performance counters can tell what is retiring.
+ *
+ * The rest of the fields model cache misses and branch mispredictions
+ * (see MachineState): while flushWait or fetchWait is nonzero, IF is
+ * still being flushed, or still waiting for the instruction in IF/ID, and
+ * ID sends bubbles; while memWait is nonzero, MEM is waiting for the
+ * access in EX/MEM, and the whole pipeline holds.  memStarted is set once
+ * that access has been sent to the D-TLB and D-cache, so that it only
+ * counts once.  The first fetchTlbWait (memTlbWait) clocks of a wait are
+ * a TLB miss, and the rest are the cache.
+ */
+typedef struct PipelineRegs
+{
+	_Alignas(64) WORD instruction;   // IF/ID
+	WORD   pc;
+	ID_EX  idex;
+	EX_MEM exmem;
+	MEM_WB memwb;
+
+	unsigned char  opClass[3];
+	unsigned char  memStarted;
+	unsigned short fetchWait, memWait;
+	unsigned short flushWait;
+	unsigned char  fetchTlbWait, memTlbWait;
+} PipelineRegs;
+
+_Static_assert(sizeof(PipelineRegs) == 64,
+               "a set of pipeline registers must fit in one cache line");
+
+
 /* this version simply executes the instructions, in a pipelined fashion,
  * without any debugging printfs.  It's a stripped-down version of
  * Test_FullProcessor()
@@ -48,9 +92,292 @@ void ExecProcessor(WORD *instMemory, int instMemSizeWords,
                    WORD  codeOffset);
 
 
+/* this is ExecProcessor(), plus a binary trace of every clock, written to
+ * 'tracePath' (see proj_hw05_trace.h).  The trace holds what
+ * Test_FullProcessor() would have printed, but costs far less; use
+ * proj_hw05_traceDump to turn it into text.
+ */
+void ExecProcessorTraced(WORD *instMemory, int instMemSizeWords,
+                         WORD *regs,
+                         WORD *dataMemory, int dataMemSizeWords,
+                         WORD  codeOffset,
+                         const char *tracePath);
+
+
+
+/* this version isn't pipelined at all: it runs each instruction through
+ * ID, EX, MEM and WB (using the same functions) before fetching the next.
+ * Use it when you only need the architectural results - registers, memory
+ * and syscall output - and not the cycle-level behavior.
+ */
+void ExecFunctional(WORD *instMemory, int instMemSizeWords,
+                    WORD *regs,
+                    WORD *dataMemory, int dataMemSizeWords,
+                    WORD  codeOffset);
+
+/* the same, with a sparse data memory (see proj_hw05_memory.h) instead
+ * of a flat array: data addresses can be anywhere in the 32-bit space.
+ */
+void ExecFunctionalPaged(WORD *instMemory, int instMemSizeWords,
+                         WORD *regs,
+                         GuestMemory *dataMemory,
+                         WORD  codeOffset);
+
+
+/* sampling mode: alternates between the two models above.  It fast-
+ * forwards 'fastForward' instructions with ExecFunctional(), then hands
+ * the state to the pipeline, which simulates 'warmup' instructions (not
+ * measured) and then 'measure' instructions (measured).  Then the
+ * pipeline is drained, and it starts over.
+ *
+ * This repeats until the program ends, or after 'maxWindows' windows
+ * (0 means no limit); after the last window the rest of the program is
+ * run in the fast model.
+ *
+ * "Instructions" here means instructions which left the ID phase, so the
+ * CPI of a window is cycles/instructions.  If 'onWindow' is not NULL, it
+ * is called at the end of every measurement window.
+ */
+typedef struct SampleConfig
+{
+	long long fastForward;
+	long long warmup;
+	long long measure;
+	int       maxWindows;
+
+	void (*onWindow)(int window, long long instructions, long long cycles,
+	                 void *arg);
+	void *arg;
+} SampleConfig;
+
+typedef struct SampleResult
+{
+	int       windows;
+	long long cycles, instructions;     // totals over the measured windows
+	long long warmupInstructions;
+	long long ffInstructions;           // run in the fast model
+} SampleResult;
+
+void ExecSampled(WORD *instMemory, int instMemSizeWords,
+                 WORD *regs,
+                 WORD *dataMemory, int dataMemSizeWords,
+                 WORD  codeOffset,
+                 SampleConfig *config,
+                 SampleResult *result);
+
+
+/* the complete state of the pipelined machine, so that a run can be
+ * stopped and picked up again later (or saved to a file; see
+ * proj_hw05_checkpoint.h).  Nothing in the simulator is global, so a
+ * process can run any number of machines, one after another or on
+ * different threads.
+ *
+ * The two memories belong to the caller; the registers are copied in.
+ * pipe[0] is the set of pipeline registers for the start of the next
+ * clock; pipe[1] is the set from the previous clock.  'decoded' is the
+ * predecode cache; it is allocated by the first run, and kept until
+ * FreeMachine().
+ *
+ * InitMachine() sets up the same starting state that ExecProcessor()
+ * uses.  ExecMachine() runs the pipeline for up to 'maxCycles' clocks
+ * (or to the end, if negative); it returns 1 once the program has ended,
+ * and 0 if it simply ran out of clocks.  RunMachine() runs to the end.
+ *
+ * ExecMachine() also keeps the performance counters in 'perf' up to date;
+ * print them at any time with PrintPerfCounters().  If 'printPerfAtExit'
+ * is set, they are printed when the program ends.
+ *
+ * The program's output (from syscalls), and any errors that end it, go
+ * to 'out'; NULL means stdout.
+ *
+ * 'icache' and 'dcache' are optional L1 caches (see proj_hw05_cache.h);
+ * NULL means a perfect memory, which never stalls.  They belong to the
+ * caller.  A cache only changes the timing: a miss in IF stalls ID (with
+ * bubbles) until the line arrives, and a miss in MEM freezes the whole
+ * pipeline.  The caches are blocking, so misses never overlap.
+ *
+ * 'bpred' is an optional branch predictor (see proj_hw05_bpred.h), which
+ * also belongs to the caller; NULL means that branches and jumps are
+ * free, since they resolve in ID.  With a predictor, each misprediction
+ * sends its penalty in bubbles from ID.
+ *
+ * 'pagedMemory' is an optional sparse data memory (see
+ * proj_hw05_memory.h), which belongs to the caller.  If it is set, every
+ * LW, SW and syscall uses it instead of dataMemory (pass NULL and 0 for
+ * dataMemory to InitMachine()), so data can live anywhere in the 32-bit
+ * address space.  Since code and data are then separate, a SW can never
+ * change an instruction.
+ *
+ * 'mmu' optionally translates data addresses (see proj_hw05_mmu.h); it
+ * replaces pagedMemory, with its own physical memory.  The D-cache is
+ * then indexed by physical address.  Instructions are still fetched from
+ * instMemory, by PC, but an MMU also translates the PC for the I-cache.
+ *
+ * 'itlb' and 'dtlb' are optional TLB timing models, which belong to the
+ * caller.  Like the caches, a miss in IF stalls ID, and a miss in MEM
+ * freezes the pipeline; a TLB miss and a cache miss on the same access
+ * add up.  They work with or without an MMU.
+ *
+ * 'resv' is the reservation for ll/sc.  An ll reserves the word that it
+ * loads; an sc only stores (and sets rt to 1) if the reservation is still
+ * there, on the same word, and otherwise sets rt to 0.  Either way, the
+ * sc uses it up.  Only a store by another core (see Multicore, below)
+ * takes a reservation away.  Words are by data address, before any MMU.
+ */
+typedef struct Reservation
+{
+	int      valid;
+	uint32_t indx;                   // data address / 4
+} Reservation;
+
+typedef struct MachineState
+{
+	WORD *instMemory;
+	int   instMemSizeWords;
+	WORD *dataMemory;
+	int   dataMemSizeWords;
+	WORD  codeOffset;
+
+	WORD  regs[34];
+	PipelineRegs pipe[2];
+
+	long long cycles;
+	int       halted;
+
+	PerfCounters perf;
+	int          printPerfAtExit;
+	FILE        *out;
+
+	Cache       *icache, *dcache;
+	Predictor   *bpred;
+	GuestMemory *pagedMemory;
+	Mmu         *mmu;
+	Tlb         *itlb, *dtlb;
+	Reservation  resv;
+
+	struct DecodedInst *decoded;     // see below
+} MachineState;
+
+void InitMachine(MachineState *m,
+                 WORD *instMemory, int instMemSizeWords,
+                 WORD *regs,
+                 WORD *dataMemory, int dataMemSizeWords,
+                 WORD  codeOffset);
+void FreeMachine(MachineState *m);
+
+int ExecMachine(MachineState *m, long long maxCycles);
+int RunMachine (MachineState *m);
+
+
+/* RunMachineUntil() runs until the program ends (returns 1), or until
+ * any of the conditions in 'stop' is true (returns 0).  The conditions
+ * are checked after every clock, never before the first one, so calling
+ * it again always makes progress.
+ *
+ * STOP_AT_PC stops when the instruction at 'pc' has just been fetched
+ * into IF/ID (so it is the next one to be decoded).  STOP_AT_CYCLE stops
+ * once m->cycles reaches 'cycle'.  STOP_ON_CALLBACK calls 'callback'
+ * after every clock, and stops if it returns nonzero; during the run,
+ * m->regs, m->cycles and m->perf are up to date, but m->pipe[] is not,
+ * so the current pipeline registers are passed in 'cur'.
+ */
+#define STOP_AT_PC        0x01
+#define STOP_AT_CYCLE     0x02
+#define STOP_ON_CALLBACK  0x04
+
+typedef struct StopCondition
+{
+	int       flags;             // STOP_*
+	WORD      pc;
+	long long cycle;
+	int     (*callback)(MachineState *m, const PipelineRegs *cur, void *arg);
+	void     *arg;
+} StopCondition;
+
+int RunMachineUntil(MachineState *m, const StopCondition *stop);
+
+
+
+/* a multiprocessor: up to MULTICORE_MAX_CORES pipelines, clocked
+ * together.  Each core is an ordinary MachineState, with its own
+ * registers, pipeline, counters and (optionally) caches, predictor and
+ * TLBs; they all must have the same data memory (the same dataMemory, or
+ * the same pagedMemory).  Give each core its own registers (a core
+ * number in $a0, its own $sp) after InitMachine(), and before AddCore().
+ *
+ * Every clock, the cores run one after another, in an order which
+ * rotates by one core per clock; so within a clock, their loads and
+ * stores reach memory in that order, and a run is always repeatable.
+ *
+ * 'memPorts' is the number of data memory accesses which can start in
+ * one clock (0 means no limit).  A core whose LW/SW/ll/sc arrives in MEM
+ * once the ports are used up freezes for that clock, like a D-cache miss,
+ * and tries again on the next one; those clocks are STALL_MEMPORT stalls.
+ *
+ * A store by any core takes away every other core's reservation on that
+ * word, so ll/sc works as a lock or an atomic update between cores.  Each
+ * core has its own predecode cache, so a store into the code is only
+ * seen by the core which made it: keep code and data apart.
+ *
+ * ExecMulticore() runs for up to 'maxCycles' clocks (or to the end, if
+ * negative); it returns 1 once every core's program has ended, and 0 if
+ * it ran out of clocks.  A core which ends simply stops, while the rest
+ * keep running.  RunMulticore() runs to the end.
+ */
+#define MULTICORE_MAX_CORES  16
+
+typedef struct Multicore
+{
+	int           coreCount;
+	MachineState *cores[MULTICORE_MAX_CORES];   // belong to the caller
+	int           memPorts;
+
+	long long     cycles;
+	int           halted;
+} Multicore;
+
+void InitMulticore(Multicore *mc, int memPorts);
+int  AddCore      (Multicore *mc, MachineState *m);     // 0, or -1 if full
+
+int ExecMulticore(Multicore *mc, long long maxCycles);
+int RunMulticore (Multicore *mc);
+
+
+
+/* a helper function, used by some of the simulator functions above.
+ * execSyscallTo() sends the output to 'out' instead of stdout.
+ */
+int execSyscall  (WORD *regs, WORD *dataMemory);
+int execSyscallTo(FILE *out, WORD *regs, WORD *dataMemory);
+
+
+
+/* ExecProcessor() keeps one of these for every word of instruction memory.
+ * The first time that a PC is fetched, we run extract_instructionFields()
+ * and execute_ID() on it and save the results; after that, the ID phase
+ * for that PC is simply a copy out of the cache.
+ *
+ * 'ctrl' is the ID/EX register which execute_ID() builds when rsVal and
+ * rtVal are both zero.  Some instructions (branches, NOP) clear the
+ * register values in ID/EX; passRsVal/passRtVal record whether the
+ * instruction actually carries them forward.
+ */
+typedef struct DecodedInst
+{
+	int valid;
+	int rc;                      // return code from execute_ID()
+	int passRsVal, passRtVal;
+	int opClass;
+	InstructionFields fields;
+	ID_EX ctrl;
+} DecodedInst;
+
+void predecode_instruction(WORD instruction, DecodedInst *out);
 
-/* a helper function, used by some of the simulator functions above. */
-int execSyscall(WORD *regs, WORD *dataMemory);
+int execute_ID_decoded(int IDstall,
+                       DecodedInst *dec,
+                       WORD rsVal, WORD rtVal,
+                       ID_EX *new_idex);
 
 
 /* these macros are useful for encoding instructions.
@@ -117,6 +444,8 @@ int execSyscall(WORD *regs, WORD *dataMemory);
 
 #define LW(rt, rs,imm16)     I_FORMAT(35, rs,rt,imm16)
 #define SW(rt, rs,imm16)     I_FORMAT(43, rs,rt,imm16)
+#define LL(rt, rs,imm16)     I_FORMAT(48, rs,rt,imm16)
+#define SC(rt, rs,imm16)     I_FORMAT(56, rs,rt,imm16)
 
 #define BEQ(rs,rt, imm16)    I_FORMAT(4,  rs,rt,imm16)
 #define BNE(rs,rt, imm16)    I_FORMAT(5,  rs,rt,imm16)
@@ -0,0 +1,1110 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <memory.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/mman.h>
+
+#include "proj_hw05.h"
+#include "proj_hw05_test_commonCode.h"
+#include "proj_hw05_threaded.h"
+
+
+
+#define BLOCK_MAX_INSTS  64
+
+// ExecJIT() compiles a block once it has run this many times
+#define JIT_THRESHOLD    16
+#define JIT_ARENA_SIZE   (1 << 20)
+
+
+/* the kinds of op.  The ones up to T_GENERIC run inside a block; the rest
+ * end one.
+ */
+enum {
+	T_NOP, T_ZERO,
+	T_ADD, T_SUB, T_AND, T_OR, T_NOR, T_SLT,
+	T_ADDI, T_SLTI, T_ANDI, T_ORI, T_LUI,
+	T_LW, T_SW,
+	T_GENERIC,
+
+	T_BEQ, T_BNE, T_J, T_SYSCALL, T_INVALID,
+	T_FALLTHRU,                  // not an instruction: the block just ends
+
+	T_KINDS
+};
+
+typedef struct TOp
+{
+	const void   *handler;
+	WORD          imm;           // the immediate, or the target of a branch or
+	                             // jump; the instruction itself for T_GENERIC
+	WORD          pc;
+	unsigned char kind;
+	unsigned char d, s, t;       // destination, rs, rt
+} TOp;
+
+/* native code for a block runs as many of its ops as it can, and
+ * returns the index of the first op that is left for the interpreter.
+ */
+typedef int (*NativeBlock)(WORD *regs, WORD *dataMemory);
+
+typedef struct Block
+{
+	int           valid;
+	int           start, count;  // the words of instMemory that it came from
+	struct Block *succ[2];       // where it went: [0] not taken, [1] taken
+	struct Block *allNext;       // every block, valid or not, for freeing
+
+	unsigned      runs;
+	NativeBlock   native;        // NULL until the JIT compiles it
+
+	TOp           ops[];
+} Block;
+
+typedef struct JitArena
+{
+	unsigned char   *code;
+	size_t           used;
+	struct JitArena *next;
+} JitArena;
+
+typedef struct ThreadedState
+{
+	const char *name;            // used in error messages
+
+	WORD  *instMemory;
+	int    instMemSizeWords;
+	WORD  *regs;
+	WORD  *dataMemory;
+	int    dataMemSizeWords;
+	WORD   codeOffset;
+
+	Block **blockAt;             // the valid block starting at each word
+	Block  *all;
+
+	Reservation resv;            // for ll/sc, as in ExecFunctional()
+
+	int       jit;               // compile hot blocks?
+	JitArena *arena;
+	long long blocksCompiled;
+} ThreadedState;
+
+
+
+static inline int threaded_instIndex(ThreadedState *t, WORD pc)
+{
+	int instIndx = (pc - t->codeOffset)/4;
+
+	if (instIndx < 0 || instIndx >= t->instMemSizeWords || pc % 4 != 0)
+		return -1;
+	return instIndx;
+}
+
+
+
+/* picks the op for one instruction, and fills in its operands.  The
+ * control bits come from execute_ID() (through the predecode), so an
+ * instruction only gets a specialized handler if its bits are exactly
+ * the ones that the handler assumes.
+ */
+static int classify(WORD instruction, WORD pc, TOp *op)
+{
+	if (instruction == SYSCALL())
+		return T_SYSCALL;
+
+	DecodedInst dec;
+	predecode_instruction(instruction, &dec);
+	if (dec.rc == 0)
+		return T_INVALID;
+
+	InstructionFields *fields = &dec.fields;
+	ID_EX             *ctrl   = &dec.ctrl;
+
+	op->s = fields->rs;
+	op->t = fields->rt;
+
+	/* branches and jumps don't write anything; all they do is pick the
+	 * next PC, just like IDtoIF_get_branchControl()
+	 */
+	if (fields->opcode == 0x04 || fields->opcode == 0x05)
+	{
+		op->imm = calc_branchAddr(pc+4, fields);
+		return (fields->opcode == 0x04) ? T_BEQ : T_BNE;
+	}
+	if (fields->opcode == 0x02)
+	{
+		op->imm = calc_jumpAddr(pc+4, fields);
+		return T_J;
+	}
+
+	op->d = ctrl->ALUsrc ? ctrl->rt : ctrl->rd;
+
+	int regs  = dec.passRsVal && dec.passRtVal;
+	int mem   = ctrl->memToReg || ctrl->memWrite;
+	int src   = ctrl->ALUsrc;
+	int aluOp = ctrl->ALU.op;
+	int neg   = ctrl->ALU.bNegate;
+
+	if (!ctrl->regWrite && !mem)
+		return T_NOP;
+
+	if (ctrl->extra2 && ctrl->regWrite && !mem)
+	{
+		op->imm = (WORD)((unsigned)ctrl->imm16 << 16);
+		return T_LUI;
+	}
+	if (ctrl->extra2)
+		return T_GENERIC;
+
+	// the ALU adds zeroes for everything else
+	if (ctrl->regWrite && !mem && aluOp == 4)
+		return T_ZERO;
+
+	if (!regs)
+		return T_GENERIC;
+
+	if (ctrl->regWrite && !mem)
+	{
+		if (src == 0)
+		{
+			if (aluOp == 2)              return neg ? T_SUB : T_ADD;
+			if (aluOp == 0 && !neg)      return T_AND;
+			if (aluOp == 1 && !neg)      return ctrl->extra1 ? T_NOR : T_OR;
+			if (aluOp == 3)              return T_SLT;
+		}
+		else if (src == 1)
+		{
+			op->imm = ctrl->imm32;
+			if (aluOp == 2 && !neg)      return T_ADDI;
+			if (aluOp == 3)              return T_SLTI;
+		}
+		else
+		{
+			op->imm = ctrl->imm16;
+			if (aluOp == 0 && !neg)      return T_ANDI;
+			if (aluOp == 1 && !neg && !ctrl->extra1)
+			                             return T_ORI;
+		}
+		return T_GENERIC;
+	}
+
+	/* loads and stores: the address is rs+imm32.  ll and sc run generic,
+	 * since they also take and use up the reservation.
+	 */
+	if (ctrl->extra3)
+		return T_GENERIC;
+	if (src == 1 && aluOp == 2 && !neg)
+	{
+		op->imm = ctrl->imm32;
+		if (ctrl->memRead && ctrl->memToReg && ctrl->regWrite)
+			return T_LW;
+		if (ctrl->memWrite && !ctrl->memToReg && !ctrl->regWrite)
+			return T_SW;
+	}
+	return T_GENERIC;
+}
+
+
+
+/* translates the block which starts at word 'start'.  Returns NULL if we
+ * are out of memory.
+ */
+static Block *block_build(ThreadedState *t, int start, const void *const *handlers)
+{
+	Block *b = malloc(sizeof(Block) + BLOCK_MAX_INSTS * sizeof(TOp));
+	if (b == NULL)
+	{
+		printf("%s(): Out of memory.\n", t->name);
+		return NULL;
+	}
+
+	memset(b, 0, sizeof(Block));
+	b->valid = 1;
+	b->start = start;
+
+	int n = 0;
+	int instIndx = start;
+	for (;;)
+	{
+		TOp *op  = &b->ops[n++];
+		WORD pc  = t->codeOffset + 4*instIndx;
+
+		// the last slot is saved for T_FALLTHRU
+		if (n == BLOCK_MAX_INSTS || instIndx >= t->instMemSizeWords)
+		{
+			op->kind = T_FALLTHRU;
+			op->pc   = pc-4;
+			op->imm  = pc;
+			break;
+		}
+
+		op->pc   = pc;
+		op->kind = classify(t->instMemory[instIndx], pc, op);
+		if (op->kind == T_GENERIC)
+			op->imm = t->instMemory[instIndx];
+		instIndx++;
+
+		if (op->kind > T_GENERIC)
+			break;
+	}
+
+	b->count = instIndx - start;
+
+	int i;
+	for (i=0; i<n; i++)
+		b->ops[i].handler = handlers[b->ops[i].kind];
+
+	b->allNext = t->all;
+	t->all     = b;
+	t->blockAt[start] = b;
+	return b;
+}
+
+
+
+/* a store wrote word 'w' of instMemory: throw away every block which
+ * holds it.  Returns 1 if that includes 'running'.
+ */
+static int threaded_storeToCode(ThreadedState *t, int w, Block *running)
+{
+	int first = w - (BLOCK_MAX_INSTS-1);
+	if (first < 0)
+		first = 0;
+
+	int i;
+	for (i=first; i<=w; i++)
+	{
+		Block *b = t->blockAt[i];
+		if (b != NULL && b->start + b->count > w)
+		{
+			b->valid = 0;
+			t->blockAt[i] = NULL;
+		}
+	}
+
+	return !running->valid;
+}
+
+
+
+/* runs any instruction the same way that ExecFunctional() does.  Returns
+ * the index of the word written to data memory, or -1.
+ */
+static int generic_exec(ThreadedState *t, WORD instruction)
+{
+	static EX_MEM noExMem;
+	static MEM_WB noMemWb;
+
+	ID_EX  idex;
+	EX_MEM exmem;
+	MEM_WB memwb;
+	DecodedInst dec;
+
+	predecode_instruction(instruction, &dec);
+
+	WORD rsVal = t->regs[dec.fields.rs];
+	WORD rtVal = t->regs[dec.fields.rt];
+	execute_ID_decoded(0, &dec, rsVal,rtVal, &idex);
+
+	WORD aluInput1 = EX_getALUinput1(&idex, &noExMem, &noMemWb);
+	WORD aluInput2 = EX_getALUinput2(&idex, &noExMem, &noMemWb);
+
+	execute_EX (&idex , aluInput1,aluInput2, &exmem);
+
+	/* ll and sc: an ll reserves its word; an sc uses up the reservation,
+	 * and without one on its own word, it fails (memWrite is cleared, so
+	 * execute_MEM() just sets rt to 0)
+	 */
+	if (exmem.extra3)
+	{
+		uint32_t indx = (uint32_t)exmem.aluResult / 4;
+		if (exmem.memRead)
+		{
+			t->resv.valid = 1;
+			t->resv.indx  = indx;
+		}
+		else
+		{
+			if (!t->resv.valid || t->resv.indx != indx)
+				exmem.memWrite = 0;
+			t->resv.valid = 0;
+		}
+	}
+
+	int written = execute_MEM(&exmem, t->dataMemory, &memwb);
+	execute_WB (&memwb, t->regs);
+
+	return written;
+}
+
+
+
+/* ---------------- the JIT (x86-64 only) ----------------
+ *
+ * A hot block is compiled into one native function, which does the
+ * work of its ops in order, straight-line, and returns the index of the
+ * first op that it didn't do: the terminator (branch, jump, syscall,
+ * ...), a T_GENERIC op, or a store which turned out to hit instMemory.
+ * The interpreter picks up from there, so everything with side effects
+ * beyond registers and data memory stays in one place.
+ *
+ * The native code follows the System V ABI: regs is in rdi, dataMemory
+ * in rsi, and it only uses rax, rcx, rdx and r8 (which it may clobber).
+ * Every guest register lives in regs[]; each op loads its inputs and
+ * stores its result, so an op does exactly what its handler does.
+ */
+#if defined(__x86_64__)
+
+// more than the worst case for one op (a checked store), plus the return
+#define JIT_MAX_OP_BYTES  96
+
+typedef struct JitBuf
+{
+	unsigned char *p;
+} JitBuf;
+
+static void emit1(JitBuf *j, int byte)
+{
+	*j->p++ = (unsigned char)byte;
+}
+
+static void emit4(JitBuf *j, uint32_t val)
+{
+	memcpy(j->p, &val, 4);
+	j->p += 4;
+}
+
+static void emit8(JitBuf *j, uint64_t val)
+{
+	memcpy(j->p, &val, 8);
+	j->p += 8;
+}
+
+
+#define X_EAX  0
+#define X_ECX  1
+#define X_EDX  2
+
+// mov r32, [rdi + 4*guestReg]
+static void emit_loadReg(JitBuf *j, int x, int guestReg)
+{
+	emit1(j, 0x8b);
+	emit1(j, 0x80 | (x << 3) | 7);
+	emit4(j, 4*guestReg);
+}
+
+// mov [rdi + 4*guestReg], r32
+static void emit_storeReg(JitBuf *j, int x, int guestReg)
+{
+	emit1(j, 0x89);
+	emit1(j, 0x80 | (x << 3) | 7);
+	emit4(j, 4*guestReg);
+}
+
+// mov dword [rdi + 4*guestReg], imm32
+static void emit_storeRegImm(JitBuf *j, int guestReg, WORD val)
+{
+	emit1(j, 0xc7);
+	emit1(j, 0x87);
+	emit4(j, 4*guestReg);
+	emit4(j, (uint32_t)val);
+}
+
+// mov eax, imm32 ; ret
+static void emit_return(JitBuf *j, int val)
+{
+	emit1(j, 0xb8);
+	emit4(j, (uint32_t)val);
+	emit1(j, 0xc3);
+}
+
+/* eax = regs[s] + imm, and then rax = (WORD)eax / 4 (which rounds toward
+ * zero, just like the C in execute_MEM())
+ */
+static void emit_address(JitBuf *j, TOp *op)
+{
+	emit_loadReg(j, X_EAX, op->s);
+	emit1(j, 0x05); emit4(j, (uint32_t)op->imm);            // add eax, imm32
+	emit1(j, 0x8d); emit1(j, 0x48); emit1(j, 0x03);          // lea ecx, [rax+3]
+	emit1(j, 0x85); emit1(j, 0xc0);                          // test eax, eax
+	emit1(j, 0x0f); emit1(j, 0x48); emit1(j, 0xc1);          // cmovs eax, ecx
+	emit1(j, 0xc1); emit1(j, 0xf8); emit1(j, 0x02);          // sar eax, 2
+	emit1(j, 0x48); emit1(j, 0x63); emit1(j, 0xc0);          // movsxd rax, eax
+}
+
+
+/* emits the code for ops[i]; returns 0 if the JIT doesn't handle it */
+static int jit_op(ThreadedState *t, JitBuf *j, TOp *op, int i, int checkStores)
+{
+	// "op eax, ecx" for the register-register ALU ops
+	int aluRR = -1;
+
+	switch (op->kind)
+	{
+	case T_NOP:
+		return 1;
+
+	case T_ZERO:
+		emit_storeRegImm(j, op->d, 0);
+		return 1;
+
+	case T_LUI:
+		emit_storeRegImm(j, op->d, op->imm);
+		return 1;
+
+	case T_ADD:  aluRR = 0x01;  break;
+	case T_SUB:  aluRR = 0x29;  break;
+	case T_AND:  aluRR = 0x21;  break;
+	case T_OR:
+	case T_NOR:  aluRR = 0x09;  break;
+
+	case T_SLT:
+		emit_loadReg(j, X_EAX, op->s);
+		emit_loadReg(j, X_ECX, op->t);
+		emit1(j, 0x39); emit1(j, 0xc8);                  // cmp eax, ecx
+		goto SETL;
+
+	case T_SLTI:
+		emit_loadReg(j, X_EAX, op->s);
+		emit1(j, 0x3d); emit4(j, (uint32_t)op->imm);     // cmp eax, imm32
+	SETL:
+		emit1(j, 0x0f); emit1(j, 0x9c); emit1(j, 0xc0);  // setl al
+		emit1(j, 0x0f); emit1(j, 0xb6); emit1(j, 0xc0);  // movzx eax, al
+		emit_storeReg(j, X_EAX, op->d);
+		return 1;
+
+	case T_ADDI:
+	case T_ANDI:
+	case T_ORI:
+		emit_loadReg(j, X_EAX, op->s);
+		emit1(j, (op->kind == T_ADDI) ? 0x05 :           // add eax, imm32
+		         (op->kind == T_ANDI) ? 0x25 : 0x0d);    // and / or
+		emit4(j, (uint32_t)op->imm);
+		emit_storeReg(j, X_EAX, op->d);
+		return 1;
+
+	case T_LW:
+		emit_address(j, op);
+		emit1(j, 0x8b); emit1(j, 0x0c); emit1(j, 0x86);  // mov ecx, [rsi+rax*4]
+		emit_storeReg(j, X_ECX, op->d);
+		return 1;
+
+	case T_SW:
+		emit_address(j, op);
+		emit1(j, 0x48); emit1(j, 0x8d);                  // lea rdx, [rsi+rax*4]
+		emit1(j, 0x14); emit1(j, 0x86);
+
+		/* if the store lands in instMemory, leave it to the
+		 * interpreter, which knows how to throw the blocks away
+		 */
+		if (checkStores)
+		{
+			emit1(j, 0x49); emit1(j, 0xb8);              // mov r8, codeLo
+			emit8(j, (uint64_t)(uintptr_t)t->instMemory);
+			emit1(j, 0x4c); emit1(j, 0x39); emit1(j, 0xc2);  // cmp rdx, r8
+			emit1(j, 0x72); emit1(j, 21);                // jb  store
+
+			emit1(j, 0x49); emit1(j, 0xb8);              // mov r8, codeHi
+			emit8(j, (uint64_t)(uintptr_t)(t->instMemory + t->instMemSizeWords));
+			emit1(j, 0x4c); emit1(j, 0x39); emit1(j, 0xc2);  // cmp rdx, r8
+			emit1(j, 0x73); emit1(j, 6);                 // jae store
+
+			emit_return(j, i);
+		}
+
+		// store:
+		emit_loadReg(j, X_ECX, op->t);
+		emit1(j, 0x89); emit1(j, 0x0a);                  // mov [rdx], ecx
+		return 1;
+
+	default:
+		return 0;
+	}
+
+	emit_loadReg(j, X_EAX, op->s);
+	emit_loadReg(j, X_ECX, op->t);
+	emit1(j, aluRR); emit1(j, 0xc8);                     // op eax, ecx
+	if (op->kind == T_NOR)
+	{
+		emit1(j, 0xf7); emit1(j, 0xd0);                  // not eax
+	}
+	emit_storeReg(j, X_EAX, op->d);
+	return 1;
+}
+
+
+/* compiles a block.  If we can't (out of memory, or the first op is one
+ * we don't handle), the block simply stays interpreted.
+ */
+static void jit_compile(ThreadedState *t, Block *b)
+{
+	size_t maxLen = (size_t)BLOCK_MAX_INSTS * JIT_MAX_OP_BYTES;
+
+	JitArena *a = t->arena;
+	if (a == NULL || a->used + maxLen > JIT_ARENA_SIZE)
+	{
+		a = malloc(sizeof(JitArena));
+		if (a == NULL)
+			return;
+
+		a->code = mmap(NULL, JIT_ARENA_SIZE, PROT_READ|PROT_WRITE|PROT_EXEC,
+		               MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+		if (a->code == MAP_FAILED)
+		{
+			// no executable memory here; stop trying
+			free(a);
+			t->jit = 0;
+			return;
+		}
+		a->used = 0;
+		a->next = t->arena;
+		t->arena = a;
+	}
+
+	/* stores need the check only if data memory overlaps the code */
+	int checkStores = (t->dataMemory < t->instMemory + t->instMemSizeWords &&
+	                   t->instMemory < t->dataMemory + t->dataMemSizeWords);
+
+	JitBuf j;
+	j.p = a->code + a->used;
+
+	int i = 0;
+	while (jit_op(t, &j, &b->ops[i], i, checkStores))
+		i++;
+
+	if (i == 0)
+		return;
+
+	emit_return(&j, i);
+
+	b->native = (NativeBlock)(void*)(a->code + a->used);
+	a->used   = j.p - a->code;
+	t->blocksCompiled++;
+}
+
+
+static void jit_free(ThreadedState *t)
+{
+	while (t->arena != NULL)
+	{
+		JitArena *next = t->arena->next;
+		munmap(t->arena->code, JIT_ARENA_SIZE);
+		free(t->arena);
+		t->arena = next;
+	}
+}
+
+#else
+
+static void jit_compile(ThreadedState *t, Block *b)
+{
+	// no JIT for this host; blocks stay interpreted
+	t->jit = 0;
+}
+
+static void jit_free(ThreadedState *t)
+{
+}
+
+#endif
+
+
+
+#define NEXT_OP  do { op++; goto *op->handler; } while (0)
+
+// the ALU works in unsigned, so that overflow wraps
+#define U(x)     ((unsigned)(x))
+
+static void threaded_run(ThreadedState *t)
+{
+	static const void *const handlers[T_KINDS] = {
+		[T_NOP]      = &&do_nop,
+		[T_ZERO]     = &&do_zero,
+		[T_ADD]      = &&do_add,
+		[T_SUB]      = &&do_sub,
+		[T_AND]      = &&do_and,
+		[T_OR]       = &&do_or,
+		[T_NOR]      = &&do_nor,
+		[T_SLT]      = &&do_slt,
+		[T_ADDI]     = &&do_addi,
+		[T_SLTI]     = &&do_slti,
+		[T_ANDI]     = &&do_andi,
+		[T_ORI]      = &&do_ori,
+		[T_LUI]      = &&do_lui,
+		[T_LW]       = &&do_lw,
+		[T_SW]       = &&do_sw,
+		[T_GENERIC]  = &&do_generic,
+		[T_BEQ]      = &&do_beq,
+		[T_BNE]      = &&do_bne,
+		[T_J]        = &&do_j,
+		[T_SYSCALL]  = &&do_syscall,
+		[T_INVALID]  = &&do_invalid,
+		[T_FALLTHRU] = &&do_fallthru,
+	};
+
+	WORD  *regs   = t->regs;
+	WORD  *mem    = t->dataMemory;
+	WORD  *codeLo = t->instMemory;
+	WORD  *codeHi = t->instMemory + t->instMemSizeWords;
+
+	Block *b, *from = NULL;
+	TOp   *op;
+	int    path = 0;
+	WORD   pc   = t->codeOffset;
+
+
+NEXT_BLOCK:
+	// 'pc' is always valid here; if 'from' is set, we chain it to this block
+	b = t->blockAt[(pc - t->codeOffset)/4];
+	if (b == NULL)
+	{
+		b = block_build(t, (pc - t->codeOffset)/4, handlers);
+		if (b == NULL)
+			return;
+	}
+	if (from != NULL)
+		from->succ[path] = b;
+
+ENTER:
+	if (b->native != NULL)
+	{
+		op = &b->ops[b->native(regs, mem)];
+		goto *op->handler;
+	}
+	if (t->jit && ++b->runs == JIT_THRESHOLD)
+		jit_compile(t, b);
+
+	op = b->ops;
+	goto *op->handler;
+
+
+do_nop:   NEXT_OP;
+do_zero:  regs[op->d] = 0;                                          NEXT_OP;
+do_add:   regs[op->d] = U(regs[op->s]) + U(regs[op->t]);            NEXT_OP;
+do_sub:   regs[op->d] = U(regs[op->s]) - U(regs[op->t]);            NEXT_OP;
+do_and:   regs[op->d] = regs[op->s] & regs[op->t];                  NEXT_OP;
+do_or:    regs[op->d] = regs[op->s] | regs[op->t];                  NEXT_OP;
+do_nor:   regs[op->d] = ~(regs[op->s] | regs[op->t]);               NEXT_OP;
+do_slt:   regs[op->d] = regs[op->s] < regs[op->t];                  NEXT_OP;
+do_addi:  regs[op->d] = U(regs[op->s]) + U(op->imm);                NEXT_OP;
+do_slti:  regs[op->d] = regs[op->s] < op->imm;                      NEXT_OP;
+do_andi:  regs[op->d] = regs[op->s] & op->imm;                      NEXT_OP;
+do_ori:   regs[op->d] = regs[op->s] | op->imm;                      NEXT_OP;
+do_lui:   regs[op->d] = op->imm;                                    NEXT_OP;
+
+do_lw:
+	regs[op->d] = mem[(WORD)(U(regs[op->s]) + U(op->imm)) / 4];
+	NEXT_OP;
+
+do_sw:
+	{
+		WORD *dest = mem + (WORD)(U(regs[op->s]) + U(op->imm)) / 4;
+		*dest = regs[op->t];
+
+		if (dest >= codeLo && dest < codeHi &&
+		    threaded_storeToCode(t, dest - codeLo, b))
+			goto RESTART;
+	}
+	NEXT_OP;
+
+do_generic:
+	{
+		int written = generic_exec(t, op->imm);
+
+		if (written >= 0 && mem+written >= codeLo && mem+written < codeHi &&
+		    threaded_storeToCode(t, mem+written - codeLo, b))
+			goto RESTART;
+	}
+	NEXT_OP;
+
+
+do_beq:
+	path = (regs[op->s] == regs[op->t]);
+	pc   = path ? op->imm : op->pc+4;
+	goto FOLLOW;
+
+do_bne:
+	path = (regs[op->s] != regs[op->t]);
+	pc   = path ? op->imm : op->pc+4;
+	goto FOLLOW;
+
+do_j:
+do_fallthru:
+	path = 0;
+	pc   = op->imm;
+	goto FOLLOW;
+
+do_syscall:
+	if (execSyscall(regs, mem) != 0)
+		return;
+	path = 0;
+	pc   = op->pc+4;
+	goto FOLLOW;
+
+do_invalid:
+	printf("%s(): Ending program because execute_ID() returned %d\n", t->name, 0);
+	return;
+
+
+FOLLOW:
+	if (b->succ[path] != NULL && b->succ[path]->valid)
+	{
+		b = b->succ[path];
+		goto ENTER;
+	}
+
+	if (threaded_instIndex(t, pc) < 0)
+	{
+		printf("ERROR: Invalid Program Counter 0x%08x\n", op->pc);
+		return;
+	}
+	from = b;
+	goto NEXT_BLOCK;
+
+
+RESTART:
+	// the running block was just overwritten; go on from the next instruction
+	pc = op->pc+4;
+	if (threaded_instIndex(t, pc) < 0)
+	{
+		printf("ERROR: Invalid Program Counter 0x%08x\n", op->pc);
+		return;
+	}
+	from = NULL;
+	goto NEXT_BLOCK;
+}
+
+#undef NEXT_OP
+#undef U
+
+
+
+static void threaded_exec(const char *name,
+                          WORD *instMemory, int instMemSizeWords,
+                          WORD *regs,
+                          WORD *dataMemory, int dataMemSizeWords,
+                          WORD  codeOffset,
+                          int   jit)
+{
+	ThreadedState t;
+
+	t.name             = name;
+	t.instMemory       = instMemory;
+	t.instMemSizeWords = instMemSizeWords;
+	t.regs             = regs;
+	t.dataMemory       = dataMemory;
+	t.dataMemSizeWords = dataMemSizeWords;
+	t.codeOffset       = codeOffset;
+	t.all              = NULL;
+	t.resv.valid       = 0;
+	t.resv.indx        = 0;
+	t.jit              = jit;
+	t.arena            = NULL;
+	t.blocksCompiled   = 0;
+
+	t.blockAt = calloc(instMemSizeWords, sizeof(Block*));
+	if (t.blockAt == NULL)
+	{
+		printf("%s(): Could not allocate the block cache.\n", name);
+		return;
+	}
+
+	threaded_run(&t);
+
+	while (t.all != NULL)
+	{
+		Block *next = t.all->allNext;
+		free(t.all);
+		t.all = next;
+	}
+	free(t.blockAt);
+	jit_free(&t);
+}
+
+
+
+void ExecThreaded(WORD *instMemory, int instMemSizeWords,
+                  WORD *regs,
+                  WORD *dataMemory, int dataMemSizeWords,
+                  WORD  codeOffset)
+{
+	threaded_exec("ExecThreaded", instMemory, instMemSizeWords, regs,
+	              dataMemory, dataMemSizeWords, codeOffset, 0);
+}
+
+void ExecJIT(WORD *instMemory, int instMemSizeWords,
+             WORD *regs,
+             WORD *dataMemory, int dataMemSizeWords,
+             WORD  codeOffset)
+{
+	threaded_exec("ExecJIT", instMemory, instMemSizeWords, regs,
+	              dataMemory, dataMemSizeWords, codeOffset, 1);
+}
+
+
+
+
+/* ---------------- ahead-of-time translation to C ----------------
+ *
+ * The same ops, written out as C statements instead of handlers.  Guest
+ * registers become locals (r0 to r33), so that the host compiler can keep
+ * them in host registers; they are copied back to regs[] before anything
+ * that needs them there (a syscall, a T_GENERIC op, or the end).
+ */
+
+// the body of the SAVE() or LOAD() macro; 'fmt' copies register %d
+static void aot_copyRegs(FILE *out, const char *fmt)
+{
+	int i;
+	for (i=0; i<34; i++)
+	{
+		fprintf(out, (i % 6 == 0) ? " \\\n\t\t" : " ");
+		fprintf(out, fmt, i, i);
+	}
+	fprintf(out, " \\\n");
+}
+
+// leaves the function, printing the same error as ExecFunctional()
+static void aot_badPC(FILE *out, WORD pc)
+{
+	fprintf(out, "\t\t{ SAVE(); printf(\"ERROR: Invalid Program Counter 0x%08x\\n\"); return; }\n", pc);
+}
+
+// a direct branch or jump: a goto, if the target is in the image
+static void aot_goto(FILE *out, WORD target, WORD pc, WORD codeOffset, int instMemSizeWords)
+{
+	int indx = (target - codeOffset)/4;
+
+	if (indx >= 0 && indx < instMemSizeWords && target % 4 == 0)
+		fprintf(out, "\t\tgoto L_%08x;\n", target);
+	else
+		aot_badPC(out, pc);
+}
+
+static void aot_op(FILE *out, const char *name, TOp *op, WORD codeOffset, int instMemSizeWords)
+{
+	int d = op->d, s = op->s, t = op->t;
+	unsigned imm = op->imm;
+
+	// the ops that take more than one line get a line to themselves
+	static const char *const longOps[T_KINDS] = {
+		[T_GENERIC] = "generic", [T_J] = "j",
+		[T_SYSCALL] = "syscall", [T_INVALID] = "invalid",
+	};
+
+	if (longOps[op->kind] != NULL)
+		fprintf(out, "\t/* 0x%08x: %s */\n", op->pc, longOps[op->kind]);
+	else
+		fprintf(out, "\t/* 0x%08x */ ", op->pc);
+
+	switch (op->kind)
+	{
+	case T_NOP:  fprintf(out, ";\n");                                               break;
+	case T_ZERO: fprintf(out, "r%d = 0;\n", d);                                     break;
+	case T_ADD:  fprintf(out, "r%d = U(r%d) + U(r%d);\n", d, s, t);                  break;
+	case T_SUB:  fprintf(out, "r%d = U(r%d) - U(r%d);\n", d, s, t);                  break;
+	case T_AND:  fprintf(out, "r%d = r%d & r%d;\n", d, s, t);                        break;
+	case T_OR:   fprintf(out, "r%d = r%d | r%d;\n", d, s, t);                        break;
+	case T_NOR:  fprintf(out, "r%d = ~(r%d | r%d);\n", d, s, t);                     break;
+	case T_SLT:  fprintf(out, "r%d = r%d < r%d;\n", d, s, t);                        break;
+	case T_ADDI: fprintf(out, "r%d = U(r%d) + 0x%08xu;\n", d, s, imm);               break;
+	case T_SLTI: fprintf(out, "r%d = r%d < (WORD)0x%08xu;\n", d, s, imm);            break;
+	case T_ANDI: fprintf(out, "r%d = r%d & 0x%x;\n", d, s, imm);                     break;
+	case T_ORI:  fprintf(out, "r%d = r%d | 0x%x;\n", d, s, imm);                     break;
+	case T_LUI:  fprintf(out, "r%d = (WORD)0x%08xu;\n", d, imm);                     break;
+
+	case T_LW:
+		fprintf(out, "r%d = dataMemory[(WORD)(U(r%d) + 0x%08xu) / 4];\n", d, s, imm);
+		break;
+	case T_SW:
+		fprintf(out, "dataMemory[(WORD)(U(r%d) + 0x%08xu) / 4] = r%d;\n", s, imm, t);
+		break;
+
+	case T_GENERIC:
+		fprintf(out, "\t\tSAVE();\n");
+		fprintf(out, "\t\t%s_generic(regs, dataMemory, &resv, (WORD)0x%08xu);\n", name, imm);
+		fprintf(out, "\t\tLOAD();\n");
+		break;
+
+	case T_BEQ:
+	case T_BNE:
+		fprintf(out, "if (r%d %s r%d)\n", s, (op->kind == T_BEQ) ? "==" : "!=", t);
+		aot_goto(out, op->imm, op->pc, codeOffset, instMemSizeWords);
+		break;
+
+	case T_J:
+		aot_goto(out, op->imm, op->pc, codeOffset, instMemSizeWords);
+		break;
+
+	case T_SYSCALL:
+		fprintf(out, "\t\tSAVE();\n");
+		fprintf(out, "\t\tif (execSyscall(regs, dataMemory) != 0)\n");
+		fprintf(out, "\t\t\treturn;\n");
+		fprintf(out, "\t\tLOAD();\n");
+		break;
+
+	case T_INVALID:
+		fprintf(out, "\t\tSAVE();\n");
+		fprintf(out, "\t\tprintf(\"%s(): Ending program because execute_ID() returned 0\\n\");\n", name);
+		fprintf(out, "\t\treturn;\n");
+		break;
+	}
+}
+
+int TranslateToC(FILE *out, const char *name,
+                 WORD *instMemory, int instMemSizeWords,
+                 WORD  codeOffset)
+{
+	if (instMemSizeWords <= 0)
+	{
+		printf("TranslateToC(): The program image is empty.\n");
+		return -1;
+	}
+
+	TOp  *ops    = calloc(instMemSizeWords, sizeof(TOp));
+	char *leader = calloc(instMemSizeWords, 1);
+	if (ops == NULL || leader == NULL)
+	{
+		printf("TranslateToC(): Out of memory.\n");
+		free(ops);
+		free(leader);
+		return -1;
+	}
+
+	/* decode everything, and find the blocks: a block starts at the
+	 * beginning of the image, at every branch or jump target, and after
+	 * anything that ends a block
+	 */
+	int i, hasGeneric = 0;
+	leader[0] = 1;
+	for (i=0; i<instMemSizeWords; i++)
+	{
+		TOp *op = &ops[i];
+
+		op->pc   = codeOffset + 4*i;
+		op->kind = classify(instMemory[i], op->pc, op);
+		if (op->kind == T_GENERIC)
+		{
+			op->imm    = instMemory[i];
+			hasGeneric = 1;
+		}
+
+		if (op->kind > T_GENERIC)
+		{
+			if (i+1 < instMemSizeWords)
+				leader[i+1] = 1;
+
+			int target = (op->imm - codeOffset)/4;
+			if ((op->kind == T_BEQ || op->kind == T_BNE || op->kind == T_J) &&
+			    target >= 0 && target < instMemSizeWords && op->imm % 4 == 0)
+				leader[target] = 1;
+		}
+	}
+
+
+	fprintf(out, "/* %s(): a %d-word program image at 0x%08x, translated to C by\n", name, instMemSizeWords, codeOffset);
+	fprintf(out, " * TranslateToC().  Do not edit.\n");
+	fprintf(out, " */\n\n");
+	fprintf(out, "#include <stdio.h>\n\n");
+	fprintf(out, "#include \"proj_hw05.h\"\n");
+	fprintf(out, "#include \"proj_hw05_test_commonCode.h\"\n\n\n\n");
+
+	fprintf(out, "void %s(WORD *regs, WORD *dataMemory, WORD startPC);\n\n", name);
+	fprintf(out, "#define U(x)  ((unsigned)(x))\n");
+	fprintf(out, "#define SAVE() do {");
+	aot_copyRegs(out, "regs[%d] = r%d;");
+	fprintf(out, "\t} while (0)\n");
+	fprintf(out, "#define LOAD() do {");
+	aot_copyRegs(out, "r%d = regs[%d];");
+	fprintf(out, "\t} while (0)\n\n\n\n");
+
+	if (hasGeneric)
+	{
+		fprintf(out, "// an instruction without a translation: run it the slow way\n");
+		fprintf(out, "static void %s_generic(WORD *regs, WORD *dataMemory, Reservation *resv,\n", name);
+		fprintf(out, "                       WORD instruction)\n");
+		fprintf(out, "{\n");
+		fprintf(out, "\tstatic EX_MEM noExMem;\n");
+		fprintf(out, "\tstatic MEM_WB noMemWb;\n\n");
+		fprintf(out, "\tID_EX  idex;\n");
+		fprintf(out, "\tEX_MEM exmem;\n");
+		fprintf(out, "\tMEM_WB memwb;\n");
+		fprintf(out, "\tDecodedInst dec;\n\n");
+		fprintf(out, "\tpredecode_instruction(instruction, &dec);\n");
+		fprintf(out, "\texecute_ID_decoded(0, &dec, regs[dec.fields.rs], regs[dec.fields.rt], &idex);\n\n");
+		fprintf(out, "\tWORD aluInput1 = EX_getALUinput1(&idex, &noExMem, &noMemWb);\n");
+		fprintf(out, "\tWORD aluInput2 = EX_getALUinput2(&idex, &noExMem, &noMemWb);\n\n");
+		fprintf(out, "\texecute_EX (&idex , aluInput1,aluInput2, &exmem);\n\n");
+		fprintf(out, "\t// ll reserves its word; sc fails without the reservation\n");
+		fprintf(out, "\tif (exmem.extra3)\n");
+		fprintf(out, "\t{\n");
+		fprintf(out, "\t\tuint32_t indx = (uint32_t)exmem.aluResult / 4;\n");
+		fprintf(out, "\t\tif (exmem.memRead)\n");
+		fprintf(out, "\t\t{\n");
+		fprintf(out, "\t\t\tresv->valid = 1;\n");
+		fprintf(out, "\t\t\tresv->indx  = indx;\n");
+		fprintf(out, "\t\t}\n");
+		fprintf(out, "\t\telse\n");
+		fprintf(out, "\t\t{\n");
+		fprintf(out, "\t\t\tif (!resv->valid || resv->indx != indx)\n");
+		fprintf(out, "\t\t\t\texmem.memWrite = 0;\n");
+		fprintf(out, "\t\t\tresv->valid = 0;\n");
+		fprintf(out, "\t\t}\n");
+		fprintf(out, "\t}\n\n");
+		fprintf(out, "\texecute_MEM(&exmem, dataMemory, &memwb);\n");
+		fprintf(out, "\texecute_WB (&memwb, regs);\n");
+		fprintf(out, "}\n\n\n\n");
+	}
+
+	fprintf(out, "void %s(WORD *regs, WORD *dataMemory, WORD startPC)\n", name);
+	fprintf(out, "{\n");
+	fprintf(out, "\tWORD");
+	for (i=0; i<34; i++)
+		fprintf(out, "%sr%d", (i == 0) ? " " : (i % 8 == 0) ? ",\n\t     " : ", ", i);
+	fprintf(out, ";\n");
+	if (hasGeneric)
+		fprintf(out, "\tReservation resv = { 0, 0 };     // for ll/sc\n");
+	fprintf(out, "\tLOAD();\n\n");
+
+	// the dispatch table, for anything that isn't known until it runs
+	fprintf(out, "\tswitch (startPC)\n");
+	fprintf(out, "\t{\n");
+	for (i=0; i<instMemSizeWords; i++)
+		if (leader[i])
+			fprintf(out, "\tcase (WORD)0x%08xu: goto L_%08x;\n", ops[i].pc, ops[i].pc);
+	fprintf(out, "\tdefault:\n");
+	fprintf(out, "\t\tprintf(\"%s(): 0x%%08x is not the start of a block.\\n\", startPC);\n", name);
+	fprintf(out, "\t\treturn;\n");
+	fprintf(out, "\t}\n");
+
+	for (i=0; i<instMemSizeWords; i++)
+	{
+		if (leader[i])
+			fprintf(out, "\nL_%08x:\n", ops[i].pc);
+		aot_op(out, name, &ops[i], codeOffset, instMemSizeWords);
+	}
+
+	// running off the end of the image
+	TOp *last = &ops[instMemSizeWords-1];
+	if (last->kind != T_J && last->kind != T_INVALID)
+	{
+		fprintf(out, "\n\t/* the end of the image */\n");
+		aot_badPC(out, last->pc);
+	}
+
+	fprintf(out, "}\n\n");
+	fprintf(out, "#undef U\n");
+	fprintf(out, "#undef SAVE\n");
+	fprintf(out, "#undef LOAD\n");
+
+	free(ops);
+	free(leader);
+
+	if (ferror(out))
+	{
+		printf("TranslateToC(): Could not write the translation.\n");
+		return -1;
+	}
+	return 0;
+}
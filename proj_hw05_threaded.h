@@ -0,0 +1,77 @@
+#ifndef PROJ_HW05_THREADED_H
+#define PROJ_HW05_THREADED_H
+
+
+#include "proj_hw05.h"
+
+
+
+/* a faster version of ExecFunctional(): the same (unpipelined) model,
+ * with exactly the same results, but it runs the program as threaded
+ * code instead of decoding and dispatching every instruction.
+ *
+ * The first time that execution reaches a PC, the straight-line run of
+ * instructions starting there is translated into a basic block: an array
+ * of ops, each holding the address of its handler (a computed-goto label)
+ * and its register numbers and immediate, already pulled out of the
+ * instruction.  A block ends at the first beq, bne, j or syscall (or
+ * after BLOCK_MAX_INSTS instructions), and remembers the blocks that it
+ * has jumped to, so that loops go from block to block without looking
+ * anything up.
+ *
+ * The handlers do what execute_EX(), execute_MEM() and execute_WB() would
+ * do with the control bits from execute_ID(); any instruction whose
+ * control bits don't match one of the handlers is run through those
+ * functions instead.
+ *
+ * A store into instMemory (if the caller passed overlapping memories)
+ * throws away every block that holds the word that was written; if that
+ * includes the running block, execution picks up after the store, in a
+ * newly translated block.
+ */
+void ExecThreaded(WORD *instMemory, int instMemSizeWords,
+                  WORD *regs,
+                  WORD *dataMemory, int dataMemSizeWords,
+                  WORD  codeOffset);
+
+
+/* ExecThreaded(), plus a JIT tier: once a block has run JIT_THRESHOLD
+ * times, its straight-line ops are compiled to native x86-64 code, in an
+ * executable arena.  Guest registers stay in regs[], and loads and
+ * stores go straight to dataMemory.  The block's branch or jump, any
+ * syscall, anything without a specialized handler, and any store that
+ * hits instMemory, are still done by the interpreter, so self-modifying
+ * code works just as it does in ExecThreaded().
+ *
+ * On other hosts (or if executable memory can't be mapped), this is the
+ * same as ExecThreaded().
+ */
+void ExecJIT(WORD *instMemory, int instMemSizeWords,
+             WORD *regs,
+             WORD *dataMemory, int dataMemSizeWords,
+             WORD  codeOffset);
+
+
+/* ahead-of-time translation: writes a C file to 'out' which holds one
+ * function,
+ *     void <name>(WORD *regs, WORD *dataMemory, WORD startPC);
+ * that runs the program in instMemory, from startPC, with the same results
+ * as ExecFunctional().  Every basic block is a label, and every branch and
+ * jump whose target is in the image is a goto; the only dispatch that is
+ * left is the switch on startPC at the top, which covers every block.
+ * Syscalls call execSyscall(); the file includes proj_hw05.h and
+ * proj_hw05_test_commonCode.h, and links with the rest of the simulator.
+ *
+ * The translation is of the image as it is now: unlike ExecThreaded(), it
+ * can't see a store into the program.  The ll/sc reservation is local to
+ * each call, and starts out empty, as it does in ExecFunctional().
+ *
+ * Returns 0 on success; prints a message and returns -1 on failure.
+ */
+int TranslateToC(FILE *out, const char *name,
+                 WORD *instMemory, int instMemSizeWords,
+                 WORD  codeOffset);
+
+
+#endif
+
@@ -0,0 +1,148 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <memory.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <time.h>
+
+#include "proj_hw05_trace.h"
+
+
+
+static void nap(void)
+{
+	struct timespec ts = { 0, 50*1000 };
+	nanosleep(&ts, NULL);
+}
+
+
+
+static void *trace_writerThread(void *arg)
+{
+	Tracer  *t    = arg;
+	uint64_t tail = atomic_load_explicit(&t->tail, memory_order_relaxed);
+
+	while (1)
+	{
+		uint64_t head = atomic_load_explicit(&t->head, memory_order_acquire);
+
+		if (head == tail)
+		{
+			/* the simulator sets 'stop' after its last commit, so
+			 * once we see it, one more look at 'head' tells us
+			 * whether anything is left.
+			 */
+			if (atomic_load_explicit(&t->stop, memory_order_acquire))
+			{
+				head = atomic_load_explicit(&t->head, memory_order_acquire);
+				if (head == tail)
+					break;
+				continue;
+			}
+
+			nap();
+			continue;
+		}
+
+		// write the records up to 'head', or to the end of the ring
+		uint64_t slot  = tail % TRACE_RING_SIZE;
+		uint64_t count = head - tail;
+		if (count > TRACE_RING_SIZE - slot)
+			count = TRACE_RING_SIZE - slot;
+
+		if (!t->writeError &&
+		    fwrite(&t->ring[slot], sizeof(TraceRecord), count, t->fp) != count)
+		{
+			t->writeError = errno ? errno : EIO;
+		}
+
+		tail += count;
+		atomic_store_explicit(&t->tail, tail, memory_order_release);
+	}
+
+	return NULL;
+}
+
+
+
+Tracer *Trace_open(const char *path)
+{
+	Tracer *t = calloc(1, sizeof(Tracer));
+	if (t == NULL)
+	{
+		printf("Trace_open(): Out of memory.\n");
+		return NULL;
+	}
+
+	t->ring = malloc(sizeof(TraceRecord) * TRACE_RING_SIZE);
+	if (t->ring == NULL)
+	{
+		printf("Trace_open(): Out of memory.\n");
+		free(t);
+		return NULL;
+	}
+
+	t->fp = fopen(path, "wb");
+	if (t->fp == NULL)
+	{
+		printf("Trace_open(): Could not create '%s': %s\n", path, strerror(errno));
+		free(t->ring);
+		free(t);
+		return NULL;
+	}
+
+	TraceFileHeader hdr;
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, TRACE_MAGIC, sizeof(hdr.magic));
+	hdr.version    = TRACE_VERSION;
+	hdr.recordSize = sizeof(TraceRecord);
+
+	if (fwrite(&hdr, sizeof(hdr), 1, t->fp) != 1 ||
+	    pthread_create(&t->writer, NULL, trace_writerThread, t) != 0)
+	{
+		printf("Trace_open(): Could not start the trace for '%s'.\n", path);
+		fclose(t->fp);
+		free(t->ring);
+		free(t);
+		return NULL;
+	}
+
+	return t;
+}
+
+
+
+int Trace_close(Tracer *t)
+{
+	atomic_store_explicit(&t->stop, 1, memory_order_release);
+	pthread_join(t->writer, NULL);
+
+	int rc = t->writeError ? -1 : 0;
+	if (fclose(t->fp) != 0)
+		rc = -1;
+
+	if (rc != 0)
+		printf("Trace_close(): Could not write the trace file.\n");
+
+	free(t->ring);
+	free(t);
+	return rc;
+}
+
+
+
+void Trace_waitForSpace(Tracer *t)
+{
+	uint64_t head = atomic_load_explicit(&t->head, memory_order_relaxed);
+
+	while (1)
+	{
+		t->tailSeen = atomic_load_explicit(&t->tail, memory_order_acquire);
+		if (head - t->tailSeen < TRACE_RING_SIZE)
+			return;
+
+		sched_yield();
+	}
+}
+
@@ -0,0 +1,125 @@
+#ifndef PROJ_HW05_TRACE_H
+#define PROJ_HW05_TRACE_H
+
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include "proj_hw05.h"
+
+
+
+/* a binary trace of the pipeline: one TraceRecord per clock, holding
+ * everything that Test_FullProcessor() would have printed for that clock.
+ * proj_hw05_traceDump.c turns a trace file back into that text.
+ *
+ * The simulator doesn't do any I/O itself: it fills records in a ring
+ * buffer, and a background thread writes them to the file.  If the writer
+ * falls behind, the simulator waits for it; records are never dropped.
+ */
+
+#define TRACE_STALL    0x01      // ID stalled this clock
+#define TRACE_SYSCALL  0x02      // the instruction in ID was a syscall
+
+/* the top four bits of 'flags' hold the STALL_* cause of a stall, plus
+ * one; zero means that the clock didn't count as a stall (the pipeline
+ * was draining at the end of the program).
+ */
+#define TRACE_SET_CAUSE(cause)  ((uint8_t)(((cause)+1) << 4))
+#define TRACE_CAUSE(flags)      ((int)((flags) >> 4) - 1)
+
+typedef struct TraceRecord
+{
+	uint64_t cycle;
+
+	WORD     pc;                 // the instruction in ID this clock
+	WORD     instruction;
+
+	uint8_t  flags;              // TRACE_*
+	uint8_t  branchControl;
+	uint8_t  fwd1, fwd2;         // FWD_* for the two ALU inputs
+	WORD     aluInput1, aluInput2;
+
+	uint8_t  regNum;             // register written by WB; 0xff if none
+	WORD     regOld, regNew;
+
+	int32_t  memIndx;            // word written by MEM; -1 if none
+	WORD     memOld, memNew;
+
+	// the pipeline registers written this clock
+	ID_EX    idex;
+	EX_MEM   exmem;
+	MEM_WB   memwb;
+} TraceRecord;
+
+
+/* the file starts with this header, followed by the records */
+#define TRACE_MAGIC    "HW5TRACE"
+#define TRACE_VERSION  1
+
+typedef struct TraceFileHeader
+{
+	char     magic[8];
+	uint32_t version;
+	uint32_t recordSize;         // sizeof(TraceRecord) when written
+} TraceFileHeader;
+
+
+/* the ring is single-producer (the simulator), single-consumer (the
+ * writer thread).  'head' and 'tail' count records, and only ever grow;
+ * the slot for a record is its count modulo TRACE_RING_SIZE.
+ */
+#define TRACE_RING_SIZE  (1<<16)
+
+typedef struct Tracer
+{
+	TraceRecord *ring;
+
+	_Alignas(64) _Atomic uint64_t head;    // written by the simulator
+	uint64_t                      tailSeen;
+
+	_Alignas(64) _Atomic uint64_t tail;    // written by the writer thread
+	_Atomic int                   stop;
+
+	FILE      *fp;
+	pthread_t  writer;
+	int        writeError;
+} Tracer;
+
+
+/* Trace_open() creates the file and starts the writer thread; it returns
+ * NULL (after printing a message) on error.  Trace_close() waits until
+ * every record is on disk, and returns 0 if all of the writes succeeded.
+ */
+Tracer *Trace_open (const char *path);
+int     Trace_close(Tracer *t);
+
+
+/* to add a record: Trace_reserve() returns the next free slot (waiting
+ * for the writer if the ring is full); fill it in, then call
+ * Trace_commit() to hand it to the writer.  If you don't commit, the slot
+ * is simply reused by the next reserve.
+ */
+void Trace_waitForSpace(Tracer *t);
+
+static inline TraceRecord *Trace_reserve(Tracer *t)
+{
+	uint64_t head = atomic_load_explicit(&t->head, memory_order_relaxed);
+
+	if (head - t->tailSeen >= TRACE_RING_SIZE)
+		Trace_waitForSpace(t);
+
+	return &t->ring[head % TRACE_RING_SIZE];
+}
+
+static inline void Trace_commit(Tracer *t)
+{
+	uint64_t head = atomic_load_explicit(&t->head, memory_order_relaxed);
+	atomic_store_explicit(&t->head, head+1, memory_order_release);
+}
+
+
+#endif
+
@@ -0,0 +1,229 @@
+#include <stdio.h>
+#include <memory.h>
+#include <string.h>
+
+#include "proj_hw05.h"
+#include "proj_hw05_trace.h"
+#include "proj_hw05_perf.h"
+
+
+
+/* reads a trace written by ExecProcessorTraced(), and prints it in the
+ * same format as Test_FullProcessor().
+ *
+ * Usage: proj_hw05_traceDump <trace file>
+ *
+ * Syscall output isn't part of the trace (the program printed it when it
+ * ran), and neither is the clock on which the program ended.
+ */
+
+
+
+static void dump_WB(TraceRecord *rec)
+{
+	int count = 0;
+
+	if (rec->regNum != 0xff && rec->regNew != rec->regOld)
+	{
+		count++;
+
+		printf("  REGISTER %d CHANGED.  Was: 0x%04x_%04x Now: 0x%04x_%04x\n",
+		       rec->regNum,
+		       (rec->regOld >> 16) & 0xffff,
+		       (rec->regOld      ) & 0xffff,
+		       (rec->regNew >> 16) & 0xffff,
+		       (rec->regNew      ) & 0xffff);
+	}
+
+	printf("  A total of %d registers were changed.\n", count);
+	printf("\n");
+}
+
+
+
+static void dump_ID(TraceRecord *rec)
+{
+	WORD pcPlus4     = rec->pc+4;
+	WORD instruction = rec->instruction;
+	ID_EX *out       = &rec->idex;
+
+	InstructionFields fields;
+	extract_instructionFields(instruction, &fields);
+
+	printf("Before extract_instructionFields(): pc+4=0x%04x_%04x instruction=0x%04x_%04x\n",
+	       (pcPlus4     >> 16) & 0xffff, (pcPlus4          ) & 0xffff,
+	       (instruction >> 16) & 0xffff, (instruction      ) & 0xffff);
+
+	printf("  fields.opcode = %d\n", fields.opcode);
+	printf("  fields.rs     = %d\n", fields.rs);
+	printf("  fields.rt     = %d\n", fields.rt);
+	printf("  fields.rd     = %d\n", fields.rd);
+	printf("  fields.shamt  = %d\n", fields.shamt);
+	printf("  fields.funct  = %d\n", fields.funct);
+	printf("  fields.imm16  = 0x%04x_%04x\n",
+	       (fields.imm16 >> 16) & 0xffff,
+	       (fields.imm16      ) & 0xffff);
+	printf("  fields.imm32  = 0x%04x_%04x\n",
+	       (fields.imm32 >> 16) & 0xffff,
+	       (fields.imm32      ) & 0xffff);
+	printf("  fields.address  = 0x%04x_%04x\n",
+	       (fields.address >> 16) & 0xffff,
+	       (fields.address      ) & 0xffff);
+
+	printf("  ---\n");
+
+	printf("  IDtoIF_get_stall = %d\n", (rec->flags & TRACE_STALL) != 0);
+	printf("  IDtoIF_get_branchControl = %d\n", rec->branchControl);
+
+	WORD   jumpAddr =   calc_jumpAddr(pcPlus4, &fields);
+	WORD branchAddr = calc_branchAddr(pcPlus4, &fields);
+	printf("  jumpAddr   = 0x%04x_%04x\n",
+	       (jumpAddr   >> 16) & 0xffff, (jumpAddr        ) & 0xffff);
+	printf("  branchAddr = 0x%04x_%04x\n",
+	       (branchAddr >> 16) & 0xffff, (branchAddr      ) & 0xffff);
+
+	printf("  ---\n");
+
+	printf("  ID_EX.rs = %d\n", out->rs);
+	printf("  ID_EX.rt = %d\n", out->rt);
+	printf("  ID_EX.rd = %d\n", out->rd);
+	printf("  ---\n");
+	printf("  ID_EX.rsVal = 0x%04x_%04x\n",
+	       (out->rsVal >> 16) & 0xffff, out->rsVal & 0xffff);
+	printf("  ID_EX.rtVal = 0x%04x_%04x\n",
+	       (out->rtVal >> 16) & 0xffff, out->rtVal & 0xffff);
+	printf("  ---\n");
+	printf("  ID_EX.ALUsrc      = %d\n", out->ALUsrc);
+	printf("  ID_EX.ALU.bNegate = %d\n", out->ALU.bNegate);
+	printf("  ID_EX.ALU.op      = %d\n", out->ALU.op);
+	printf("  ---\n");
+	printf("  ID_EX.memRead  = %d\n", out->memRead);
+	printf("  ID_EX.memWrite = %d\n", out->memWrite);
+	printf("  ID_EX.memToReg = %d\n", out->memToReg);
+	printf("  ---\n");
+	printf("  ID_EX.regDst   = %d\n", out->regDst);
+	printf("  ID_EX.regWrite = %d\n", out->regWrite);
+
+	printf("\n");
+
+	// a load-use stall is STALL_LOAD_USE; anything else in ID that
+	// stalls on an operand is a branch
+	if ((rec->flags & TRACE_STALL) &&
+	    TRACE_CAUSE(rec->flags) == STALL_ID_OPERAND)
+		printf("  branch stalled\n");
+}
+
+
+
+static void dump_EX(TraceRecord *rec)
+{
+	EX_MEM *out = &rec->exmem;
+
+	printf("  ALU input1 = 0x%04x_%04x\n",
+	       (rec->aluInput1 >> 16) & 0xffff, rec->aluInput1 & 0xffff);
+	printf("  ALU input2 = 0x%04x_%04x\n",
+	       (rec->aluInput2 >> 16) & 0xffff, rec->aluInput2 & 0xffff);
+
+	printf("  ---\n");
+	printf("  EX_MEM.rtVal = 0x%04x_%04x\n",
+	       (out->rtVal >> 16) & 0xffff,
+	       (out->rtVal      ) & 0xffff);
+	printf("  ---\n");
+	printf("  EX_MEM.memRead  = %d\n", out->memRead);
+	printf("  EX_MEM.memWrite = %d\n", out->memWrite);
+	printf("  EX_MEM.memToReg = %d\n", out->memToReg);
+	printf("  ---\n");
+	printf("  EX_MEM.writeReg = %d\n", out->writeReg);
+	printf("  EX_MEM.regWrite = %d\n", out->regWrite);
+	printf("  ---\n");
+	printf("  EX_MEM.aluResult = 0x%04x_%04x\n",
+	       (out->aluResult >> 16) & 0xffff, out->aluResult & 0xffff);
+	printf("\n");
+}
+
+
+
+static void dump_MEM(TraceRecord *rec)
+{
+	MEM_WB *out = &rec->memwb;
+
+	if (rec->memIndx >= 0 && rec->memNew != rec->memOld)
+	{
+		int addr = rec->memIndx*4;
+
+		printf("  MEM CHANGED: Address=0x%04x_%04x   Was: 0x%04x_%04x Now: 0x%04x_%04x\n",
+		       (addr        >> 16) & 0xffff,
+		       (addr             ) & 0xffff,
+		       (rec->memOld >> 16) & 0xffff,
+		       (rec->memOld      ) & 0xffff,
+		       (rec->memNew >> 16) & 0xffff,
+		       (rec->memNew      ) & 0xffff);
+		printf("\n");
+	}
+
+	printf("  MEM_WB.memToReg  = %d\n", out->memToReg);
+	printf("  MEM_WB.aluResult = 0x%04x_%04x\n",
+	       (out->aluResult >> 16) & 0xffff,
+	       (out->aluResult      ) & 0xffff);
+	printf("  MEM_WB.memResult = 0x%04x_%04x\n",
+	       (out->memResult >> 16) & 0xffff,
+	       (out->memResult      ) & 0xffff);
+	printf("  ---\n");
+	printf("  MEM_WB.writeReg = %d\n", out->writeReg);
+	printf("  MEM_WB.regWrite = %d\n", out->regWrite);
+	printf("\n");
+}
+
+
+
+int main(int argc, char **argv)
+{
+	if (argc != 2)
+	{
+		printf("Usage: %s <trace file>\n", argv[0]);
+		return 1;
+	}
+
+	FILE *fp = fopen(argv[1], "rb");
+	if (fp == NULL)
+	{
+		printf("ERROR: Could not open '%s'.\n", argv[1]);
+		return 1;
+	}
+
+	TraceFileHeader hdr;
+	if (fread(&hdr, sizeof(hdr), 1, fp) != 1              ||
+	    memcmp(hdr.magic, TRACE_MAGIC, sizeof(hdr.magic)) ||
+	    hdr.version    != TRACE_VERSION                    ||
+	    hdr.recordSize != sizeof(TraceRecord))
+	{
+		printf("ERROR: '%s' is not a trace from this version of the simulator.\n", argv[1]);
+		fclose(fp);
+		return 1;
+	}
+
+	TraceRecord rec;
+	while (fread(&rec, sizeof(rec), 1, fp) == 1)
+	{
+		printf("-------------- Clock %llu ---------------\n",
+		       (unsigned long long)rec.cycle);
+		printf("WB phase:\n");
+		dump_WB(&rec);
+
+		printf("ID phase:\n");
+		if ((rec.flags & TRACE_SYSCALL) == 0)
+			dump_ID(&rec);
+		else if (rec.flags & TRACE_STALL)
+			printf("  syscall stalled\n");
+
+		printf("EX phase:\n");
+		dump_EX(&rec);
+
+		printf("MEM phase:\n");
+		dump_MEM(&rec);
+	}
+
+	fclose(fp);
+	return 0;
+}
+
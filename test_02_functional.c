@@ -0,0 +1,109 @@
+#include <stdio.h>
+#include <memory.h>
+
+#include "proj_hw05.h"
+#include "proj_hw05_test_commonCode.h"
+
+
+
+#define CODE_SIZE (1024)
+#define DATA_SIZE (1024)
+
+static void init_state(WORD *regs, WORD *dataMemory)
+{
+    int i;
+    for (i=0; i<34; i++)
+        regs[i] = 0x01010101 * i;
+    regs[0] = 0;
+    for (i=0; i<DATA_SIZE; i++)
+        dataMemory[i] = 3*i + 1;
+}
+
+int main()
+{
+    WORD instMemory[CODE_SIZE];
+    WORD regsPipe[34], regsFunc[34];
+    WORD dataPipe[DATA_SIZE], dataFunc[DATA_SIZE];
+
+    memset(instMemory, 0, sizeof(instMemory));
+
+    // sum = 0; for (i=0; i<16; i++) { sum += data[i]; data[64+i] = sum; }
+    // print sum
+    //
+    // There is no NOP padding: the pipeline forwards (or stalls for) the
+    // LW result, the SW data and the branch compare, so both models must
+    // agree on the result.
+    instMemory[ 0] = ADDI(S_REG(0), REG_ZERO, 0);       // sum
+    instMemory[ 1] = ADDI(S_REG(1), REG_ZERO, 0);       // &data[i]
+    instMemory[ 2] = ADDI(S_REG(2), REG_ZERO, 64);      // 4*16
+    // loop:
+    instMemory[ 3] = LW  (T_REG(0), S_REG(1), 0);
+    instMemory[ 4] = ADD (S_REG(0), S_REG(0), T_REG(0));
+    instMemory[ 5] = SW  (S_REG(0), S_REG(1), 256);
+    instMemory[ 6] = ADDI(S_REG(1), S_REG(1), 4);
+    instMemory[ 7] = BNE (S_REG(1), S_REG(2), -5);      // to loop
+
+    instMemory[ 8] = ADDI(V_REG(0), REG_ZERO, 1);
+    instMemory[ 9] = ADD (A_REG(0), S_REG(0), REG_ZERO);
+    instMemory[10] = SYSCALL();
+
+    instMemory[11] = ADDI(V_REG(0), REG_ZERO,11);
+    instMemory[12] = ADDI(A_REG(0), REG_ZERO,0xa);
+    instMemory[13] = SYSCALL();
+
+    instMemory[14] = ADDI(V_REG(0), REG_ZERO,10);
+    instMemory[15] = SYSCALL();
+
+
+    WORD codeOffset = 0x00400000;
+
+    init_state(regsPipe, dataPipe);
+    printf("Pipelined:  ");
+    ExecProcessor(instMemory, CODE_SIZE,
+                  regsPipe,
+                  dataPipe, DATA_SIZE,
+                  codeOffset);
+
+    init_state(regsFunc, dataFunc);
+    printf("Functional: ");
+    ExecFunctional(instMemory, CODE_SIZE,
+                   regsFunc,
+                   dataFunc, DATA_SIZE,
+                   codeOffset);
+
+    if (memcmp(regsPipe, regsFunc, sizeof(regsPipe)) != 0)
+        printf("ERROR: the registers differ between the two models.\n");
+    if (memcmp(dataPipe, dataFunc, sizeof(dataPipe)) != 0)
+        printf("ERROR: data memory differs between the two models.\n");
+
+
+    // sampled: skip 12 instructions, warm up for 4, measure 10, repeat.
+    // Every handoff must preserve the architectural state.
+    WORD regsSamp[34];
+    WORD dataSamp[DATA_SIZE];
+
+    SampleConfig config;
+    SampleResult result;
+    memset(&config, 0, sizeof(config));
+    config.fastForward = 12;
+    config.warmup      = 4;
+    config.measure     = 10;
+
+    init_state(regsSamp, dataSamp);
+    printf("Sampled:    ");
+    ExecSampled(instMemory, CODE_SIZE,
+                regsSamp,
+                dataSamp, DATA_SIZE,
+                codeOffset,
+                &config, &result);
+
+    printf("%d windows: %lld instructions in %lld cycles\n",
+           result.windows, result.instructions, result.cycles);
+
+    if (memcmp(regsSamp, regsFunc, sizeof(regsSamp)) != 0)
+        printf("ERROR: the registers differ after sampling.\n");
+    if (memcmp(dataSamp, dataFunc, sizeof(dataSamp)) != 0)
+        printf("ERROR: data memory differs after sampling.\n");
+
+    return 0;
+}
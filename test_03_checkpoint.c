@@ -0,0 +1,202 @@
+#include <stdio.h>
+#include <memory.h>
+
+#include "proj_hw05.h"
+#include "proj_hw05_test_commonCode.h"
+#include "proj_hw05_checkpoint.h"
+
+
+
+#define CODE_SIZE (1024)
+#define DATA_SIZE (4096)
+
+#define CKPT_FILE "test_03_checkpoint.ckpt"
+
+#define SMC_DATA     (512)
+#define SMC_CODE_AT  (256)               // the code is in the data, here
+#define SMC_CODE     (16)
+
+// the code is part of the data, at an offset; halfway through, the loop
+// rewrites its own first instruction.  The checkpoint is taken before
+// that, so the store only reaches the code if the restored machine still
+// has the two overlapping.
+static void test_codeInData()
+{
+    WORD mem[SMC_DATA], memRef[SMC_DATA];
+    WORD *code = mem + SMC_CODE_AT;
+    WORD regs[34];
+
+    memset(mem,  0, sizeof(mem));
+    memset(regs, 0, sizeof(regs));
+
+    mem[10]  = ADDI(S_REG(0), S_REG(0), 100);
+    code[ 0] = ADDI(S_REG(0), REG_ZERO, 0);
+    code[ 1] = ADDI(S_REG(1), REG_ZERO, 40);
+    code[ 2] = ADDI(S_REG(2), REG_ZERO, 20);
+    code[ 3] = ADDI(S_REG(0), S_REG(0), 1);             // loop: becomes +100
+    code[ 4] = ADDI(S_REG(1), S_REG(1), -1);
+    code[ 5] = BNE (S_REG(1), S_REG(2), 2);             // to next
+    code[ 6] = LW  (T_REG(0), REG_ZERO, 4*10);
+    code[ 7] = SW  (T_REG(0), REG_ZERO, 4*(SMC_CODE_AT+3));
+    code[ 8] = BNE (S_REG(1), REG_ZERO, -6);            // next: to loop
+    code[ 9] = ADDI(V_REG(0), REG_ZERO, 10);
+    code[10] = SYSCALL();
+
+    WORD codeOffset = 0x00400000;
+
+    // reference: one uninterrupted run, on a copy
+    memcpy(memRef, mem, sizeof(memRef));
+    MachineState ref;
+    InitMachine(&ref, memRef + SMC_CODE_AT, SMC_CODE, regs, memRef, SMC_DATA, codeOffset);
+    printf("Code in data, reference: ");
+    ExecMachine(&ref, -1);
+
+    if (ref.regs[S_REG(0)] <= 40)
+        printf("ERROR: the self-modifying program got $s0=%d: the store never reached the code.\n",
+               ref.regs[S_REG(0)]);
+
+    MachineState m;
+    InitMachine(&m, code, SMC_CODE, regs, mem, SMC_DATA, codeOffset);
+    ExecMachine(&m, 30);
+
+    if (SaveCheckpoint(CKPT_FILE, &m) != 0)
+        return;
+
+    MachineState restored;
+    Checkpoint   ckpt;
+    if (RestoreCheckpoint(CKPT_FILE, &restored, &ckpt) != 0)
+        return;
+
+    if (restored.instMemory != restored.dataMemory + SMC_CODE_AT)
+        printf("ERROR: the restored code isn't inside the restored data.\n");
+
+    printf("Code in data, restored:  ");
+    ExecMachine(&restored, -1);
+
+    if (restored.cycles != ref.cycles ||
+        memcmp(restored.regs, ref.regs, sizeof(ref.regs)) != 0 ||
+        memcmp(restored.dataMemory, memRef, sizeof(memRef)) != 0)
+    {
+        printf("ERROR: the restored self-modifying run differs from the reference.\n");
+    }
+
+    FreeMachine(&restored);
+    ReleaseCheckpoint(&ckpt);
+
+    // code which runs off the end of the data can't be saved as one image
+    FreeMachine(&m);
+    InitMachine(&m, mem + SMC_DATA - 4, SMC_CODE, regs, mem, SMC_DATA, codeOffset);
+    if (SaveCheckpoint(CKPT_FILE, &m) == 0)
+        printf("ERROR: SaveCheckpoint() saved code which is only partly in the data.\n");
+
+    FreeMachine(&ref);
+    FreeMachine(&m);
+    remove(CKPT_FILE);
+}
+
+int main()
+{
+    WORD regs[34];
+    WORD instMemory[CODE_SIZE];
+    WORD dataMemory[DATA_SIZE], dataRef[DATA_SIZE];
+
+    int i;
+    for (i=0; i<34; i++)
+        regs[i] = 0x01010101 * i;
+    regs[0] = 0;
+    for (i=0; i<DATA_SIZE; i++)
+        dataMemory[i] = 0;
+
+    memset(instMemory, 0, sizeof(instMemory));
+
+    // fill data[i] = i*i for i in 0..99, using repeated addition; then
+    // print the last value.
+    instMemory[ 0] = ADDI(S_REG(0), REG_ZERO, 0);       // i*i
+    instMemory[ 1] = ADDI(S_REG(1), REG_ZERO, 1);       // 2i+1
+    instMemory[ 2] = ADDI(S_REG(2), REG_ZERO, 0);       // &data[i]
+    instMemory[ 3] = ADDI(S_REG(3), REG_ZERO, 400);     // &data[100]
+    instMemory[ 4] = NOP();
+    // loop:
+    instMemory[ 5] = SW  (S_REG(0), S_REG(2), 0);
+    instMemory[ 6] = ADD (S_REG(0), S_REG(0), S_REG(1));
+    instMemory[ 7] = ADDI(S_REG(1), S_REG(1), 2);
+    instMemory[ 8] = ADDI(S_REG(2), S_REG(2), 4);
+    instMemory[ 9] = NOP();
+    instMemory[10] = NOP();
+    instMemory[11] = BNE (S_REG(2), S_REG(3), -7);      // to loop
+
+    instMemory[12] = LW  (A_REG(0), REG_ZERO, 396);
+    instMemory[13] = ADDI(V_REG(0), REG_ZERO, 1);
+    instMemory[14] = NOP();
+    instMemory[15] = NOP();
+    instMemory[16] = SYSCALL();
+
+    instMemory[17] = ADDI(V_REG(0), REG_ZERO,11);
+    instMemory[18] = ADDI(A_REG(0), REG_ZERO,0xa);
+    instMemory[19] = NOP();
+    instMemory[20] = NOP();
+    instMemory[21] = SYSCALL();
+
+    instMemory[22] = ADDI(V_REG(0), REG_ZERO,10);
+    instMemory[23] = NOP();
+    instMemory[24] = NOP();
+    instMemory[25] = SYSCALL();
+
+
+    WORD codeOffset = 0x00400000;
+
+    // reference: one uninterrupted run
+    MachineState ref;
+    memcpy(dataRef, dataMemory, sizeof(dataRef));
+    InitMachine(&ref, instMemory, CODE_SIZE, regs,
+                dataRef, DATA_SIZE, codeOffset);
+    printf("Reference: ");
+    ref.printPerfAtExit = 1;
+    ExecMachine(&ref, -1);
+
+
+    // run the first 300 clocks, and save the state (in the middle of
+    // the loop, with instructions in flight)
+    MachineState m;
+    InitMachine(&m, instMemory, CODE_SIZE, regs,
+                dataMemory, DATA_SIZE, codeOffset);
+    ExecMachine(&m, 300);
+
+    if (SaveCheckpoint(CKPT_FILE, &m) != 0)
+        return 1;
+
+
+    // restore it twice; each run must finish exactly like the reference
+    int pass;
+    for (pass=0; pass<2; pass++)
+    {
+        MachineState restored;
+        Checkpoint   ckpt;
+
+        if (RestoreCheckpoint(CKPT_FILE, &restored, &ckpt) != 0)
+            return 1;
+
+        printf("Restored:  ");
+        ExecMachine(&restored, -1);
+
+        if (restored.cycles != ref.cycles)
+            printf("ERROR: the restored run took %lld cycles, not %lld.\n",
+                   restored.cycles, ref.cycles);
+        if (memcmp(restored.regs, ref.regs, sizeof(ref.regs)) != 0)
+            printf("ERROR: the registers differ after the restored run.\n");
+        if (memcmp(restored.dataMemory, dataRef, sizeof(dataRef)) != 0)
+            printf("ERROR: data memory differs after the restored run.\n");
+        if (memcmp(&restored.perf, &ref.perf, sizeof(ref.perf)) != 0)
+            printf("ERROR: the performance counters differ after the restored run.\n");
+
+        FreeMachine(&restored);
+        ReleaseCheckpoint(&ckpt);
+    }
+
+    FreeMachine(&ref);
+    FreeMachine(&m);
+    remove(CKPT_FILE);
+
+    test_codeInData();
+    return 0;
+}
@@ -0,0 +1,53 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <memory.h>
+
+#include "proj_hw05.h"
+#include "proj_hw05_test_commonCode.h"
+#include "proj_hw05_bench.h"
+
+
+
+// runs every benchmark kernel (briefly) on both models; they must agree
+// with each other, and with the expected checksum.
+int main()
+{
+    BenchProgram *pipe = malloc(sizeof(BenchProgram));
+    BenchProgram *func = malloc(sizeof(BenchProgram));
+    if (pipe == NULL || func == NULL)
+        return 1;
+
+    int i;
+    for (i=0; i<benchKernelCount; i++)
+    {
+        const BenchKernel *kernel = &benchKernels[i];
+
+        if (Bench_build(kernel, 2, pipe) != 0 ||
+            Bench_build(kernel, 2, func) != 0)
+            return 1;
+
+        printf("%-10s pipelined:  ", kernel->name);
+        ExecProcessor(pipe->instMemory, BENCH_CODE_SIZE,
+                      pipe->regs,
+                      pipe->dataMemory, BENCH_DATA_SIZE,
+                      BENCH_CODE_OFFSET);
+
+        printf("%-10s functional: ", kernel->name);
+        ExecFunctional(func->instMemory, BENCH_CODE_SIZE,
+                       func->regs,
+                       func->dataMemory, BENCH_DATA_SIZE,
+                       BENCH_CODE_OFFSET);
+
+        if (pipe->regs[V_REG(1)] != pipe->expected)
+            printf("ERROR: %s: $v1=0x%08x, expected 0x%08x\n", kernel->name,
+                   pipe->regs[V_REG(1)], pipe->expected);
+        if (memcmp(pipe->regs, func->regs, sizeof(pipe->regs)) != 0)
+            printf("ERROR: %s: the registers differ between the two models.\n", kernel->name);
+        if (memcmp(pipe->dataMemory, func->dataMemory, sizeof(pipe->dataMemory)) != 0)
+            printf("ERROR: %s: data memory differs between the two models.\n", kernel->name);
+    }
+
+    free(pipe);
+    free(func);
+    return 0;
+}
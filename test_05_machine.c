@@ -0,0 +1,127 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <memory.h>
+
+#include "proj_hw05.h"
+#include "proj_hw05_test_commonCode.h"
+#include "proj_hw05_bench.h"
+
+
+
+#define REPS 3
+
+static void start(MachineState *m, BenchProgram *prog)
+{
+    Bench_build(Bench_find("matmul"), REPS, prog);
+    InitMachine(m, prog->instMemory, BENCH_CODE_SIZE, prog->regs,
+                prog->dataMemory, BENCH_DATA_SIZE, BENCH_CODE_OFFSET);
+}
+
+static void compare(const char *what, MachineState *m, MachineState *ref)
+{
+    if (m->cycles != ref->cycles)
+        printf("ERROR: %s: %lld cycles, not %lld.\n", what, m->cycles, ref->cycles);
+    if (memcmp(m->regs, ref->regs, sizeof(ref->regs)) != 0)
+        printf("ERROR: %s: the registers differ.\n", what);
+    if (memcmp(m->dataMemory, ref->dataMemory, BENCH_DATA_SIZE*sizeof(WORD)) != 0)
+        printf("ERROR: %s: data memory differs.\n", what);
+    if (memcmp(&m->perf, &ref->perf, sizeof(ref->perf)) != 0)
+        printf("ERROR: %s: the performance counters differ.\n", what);
+}
+
+// stops at the start of the last rep
+static int lastRep(MachineState *m, const PipelineRegs *cur, void *arg)
+{
+    (void)cur;
+    (void)arg;
+
+    return m->regs[S_REG(7)] == 1;
+}
+
+int main()
+{
+    BenchProgram *refProg = malloc(sizeof(BenchProgram));
+    BenchProgram *prog    = malloc(sizeof(BenchProgram));
+    BenchProgram *prog2   = malloc(sizeof(BenchProgram));
+    if (refProg == NULL || prog == NULL || prog2 == NULL)
+        return 1;
+
+    MachineState ref, m, m2;
+
+    // reference: one uninterrupted run
+    printf("run:       ");
+    start(&ref, refProg);
+    RunMachine(&ref);
+
+
+    // one clock per call
+    printf("step(1):   ");
+    start(&m, prog);
+    while (ExecMachine(&m, 1) == 0)
+        ;
+    compare("step(1)", &m, &ref);
+    FreeMachine(&m);
+
+
+    // stop every time the top of the reps loop is fetched
+    StopCondition stop;
+    memset(&stop, 0, sizeof(stop));
+    stop.flags = STOP_AT_PC;
+    stop.pc    = BENCH_CODE_OFFSET + 4;
+
+    printf("until pc:  ");
+    start(&m, prog);
+    int stops = 0;
+    while (RunMachineUntil(&m, &stop) == 0)
+    {
+        if (m.pipe[0].pc != stop.pc)
+            printf("ERROR: stopped at pc 0x%08x\n", m.pipe[0].pc);
+        stops++;
+    }
+    if (stops != REPS)
+        printf("ERROR: stopped %d times, not %d.\n", stops, REPS);
+    compare("until pc", &m, &ref);
+    FreeMachine(&m);
+
+
+    // a cycle, then a callback
+    printf("until:     ");
+    start(&m, prog);
+
+    stop.flags = STOP_AT_CYCLE;
+    stop.cycle = 1000;
+    RunMachineUntil(&m, &stop);
+    if (m.cycles != 1000)
+        printf("ERROR: stopped at cycle %lld\n", m.cycles);
+
+    stop.flags    = STOP_ON_CALLBACK;
+    stop.callback = lastRep;
+    RunMachineUntil(&m, &stop);
+    if (m.regs[S_REG(7)] != 1)
+        printf("ERROR: the callback didn't stop the run.\n");
+
+    RunMachine(&m);
+    compare("until", &m, &ref);
+    FreeMachine(&m);
+
+
+    // two machines, taking turns
+    printf("two:       ");
+    start(&m,  prog);
+    start(&m2, prog2);
+    while (!m.halted || !m2.halted)
+    {
+        ExecMachine(&m,  137);
+        ExecMachine(&m2, 100);
+    }
+    compare("first of two",  &m,  &ref);
+    compare("second of two", &m2, &ref);
+    FreeMachine(&m);
+    FreeMachine(&m2);
+
+    FreeMachine(&ref);
+    free(refProg);
+    free(prog);
+    free(prog2);
+    return 0;
+}
@@ -0,0 +1,74 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <memory.h>
+#include <string.h>
+
+#include "proj_hw05.h"
+#include "proj_hw05_test_commonCode.h"
+#include "proj_hw05_bench.h"
+#include "proj_hw05_batch.h"
+
+
+
+#define JOBS 24
+
+// runs a mix of kernels on 4 threads; each must get its own answer, and
+// its own output.
+int main()
+{
+    BatchJob     *jobs  = calloc(JOBS, sizeof(BatchJob));
+    BenchProgram *progs = malloc(JOBS * sizeof(BenchProgram));
+    if (jobs == NULL || progs == NULL)
+        return 1;
+
+    int i;
+    for (i=0; i<JOBS; i++)
+    {
+        const BenchKernel *kernel = &benchKernels[i % benchKernelCount];
+
+        // a few long jobs at the start, so that the others must steal
+        if (Bench_build(kernel, i < 4 ? 20 : 1, &progs[i]) != 0)
+            return 1;
+
+        jobs[i].name      = kernel->name;
+        jobs[i].maxCycles = -1;
+        InitMachine(&jobs[i].m, progs[i].instMemory, BENCH_CODE_SIZE,
+                    progs[i].regs,
+                    progs[i].dataMemory, BENCH_DATA_SIZE,
+                    BENCH_CODE_OFFSET);
+    }
+
+    // one job runs out of cycles, and so prints nothing
+    jobs[JOBS-1].maxCycles = 100;
+
+    if (RunBatch(jobs, JOBS, 4, NULL) != 0)
+        return 1;
+
+    const char *exitMsg = "--- syscall 10 executed: Normal termination of the assembly language program.\n";
+
+    int ok = 0;
+    for (i=0; i<JOBS; i++)
+    {
+        BatchJob *job = &jobs[i];
+        const char *expectOut = (i == JOBS-1) ? "" : exitMsg;
+
+        if (job->output == NULL || strcmp(job->output, expectOut) != 0)
+            printf("ERROR: job %d (%s): wrong output '%s'\n", i, job->name,
+                   job->output ? job->output : "(null)");
+        else if (i != JOBS-1 && job->m.regs[V_REG(1)] != progs[i].expected)
+            printf("ERROR: job %d (%s): $v1=0x%08x, expected 0x%08x\n", i, job->name,
+                   job->m.regs[V_REG(1)], progs[i].expected);
+        else if (i == JOBS-1 && (job->m.halted || job->m.cycles != 100))
+            printf("ERROR: job %d (%s): should have stopped after 100 cycles\n", i, job->name);
+        else
+            ok++;
+
+        free(job->output);
+    }
+
+    printf("%d of %d jobs OK\n", ok, JOBS);
+
+    free(jobs);
+    free(progs);
+    return 0;
+}
@@ -0,0 +1,236 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <memory.h>
+#include <string.h>
+
+#include "proj_hw05.h"
+#include "proj_hw05_test_commonCode.h"
+#include "proj_hw05_bench.h"
+#include "proj_hw05_ensemble.h"
+
+
+
+#define CODE_SIZE (64)
+#define DATA_SIZE (64)
+
+
+// ll/sc, with a different reservation in each lane: a quarter of the
+// lanes skip the ll, and the rest reserve one of three words; the sc only
+// works in the lanes which reserved its word
+static void test_linked()
+{
+    WORD instMemory[CODE_SIZE];
+    memset(instMemory, 0, sizeof(instMemory));
+
+    instMemory[ 0] = LW  (S_REG(0), REG_ZERO, 0);      // 0, 4, 8 or 12
+    instMemory[ 1] = ADDI(T_REG(0), REG_ZERO, 5);
+    instMemory[ 2] = SC  (T_REG(0), REG_ZERO, 8);      // no ll: fails
+    instMemory[ 3] = BEQ (S_REG(0), REG_ZERO, 1);      // to skip
+    instMemory[ 4] = LL  (T_REG(1), S_REG(0), 0);
+    // skip:
+    instMemory[ 5] = ADDI(T_REG(2), T_REG(1), 1);
+    instMemory[ 6] = SC  (T_REG(2), REG_ZERO, 8);      // works if 8 was reserved
+    instMemory[ 7] = ADDI(T_REG(3), REG_ZERO, 9);
+    instMemory[ 8] = SC  (T_REG(3), REG_ZERO, 8);      // used up: fails
+    instMemory[ 9] = ADDI(V_REG(0), REG_ZERO, 10);
+    instMemory[10] = SYSCALL();
+
+    WORD regs[34];
+    memset(regs, 0, sizeof(regs));
+
+    WORD laneData[ENSEMBLE_LANES][DATA_SIZE];
+    int  lane, i;
+
+    FILE *devnull = fopen("/dev/null", "w");
+
+    Ensemble e;
+    InitEnsemble(&e, instMemory, CODE_SIZE, DATA_SIZE, 0x00400000);
+    for (lane=0; lane<ENSEMBLE_LANES; lane++)
+    {
+        memset(laneData[lane], 0, sizeof(laneData[lane]));
+        laneData[lane][0] = 4 * (lane % 4);
+        for (i=1; i<4; i++)
+            laneData[lane][i] = 10*lane + i;
+
+        SetEnsembleLane(&e, lane, regs, laneData[lane]);
+        e.out[lane] = devnull;
+    }
+    RunEnsemble(&e, -1);
+
+    int ok = 0;
+    for (lane=0; lane<ENSEMBLE_LANES; lane++)
+    {
+        WORD refData[DATA_SIZE], refRegs[34];
+        memset(refData, 0, sizeof(refData));
+        refData[0] = 4 * (lane % 4);
+        for (i=1; i<4; i++)
+            refData[i] = 10*lane + i;
+        memcpy(refRegs, regs, sizeof(refRegs));
+
+        printf("ll/sc lane %2d, ExecFunctional: ", lane);
+        ExecFunctional(instMemory, CODE_SIZE, refRegs, refData, DATA_SIZE, 0x00400000);
+
+        WORD laneRegs[34];
+        GetEnsembleLane(&e, lane, laneRegs);
+
+        if (memcmp(laneRegs, refRegs, sizeof(laneRegs)) != 0)
+            printf("ERROR: ll/sc: lane %d: the registers differ from ExecFunctional().\n", lane);
+        else if (memcmp(laneData[lane], refData, sizeof(refData)) != 0)
+            printf("ERROR: ll/sc: lane %d: memory differs from ExecFunctional().\n", lane);
+        else if (laneRegs[T_REG(2)] != (lane % 4 == 2))
+            printf("ERROR: ll/sc: lane %d: the sc returned %d.\n", lane, laneRegs[T_REG(2)]);
+        else
+            ok++;
+    }
+    printf("ll/sc: %d of %d lanes OK\n", ok, ENSEMBLE_LANES);
+
+    FreeEnsemble(&e);
+    fclose(devnull);
+}
+
+
+
+int main()
+{
+    int lane, i;
+
+    // every benchmark kernel, with all of the lanes in step
+    BenchProgram *prog = malloc(sizeof(BenchProgram));
+    WORD (*data)[BENCH_DATA_SIZE] = malloc(ENSEMBLE_LANES * sizeof(*data));
+    if (prog == NULL || data == NULL)
+        return 1;
+
+    FILE *devnull = fopen("/dev/null", "w");
+
+    for (i=0; i<benchKernelCount; i++)
+    {
+        Bench_build(&benchKernels[i], 2, prog);
+
+        Ensemble e;
+        InitEnsemble(&e, prog->instMemory, BENCH_CODE_SIZE, BENCH_DATA_SIZE,
+                     BENCH_CODE_OFFSET);
+        for (lane=0; lane<ENSEMBLE_LANES; lane++)
+        {
+            memcpy(data[lane], prog->dataMemory, sizeof(data[lane]));
+            SetEnsembleLane(&e, lane, prog->regs, data[lane]);
+            e.out[lane] = devnull;
+        }
+        RunEnsemble(&e, -1);
+
+        for (lane=0; lane<ENSEMBLE_LANES; lane++)
+        {
+            WORD regs[34];
+            GetEnsembleLane(&e, lane, regs);
+            if (regs[V_REG(1)] != prog->expected)
+                printf("ERROR: %s: lane %d: $v1=0x%08x, expected 0x%08x\n",
+                       benchKernels[i].name, lane, regs[V_REG(1)], prog->expected);
+        }
+        if (e.laneInstructions != e.steps * ENSEMBLE_LANES)
+            printf("ERROR: %s: the lanes didn't stay together.\n", benchKernels[i].name);
+
+        FreeEnsemble(&e);
+    }
+
+    fclose(devnull);
+    free(prog);
+    free(data);
+
+
+    /* a loop that runs a different number of times in every lane, with
+     * an if inside it: n = data[0];  while (n) { if (n&1) odd++;
+     * sum += n--; }  print sum+odd
+     */
+    WORD instMemory[CODE_SIZE];
+    memset(instMemory, 0, sizeof(instMemory));
+
+    instMemory[ 0] = LW  (S_REG(0), REG_ZERO, 0);
+    instMemory[ 1] = ADDI(S_REG(1), REG_ZERO, 0);
+    instMemory[ 2] = ADDI(S_REG(2), REG_ZERO, 0);
+    instMemory[ 3] = NOP();
+    // loop:
+    instMemory[ 4] = BEQ (S_REG(0), REG_ZERO, 9);       // to done
+    instMemory[ 5] = ANDI(T_REG(0), S_REG(0), 1);
+    instMemory[ 6] = NOP();
+    instMemory[ 7] = NOP();
+    instMemory[ 8] = BEQ (T_REG(0), REG_ZERO, 1);       // to even
+    instMemory[ 9] = ADDI(S_REG(2), S_REG(2), 1);
+    // even:
+    instMemory[10] = ADD (S_REG(1), S_REG(1), S_REG(0));
+    instMemory[11] = ADDI(S_REG(0), S_REG(0), -1);
+    instMemory[12] = NOP();
+    instMemory[13] = J   ((0x00400000 + 4*4) >> 2);      // to loop
+    // done:
+    instMemory[14] = ADDI(V_REG(0), REG_ZERO, 1);
+    instMemory[15] = ADD (A_REG(0), S_REG(1), S_REG(2));
+    instMemory[16] = NOP();
+    instMemory[17] = NOP();
+    instMemory[18] = SYSCALL();
+
+    instMemory[19] = ADDI(V_REG(0), REG_ZERO, 10);
+    instMemory[20] = NOP();
+    instMemory[21] = NOP();
+    instMemory[22] = SYSCALL();
+
+    WORD regs[34];
+    for (i=0; i<34; i++)
+        regs[i] = 0x01010101 * i;
+    regs[0] = 0;
+
+    WORD laneData[ENSEMBLE_LANES][DATA_SIZE];
+    char *laneOut[ENSEMBLE_LANES];
+    size_t laneOutLen[ENSEMBLE_LANES];
+
+    Ensemble e;
+    InitEnsemble(&e, instMemory, CODE_SIZE, DATA_SIZE, 0x00400000);
+    for (lane=0; lane<ENSEMBLE_LANES; lane++)
+    {
+        memset(laneData[lane], 0, sizeof(laneData[lane]));
+        laneData[lane][0] = (lane*7) % 23;
+
+        SetEnsembleLane(&e, lane, regs, laneData[lane]);
+        e.out[lane] = open_memstream(&laneOut[lane], &laneOutLen[lane]);
+    }
+    RunEnsemble(&e, -1);
+
+    int ok = 0;
+    for (lane=0; lane<ENSEMBLE_LANES; lane++)
+    {
+        fclose(e.out[lane]);
+
+        // the reference: the same lane, alone, on the pipeline
+        WORD refData[DATA_SIZE];
+        memset(refData, 0, sizeof(refData));
+        refData[0] = (lane*7) % 23;
+
+        char  *refOut;
+        size_t refOutLen;
+
+        MachineState m;
+        InitMachine(&m, instMemory, CODE_SIZE, regs, refData, DATA_SIZE, 0x00400000);
+        m.out = open_memstream(&refOut, &refOutLen);
+        RunMachine(&m);
+        fclose(m.out);
+        FreeMachine(&m);
+
+        WORD laneRegs[34];
+        GetEnsembleLane(&e, lane, laneRegs);
+
+        if (memcmp(laneRegs, m.regs, sizeof(laneRegs)) != 0)
+            printf("ERROR: lane %d: the registers differ.\n", lane);
+        else if (strcmp(laneOut[lane], refOut) != 0)
+            printf("ERROR: lane %d: printed '%s', not '%s'.\n", lane, laneOut[lane], refOut);
+        else
+            ok++;
+
+        free(refOut);
+        free(laneOut[lane]);
+    }
+
+    printf("%d of %d lanes OK; %lld lane-instructions in %lld steps\n",
+           ok, ENSEMBLE_LANES, e.laneInstructions, e.steps);
+
+    FreeEnsemble(&e);
+
+    test_linked();
+    return 0;
+}
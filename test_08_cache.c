@@ -0,0 +1,116 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <memory.h>
+
+#include "proj_hw05.h"
+#include "proj_hw05_test_commonCode.h"
+#include "proj_hw05_cache.h"
+#include "proj_hw05_bench.h"
+
+
+
+// the replacement policies, on one 4-way set: a b c d a e
+// LRU evicts b for e; tree PLRU evicts c
+static void test_replacement(int policy, WORD survivor, WORD victim)
+{
+    CacheConfig config = { 128, 4, 32, policy, 1, 1, 5 };
+    Cache c;
+    if (Cache_init(&c, &config) != 0)
+        return;
+
+    WORD seq[] = { 0x000, 0x080, 0x100, 0x180, 0x000, 0x200 };
+    int i;
+    for (i=0; i<6; i++)
+        Cache_access(&c, seq[i], 0);
+
+    if (Cache_access(&c, survivor, 0) != 0)
+        printf("ERROR: policy %d: 0x%03x should still be cached.\n", policy, survivor);
+    if (Cache_access(&c, victim, 0) == 0)
+        printf("ERROR: policy %d: 0x%03x should have been evicted.\n", policy, victim);
+
+    // a dirty line costs a writeback when it is evicted
+    Cache_flush(&c);
+    Cache_access(&c, 0x000, 1);
+    Cache_access(&c, 0x080, 0);
+    Cache_access(&c, 0x100, 0);
+    Cache_access(&c, 0x180, 0);
+    if (Cache_access(&c, 0x200, 0) != 10 || c.stats.writebacks != 1)
+        printf("ERROR: policy %d: evicting a dirty line should cost two fills.\n", policy);
+
+    Cache_free(&c);
+}
+
+
+
+// every kernel, with tiny caches: the results must not change, and every
+// extra clock must be a counted cache stall (less any load-use or branch
+// stalls that a miss hid)
+int main()
+{
+    test_replacement(CACHE_LRU,  0x000, 0x080);
+    test_replacement(CACHE_PLRU, 0x080, 0x100);
+
+    BenchProgram *plain  = malloc(sizeof(BenchProgram));
+    BenchProgram *cached = malloc(sizeof(BenchProgram));
+    if (plain == NULL || cached == NULL)
+        return 1;
+
+    CacheConfig iConfig = { 256, 1, 16, CACHE_LRU,  1, 1, 8 };
+    CacheConfig dConfig = { 256, 2, 16, CACHE_PLRU, 1, 1, 8 };
+
+    int i;
+    for (i=0; i<benchKernelCount; i++)
+    {
+        const BenchKernel *kernel = &benchKernels[i];
+
+        if (Bench_build(kernel, 2, plain)  != 0 ||
+            Bench_build(kernel, 2, cached) != 0)
+            return 1;
+
+        MachineState a, b;
+        InitMachine(&a, plain->instMemory, BENCH_CODE_SIZE, plain->regs,
+                    plain->dataMemory, BENCH_DATA_SIZE, BENCH_CODE_OFFSET);
+        InitMachine(&b, cached->instMemory, BENCH_CODE_SIZE, cached->regs,
+                    cached->dataMemory, BENCH_DATA_SIZE, BENCH_CODE_OFFSET);
+
+        Cache icache, dcache;
+        Cache_init(&icache, &iConfig);
+        Cache_init(&dcache, &dConfig);
+        b.icache = &icache;
+        b.dcache = &dcache;
+
+        printf("%-10s no caches: ", kernel->name);
+        RunMachine(&a);
+        printf("%-10s caches:    ", kernel->name);
+        RunMachine(&b);
+
+        long long cacheStalls = b.perf.stalls[STALL_ICACHE] + b.perf.stalls[STALL_DCACHE];
+        printf("%-10s %lld -> %lld cycles (%lld I-cache, %lld D-cache stalls)\n",
+               kernel->name, a.cycles, b.cycles,
+               b.perf.stalls[STALL_ICACHE], b.perf.stalls[STALL_DCACHE]);
+
+        if (memcmp(a.regs, b.regs, sizeof(a.regs)) != 0)
+            printf("ERROR: %s: the caches changed the registers.\n", kernel->name);
+        if (memcmp(plain->dataMemory, cached->dataMemory, sizeof(plain->dataMemory)) != 0)
+            printf("ERROR: %s: the caches changed data memory.\n", kernel->name);
+        if (icache.stats.readMisses == 0 || b.perf.stalls[STALL_ICACHE] == 0)
+            printf("ERROR: %s: a 256-byte I-cache should miss.\n", kernel->name);
+        // a cache miss can hide a load-use or branch stall, so it is the
+        // clocks that aren't stalls which must match
+        long long hazardsA = a.perf.stalls[STALL_LOAD_USE] + a.perf.stalls[STALL_ID_OPERAND];
+        long long hazardsB = b.perf.stalls[STALL_LOAD_USE] + b.perf.stalls[STALL_ID_OPERAND];
+        if (b.cycles - cacheStalls - hazardsB != a.cycles - hazardsA)
+            printf("ERROR: %s: %lld extra cycles, but %lld cache stalls (%lld fewer hazard stalls).\n",
+                   kernel->name, b.cycles - a.cycles, cacheStalls, hazardsA - hazardsB);
+
+        Cache_free(&icache);
+        Cache_free(&dcache);
+        FreeMachine(&a);
+        FreeMachine(&b);
+    }
+
+    free(plain);
+    free(cached);
+    return 0;
+}
+
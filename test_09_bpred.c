@@ -0,0 +1,115 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <memory.h>
+
+#include "proj_hw05.h"
+#include "proj_hw05_test_commonCode.h"
+#include "proj_hw05_bpred.h"
+#include "proj_hw05_bench.h"
+
+
+
+// a loop branch, taken 3 times and then not: after warming up, 1-bit
+// misses twice per loop, 2-bit once, and gshare (with enough history)
+// learns the pattern.
+static void test_loop(int type, int expectMisses)
+{
+    PredictorConfig config = { type, 8, 4, 0, 1 };
+    Predictor p;
+    if (Predictor_init(&p, &config) != 0)
+        return;
+
+    WORD pc = 0x00400010, target = 0x00400000;
+    int i, misses = 0;
+    for (i=0; i<400; i++)
+    {
+        int taken = (i % 4) != 3;
+        int cost  = Predictor_resolve(&p, pc, 1, taken, taken ? target : pc+4);
+
+        if (i >= 200)
+            misses += (cost != 0);
+    }
+
+    if (misses != expectMisses)
+        printf("ERROR: predictor %d: %d mispredictions in 50 loops, expected %d.\n",
+               type, misses, expectMisses);
+    if (p.stats.branches != 400 || p.siteCount != 1)
+        printf("ERROR: predictor %d: the stats are wrong.\n", type);
+
+    Predictor_free(&p);
+}
+
+
+
+int main()
+{
+    test_loop(BPRED_NOT_TAKEN, 150);
+    test_loop(BPRED_ONE_BIT,   100);
+    test_loop(BPRED_TWO_BIT,    50);
+    test_loop(BPRED_GSHARE,      0);
+
+    // with a BTB, a jump is only free once the BTB knows it
+    PredictorConfig config = { BPRED_TWO_BIT, 8, 0, 16, 3 };
+    Predictor p;
+    Predictor_init(&p, &config);
+    if (Predictor_resolve(&p, 0x00400040, 0, 1, 0x00400100) != 3 ||
+        Predictor_resolve(&p, 0x00400040, 0, 1, 0x00400100) != 0)
+        printf("ERROR: the BTB didn't learn the jump.\n");
+    Predictor_free(&p);
+
+
+    // every kernel: the results must not change, and every extra clock
+    // must be a counted misprediction
+    BenchProgram *plain = malloc(sizeof(BenchProgram));
+    BenchProgram *pred  = malloc(sizeof(BenchProgram));
+    if (plain == NULL || pred == NULL)
+        return 1;
+
+    int i;
+    for (i=0; i<benchKernelCount; i++)
+    {
+        const BenchKernel *kernel = &benchKernels[i];
+
+        if (Bench_build(kernel, 2, plain) != 0 ||
+            Bench_build(kernel, 2, pred)  != 0)
+            return 1;
+
+        MachineState a, b;
+        InitMachine(&a, plain->instMemory, BENCH_CODE_SIZE, plain->regs,
+                    plain->dataMemory, BENCH_DATA_SIZE, BENCH_CODE_OFFSET);
+        InitMachine(&b, pred->instMemory, BENCH_CODE_SIZE, pred->regs,
+                    pred->dataMemory, BENCH_DATA_SIZE, BENCH_CODE_OFFSET);
+
+        PredictorConfig gshare = { BPRED_GSHARE, 10, 6, 32, 2 };
+        Predictor_init(&p, &gshare);
+        b.bpred = &p;
+
+        printf("%-10s no predictor: ", kernel->name);
+        RunMachine(&a);
+        printf("%-10s gshare:       ", kernel->name);
+        RunMachine(&b);
+
+        long long mispredicts = p.stats.branchMispredicts + p.stats.jumpMispredicts;
+        printf("%-10s %lld -> %lld cycles, %lld mispredictions\n",
+               kernel->name, a.cycles, b.cycles, mispredicts);
+
+        if (memcmp(a.regs, b.regs, sizeof(a.regs)) != 0)
+            printf("ERROR: %s: the predictor changed the registers.\n", kernel->name);
+        if (p.stats.branches != a.perf.branchesTaken + a.perf.branchesNotTaken)
+            printf("ERROR: %s: the predictor saw %lld branches, not %lld.\n", kernel->name,
+                   p.stats.branches, a.perf.branchesTaken + a.perf.branchesNotTaken);
+        if (b.perf.stalls[STALL_MISPREDICT] != 2*mispredicts ||
+            b.cycles != a.cycles + b.perf.stalls[STALL_MISPREDICT])
+            printf("ERROR: %s: %lld extra cycles, but %lld mispredictions.\n", kernel->name,
+                   b.cycles - a.cycles, mispredicts);
+
+        Predictor_free(&p);
+        FreeMachine(&a);
+        FreeMachine(&b);
+    }
+
+    free(plain);
+    free(pred);
+    return 0;
+}
+
@@ -0,0 +1,225 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <memory.h>
+
+#include "proj_hw05.h"
+#include "proj_hw05_test_commonCode.h"
+#include "proj_hw05_threaded.h"
+#include "proj_hw05_bench.h"
+
+
+
+#define SMC_SIZE (64)
+
+typedef void (*ExecFunc)(WORD *instMemory, int instMemSizeWords,
+                         WORD *regs,
+                         WORD *dataMemory, int dataMemSizeWords,
+                         WORD  codeOffset);
+
+// code and data in one buffer, with the code at address 0.  Halfway
+// through a loop (after the JIT has compiled it), a store in the loop
+// rewrites the loop's first instruction; and at the end, a store
+// rewrites a later instruction in its own block.  Every model must see
+// the new instructions.
+static void test_selfModifying(const char *name, ExecFunc exec)
+{
+    WORD memFunc[SMC_SIZE], memTest[SMC_SIZE];
+    WORD regsFunc[34], regsTest[34];
+
+    WORD *mem = memFunc;
+    memset(mem, 0, sizeof(memFunc));
+
+    mem[ 0] = ADDI(S_REG(0), REG_ZERO, 0);
+    mem[ 1] = ADDI(S_REG(1), REG_ZERO, 40);
+    mem[ 2] = ADDI(S_REG(3), REG_ZERO, 20);
+    mem[ 3] = ADDI(T_REG(2), REG_ZERO, 4*50);           // somewhere harmless
+    // loop:
+    mem[ 4] = ADDI(S_REG(0), S_REG(0), 1);              // becomes +100
+    mem[ 5] = LW  (T_REG(0), REG_ZERO, 4*40);
+    mem[ 6] = SW  (T_REG(0), T_REG(2), 0);
+    mem[ 7] = ADDI(S_REG(1), S_REG(1), -1);
+    mem[ 8] = BNE (S_REG(1), S_REG(3), 1);
+    mem[ 9] = ADDI(T_REG(2), REG_ZERO, 4*4);            // now aim at the loop
+    mem[10] = BNE (S_REG(1), REG_ZERO, -7);             // to loop
+
+    mem[11] = LW  (T_REG(1), REG_ZERO, 4*41);
+    mem[12] = SW  (T_REG(1), REG_ZERO, 4*13);
+    mem[13] = ADDI(S_REG(2), REG_ZERO, 1);              // becomes 7
+    mem[14] = ADDI(V_REG(0), REG_ZERO, 10);
+    mem[15] = SYSCALL();
+
+    mem[40] = ADDI(S_REG(0), S_REG(0), 100);
+    mem[41] = ADDI(S_REG(2), REG_ZERO, 7);
+
+    memcpy(memTest, memFunc, sizeof(memTest));
+    memset(regsFunc, 0, sizeof(regsFunc));
+    memset(regsTest, 0, sizeof(regsTest));
+
+    printf("self-modifying ExecFunctional: ");
+    ExecFunctional(memFunc, SMC_SIZE, regsFunc, memFunc, SMC_SIZE, 0);
+    printf("self-modifying %s: ", name);
+    exec          (memTest, SMC_SIZE, regsTest, memTest, SMC_SIZE, 0);
+
+    if (regsTest[S_REG(0)] != 1921 || regsTest[S_REG(2)] != 7)
+        printf("ERROR: %s: self-modifying code: $s0=%d $s2=%d, expected 1921 and 7.\n",
+               name, regsTest[S_REG(0)], regsTest[S_REG(2)]);
+    if (memcmp(regsFunc, regsTest, sizeof(regsFunc)) != 0)
+        printf("ERROR: %s: self-modifying code: the registers differ from ExecFunctional().\n", name);
+    if (memcmp(memFunc, memTest, sizeof(memFunc)) != 0)
+        printf("ERROR: %s: self-modifying code: memory differs from ExecFunctional().\n", name);
+}
+
+
+
+#define GEN_SIZE (32)
+
+// an ll/sc pair in a loop (hot enough for the JIT): the sc has no
+// specialized op, so it runs as T_GENERIC, from the instruction word
+// that block_build() keeps in the op
+static void test_generic(const char *name, ExecFunc exec)
+{
+    WORD code[GEN_SIZE];
+    WORD dataFunc[GEN_SIZE], dataTest[GEN_SIZE];
+    WORD regsFunc[34], regsTest[34];
+
+    memset(code, 0, sizeof(code));
+    code[0] = ADDI(S_REG(0), REG_ZERO, 40);
+    // loop:
+    code[1] = LL  (T_REG(0), REG_ZERO, 4*8);
+    code[2] = ADDI(T_REG(0), T_REG(0), 3);
+    code[3] = SC  (T_REG(0), REG_ZERO, 4*8);
+    code[4] = ADD (S_REG(1), S_REG(1), T_REG(0));
+    code[5] = ADDI(S_REG(0), S_REG(0), -1);
+    code[6] = BNE (S_REG(0), REG_ZERO, -6);             // to loop
+    code[7] = ADDI(V_REG(0), REG_ZERO, 10);
+    code[8] = SYSCALL();
+
+    memset(dataFunc, 0, sizeof(dataFunc));
+    dataFunc[8] = 100;
+    memcpy(dataTest, dataFunc, sizeof(dataTest));
+    memset(regsFunc, 0, sizeof(regsFunc));
+    memset(regsTest, 0, sizeof(regsTest));
+
+    printf("generic ExecFunctional: ");
+    ExecFunctional(code, GEN_SIZE, regsFunc, dataFunc, GEN_SIZE, 0);
+    printf("generic %s: ", name);
+    exec          (code, GEN_SIZE, regsTest, dataTest, GEN_SIZE, 0);
+
+    if (dataTest[8] != 100+3*40 || regsTest[S_REG(1)] != 40)
+        printf("ERROR: %s: generic op: the counter is %d and $s1=%d, expected %d and 40.\n",
+               name, dataTest[8], regsTest[S_REG(1)], 100+3*40);
+    if (memcmp(regsFunc, regsTest, sizeof(regsFunc)) != 0)
+        printf("ERROR: %s: generic op: the registers differ from ExecFunctional().\n", name);
+    if (memcmp(dataFunc, dataTest, sizeof(dataFunc)) != 0)
+        printf("ERROR: %s: generic op: memory differs from ExecFunctional().\n", name);
+}
+
+
+
+// ll/sc, in a loop: an sc without an ll fails, one after it works, the
+// next one fails (the reservation is used up), and so does one to
+// another word
+static void test_linked(const char *name, ExecFunc exec)
+{
+    WORD code[GEN_SIZE];
+    WORD dataFunc[GEN_SIZE], dataTest[GEN_SIZE];
+    WORD regsFunc[34], regsTest[34];
+
+    memset(code, 0, sizeof(code));
+    code[ 0] = ADDI(S_REG(0), REG_ZERO, 20);
+    // loop:
+    code[ 1] = ADDI(T_REG(0), REG_ZERO, 5);
+    code[ 2] = SC  (T_REG(0), REG_ZERO, 4*20);          // no ll: fails
+    code[ 3] = LL  (T_REG(1), REG_ZERO, 4*20);
+    code[ 4] = ADDI(T_REG(2), T_REG(1), 1);
+    code[ 5] = SC  (T_REG(2), REG_ZERO, 4*20);          // works
+    code[ 6] = ADDI(T_REG(3), REG_ZERO, 9);
+    code[ 7] = SC  (T_REG(3), REG_ZERO, 4*20);          // used up: fails
+    code[ 8] = LL  (T_REG(4), REG_ZERO, 4*20);
+    code[ 9] = SC  (T_REG(4), REG_ZERO, 4*21);          // another word: fails
+    code[10] = ADD (S_REG(1), S_REG(1), T_REG(0));
+    code[11] = ADD (S_REG(1), S_REG(1), T_REG(2));
+    code[12] = ADD (S_REG(1), S_REG(1), T_REG(3));
+    code[13] = ADD (S_REG(1), S_REG(1), T_REG(4));
+    code[14] = ADDI(S_REG(0), S_REG(0), -1);
+    code[15] = BNE (S_REG(0), REG_ZERO, -15);           // to loop
+    code[16] = ADDI(V_REG(0), REG_ZERO, 10);
+    code[17] = SYSCALL();
+
+    memset(dataFunc, 0, sizeof(dataFunc));
+    dataFunc[20] = 7;
+    memcpy(dataTest, dataFunc, sizeof(dataTest));
+    memset(regsFunc, 0, sizeof(regsFunc));
+    memset(regsTest, 0, sizeof(regsTest));
+
+    printf("ll/sc ExecFunctional: ");
+    ExecFunctional(code, GEN_SIZE, regsFunc, dataFunc, GEN_SIZE, 0);
+    printf("ll/sc %s: ", name);
+    exec          (code, GEN_SIZE, regsTest, dataTest, GEN_SIZE, 0);
+
+    if (dataTest[20] != 7+20 || dataTest[21] != 0 || regsTest[S_REG(1)] != 20)
+        printf("ERROR: %s: ll/sc: the words are %d and %d, and $s1=%d; expected %d, 0 and 20.\n",
+               name, dataTest[20], dataTest[21], regsTest[S_REG(1)], 7+20);
+    if (memcmp(regsFunc, regsTest, sizeof(regsFunc)) != 0)
+        printf("ERROR: %s: ll/sc: the registers differ from ExecFunctional().\n", name);
+    if (memcmp(dataFunc, dataTest, sizeof(dataFunc)) != 0)
+        printf("ERROR: %s: ll/sc: memory differs from ExecFunctional().\n", name);
+}
+
+
+
+int main()
+{
+    static const struct {
+        const char *name;
+        ExecFunc    exec;
+    } models[] = {
+        { "ExecThreaded", ExecThreaded },
+        { "ExecJIT",      ExecJIT      },
+    };
+
+    BenchProgram *func = malloc(sizeof(BenchProgram));
+    BenchProgram *thr  = malloc(sizeof(BenchProgram));
+    if (func == NULL || thr == NULL)
+        return 1;
+
+    int i, m;
+    for (m=0; m<2; m++)
+        test_selfModifying(models[m].name, models[m].exec);
+    for (m=0; m<2; m++)
+        test_generic(models[m].name, models[m].exec);
+    for (m=0; m<2; m++)
+        test_linked(models[m].name, models[m].exec);
+
+    for (m=0; m<2; m++)
+    for (i=0; i<benchKernelCount; i++)
+    {
+        const BenchKernel *kernel = &benchKernels[i];
+
+        if (Bench_build(kernel, 3, func) != 0 ||
+            Bench_build(kernel, 3, thr)  != 0)
+            return 1;
+
+        printf("%-10s ExecFunctional: ", kernel->name);
+        ExecFunctional(func->instMemory, BENCH_CODE_SIZE, func->regs,
+                       func->dataMemory, BENCH_DATA_SIZE, BENCH_CODE_OFFSET);
+        printf("%-10s %s: ", kernel->name, models[m].name);
+        models[m].exec(thr->instMemory, BENCH_CODE_SIZE, thr->regs,
+                       thr->dataMemory, BENCH_DATA_SIZE, BENCH_CODE_OFFSET);
+
+        if (thr->regs[V_REG(1)] != thr->expected)
+            printf("ERROR: %s: %s: $v1=0x%08x, expected 0x%08x\n", models[m].name,
+                   kernel->name, thr->regs[V_REG(1)], thr->expected);
+        if (memcmp(func->regs, thr->regs, sizeof(func->regs)) != 0)
+            printf("ERROR: %s: %s: the registers differ from ExecFunctional().\n",
+                   models[m].name, kernel->name);
+        if (memcmp(func->dataMemory, thr->dataMemory, sizeof(func->dataMemory)) != 0)
+            printf("ERROR: %s: %s: data memory differs from ExecFunctional().\n",
+                   models[m].name, kernel->name);
+    }
+
+    free(func);
+    free(thr);
+    return 0;
+}
+
@@ -0,0 +1,257 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <memory.h>
+#include <string.h>
+
+#include "proj_hw05.h"
+#include "proj_hw05_test_commonCode.h"
+#include "proj_hw05_threaded.h"
+#include "proj_hw05_bench.h"
+
+
+
+// translates a program, and checks that every goto in the result has its
+// label, and that every label is in the dispatch table
+static void test_translate(const char *name, WORD *instMemory, int instMemSizeWords,
+                           WORD codeOffset, int expectLabels, int expectBadPCs)
+{
+    char  *text = NULL;
+    size_t size = 0;
+    FILE  *out  = open_memstream(&text, &size);
+    if (out == NULL)
+        return;
+
+    int rc = TranslateToC(out, name, instMemory, instMemSizeWords, codeOffset);
+    fclose(out);
+
+    if (rc != 0)
+    {
+        printf("ERROR: %s: TranslateToC() returned %d.\n", name, rc);
+        free(text);
+        return;
+    }
+
+    int labels = 0, gotos = 0, badPCs = 0;
+    char *p = text;
+    while ((p = strstr(p, "L_")) != NULL)
+    {
+        unsigned pc;
+        char     wanted[64];
+
+        if (p > text && p[-1] == '\n' && sscanf(p, "L_%x:", &pc) == 1)
+        {
+            labels++;
+            snprintf(wanted, sizeof(wanted), "case (WORD)0x%08xu: goto L_%08x;", pc, pc);
+            if (strstr(text, wanted) == NULL)
+                printf("ERROR: %s: L_%08x is not in the dispatch table.\n", name, pc);
+        }
+        else if (strncmp(p-5, "goto ", 5) == 0 && sscanf(p, "L_%x;", &pc) == 1)
+        {
+            gotos++;
+            snprintf(wanted, sizeof(wanted), "\nL_%08x:\n", pc);
+            if (strstr(text, wanted) == NULL)
+                printf("ERROR: %s: there is no label for 'goto L_%08x'.\n", name, pc);
+        }
+        p += 2;
+    }
+
+    for (p=text; (p = strstr(p, "Invalid Program Counter")) != NULL; p++)
+        badPCs++;
+
+    printf("%-10s %5d bytes of C, %2d blocks, %2d gotos\n", name, (int)size, labels, gotos);
+
+    if (expectLabels >= 0 && labels != expectLabels)
+        printf("ERROR: %s: %d blocks, expected %d.\n", name, labels, expectLabels);
+    if (badPCs != expectBadPCs)
+        printf("ERROR: %s: %d exits for an invalid PC, expected %d.\n", name, badPCs, expectBadPCs);
+
+    free(text);
+}
+
+
+
+#define AOT_SOURCE  "test_11_aot_kernels.c"
+#define AOT_EXE     "./test_11_aot_kernels"
+#define AOT_REPS    2
+
+#define LLSC_SIZE   12
+#define LLSC_DATA   32
+
+
+// ll/sc: an sc without an ll fails, one after it works, and the next one
+// fails, since the reservation is used up
+static void build_llsc(WORD *code)
+{
+    memset(code, 0, LLSC_SIZE*sizeof(WORD));
+    code[0] = ADDI(T_REG(0), REG_ZERO, 5);
+    code[1] = SC  (T_REG(0), REG_ZERO, 80);             // no ll: fails
+    code[2] = LL  (T_REG(1), REG_ZERO, 80);
+    code[3] = ADDI(T_REG(2), T_REG(1), 1);
+    code[4] = SC  (T_REG(2), REG_ZERO, 80);             // works
+    code[5] = ADDI(T_REG(3), REG_ZERO, 9);
+    code[6] = SC  (T_REG(3), REG_ZERO, 80);             // used up: fails
+    code[7] = ADDI(V_REG(0), REG_ZERO, 10);
+    code[8] = SYSCALL();
+}
+
+// everything that the translated code links with
+static const char *simSources[] = {
+    "proj_hw05.c", "proj_hw05_test_commonCode.c", "proj_hw05_trace.c",
+    "proj_hw05_checkpoint.c", "proj_hw05_perf.c", "proj_hw05_bench.c",
+    "proj_hw05_batch.c", "proj_hw05_ensemble.c", "proj_hw05_cache.c",
+    "proj_hw05_bpred.c", "proj_hw05_threaded.c", "proj_hw05_memory.c",
+    "proj_hw05_mmu.c", "proj_hw05_datafile.c", "proj_hw05_loader.c",
+};
+
+
+// the main() for the translated kernels (and the ll/sc program, in
+// 'llsc'): each one runs from the start, and its registers and data
+// memory must match ExecFunctional()'s
+static void write_checkMain(FILE *out, WORD reps, const WORD *llsc)
+{
+    int i;
+
+    fprintf(out, "\n\n\n#include <stdlib.h>\n#include <memory.h>\n");
+    fprintf(out, "#include \"proj_hw05_bench.h\"\n\n");
+    fprintf(out, "static int check(const char *name, void (*aot)(WORD*, WORD*, WORD))\n{\n");
+    fprintf(out, "    BenchProgram *func = malloc(sizeof(BenchProgram));\n");
+    fprintf(out, "    BenchProgram *test = malloc(sizeof(BenchProgram));\n");
+    fprintf(out, "    if (func == NULL || test == NULL ||\n");
+    fprintf(out, "        Bench_build(Bench_find(name), %d, func) != 0 ||\n", reps);
+    fprintf(out, "        Bench_build(Bench_find(name), %d, test) != 0)\n", reps);
+    fprintf(out, "        return 1;\n\n");
+    fprintf(out, "    ExecFunctional(func->instMemory, BENCH_CODE_SIZE, func->regs,\n");
+    fprintf(out, "                   func->dataMemory, BENCH_DATA_SIZE, BENCH_CODE_OFFSET);\n");
+    fprintf(out, "    aot(test->regs, test->dataMemory, BENCH_CODE_OFFSET);\n\n");
+    fprintf(out, "    int bad = memcmp(func->regs, test->regs, sizeof(func->regs)) != 0 ||\n");
+    fprintf(out, "              memcmp(func->dataMemory, test->dataMemory, sizeof(func->dataMemory)) != 0;\n");
+    fprintf(out, "    if (bad)\n");
+    fprintf(out, "        printf(\"ERROR: %%s: the translation doesn't match ExecFunctional().\\n\", name);\n");
+    fprintf(out, "    free(func);\n    free(test);\n    return bad;\n}\n\n");
+
+    fprintf(out, "static WORD llscCode[%d] = {", LLSC_SIZE);
+    for (i=0; i<LLSC_SIZE; i++)
+        fprintf(out, "%s0x%08x,", (i % 6 == 0) ? "\n    " : " ", llsc[i]);
+    fprintf(out, "\n};\n\n");
+    fprintf(out, "static int check_llsc()\n{\n");
+    fprintf(out, "    WORD regsFunc[34] = {0}, regsTest[34] = {0};\n");
+    fprintf(out, "    WORD dataFunc[%d] = {0}, dataTest[%d] = {0};\n", LLSC_DATA, LLSC_DATA);
+    fprintf(out, "    dataFunc[20] = dataTest[20] = 7;\n\n");
+    fprintf(out, "    ExecFunctional(llscCode, %d, regsFunc, dataFunc, %d, 0);\n", LLSC_SIZE, LLSC_DATA);
+    fprintf(out, "    aot_llsc(regsTest, dataTest, 0);\n\n");
+    fprintf(out, "    int bad = memcmp(regsFunc, regsTest, sizeof(regsFunc)) != 0 ||\n");
+    fprintf(out, "              memcmp(dataFunc, dataTest, sizeof(dataFunc)) != 0;\n");
+    fprintf(out, "    if (bad)\n");
+    fprintf(out, "        printf(\"ERROR: llsc: the translation doesn't match ExecFunctional().\\n\");\n");
+    fprintf(out, "    return bad;\n}\n\n");
+
+    fprintf(out, "int main()\n{\n    int bad = check_llsc();\n");
+    for (i=0; i<benchKernelCount; i++)
+        fprintf(out, "    bad |= check(\"%s\", aot_%s);\n", benchKernels[i].name, benchKernels[i].name);
+    fprintf(out, "    return bad;\n}\n");
+}
+
+
+// translates every kernel, and the ll/sc program, into one file, builds
+// it with the simulator, and runs it.  The sources are found next to this
+// file.
+static void test_run(BenchProgram *bench)
+{
+    FILE *out = fopen(AOT_SOURCE, "w");
+    if (out == NULL)
+    {
+        printf("ERROR: Could not write %s.\n", AOT_SOURCE);
+        return;
+    }
+
+    WORD llsc[LLSC_SIZE];
+    build_llsc(llsc);
+    if (TranslateToC(out, "aot_llsc", llsc, LLSC_SIZE, 0) != 0)
+    {
+        printf("ERROR: llsc: could not translate the program.\n");
+        fclose(out);
+        return;
+    }
+
+    int i;
+    for (i=0; i<benchKernelCount; i++)
+    {
+        char name[64];
+        snprintf(name, sizeof(name), "aot_%s", benchKernels[i].name);
+
+        if (Bench_build(&benchKernels[i], AOT_REPS, bench) != 0 ||
+            TranslateToC(out, name, bench->instMemory, bench->instCount, BENCH_CODE_OFFSET) != 0)
+        {
+            printf("ERROR: %s: could not translate the kernel.\n", benchKernels[i].name);
+            fclose(out);
+            return;
+        }
+    }
+    write_checkMain(out, AOT_REPS, llsc);
+    fclose(out);
+
+    char dir[512];
+    snprintf(dir, sizeof(dir), "%s", __FILE__);
+    char *slash = strrchr(dir, '/');
+    if (slash != NULL)
+        slash[1] = '\0';
+    else
+        strcpy(dir, "./");
+
+    char cmd[4096];
+    int  len = snprintf(cmd, sizeof(cmd), "cc -O1 -w -I%s -o %s %s", dir, AOT_EXE, AOT_SOURCE);
+    for (i=0; i < (int)(sizeof(simSources)/sizeof(simSources[0])); i++)
+        len += snprintf(cmd+len, sizeof(cmd)-len, " %s%s", dir, simSources[i]);
+    snprintf(cmd+len, sizeof(cmd)-len, " -lpthread -lm");
+
+    fflush(stdout);
+    if (system(cmd) != 0)
+        printf("ERROR: Could not build the translated kernels.\n");
+    else if (system(AOT_EXE) != 0)
+        printf("ERROR: The translated kernels don't match ExecFunctional().\n");
+    else
+        printf("translated kernels: all match ExecFunctional()\n");
+
+    remove(AOT_SOURCE);
+    remove(AOT_EXE);
+}
+
+
+
+int main()
+{
+    // a loop, a jump out of the image, and a branch that falls off the end
+    WORD prog[8];
+    prog[0] = ADDI(S_REG(0), REG_ZERO, 3);
+    prog[1] = ADDI(S_REG(0), S_REG(0), -1);                // loop:
+    prog[2] = BNE (S_REG(0), REG_ZERO, -2);                // to loop
+    prog[3] = BEQ (S_REG(0), REG_ZERO, 2);                 // to 6
+    prog[4] = J   (0x00001000);                            // out of the image
+    prog[5] = ADDI(V_REG(0), REG_ZERO, 10);
+    prog[6] = SYSCALL();
+    prog[7] = BEQ (REG_ZERO, REG_ZERO, -8);                // to 0
+
+    // blocks at 0, 1, 3, 4, 5, 6 and 7; the jump, and falling off the
+    // end after the last branch, are both invalid PCs
+    test_translate("aot_prog", prog, 8, 0x00400000, 7, 2);
+
+
+    // every kernel: the only invalid PC is the end of the image
+    BenchProgram *bench = malloc(sizeof(BenchProgram));
+    if (bench == NULL)
+        return 1;
+
+    int i;
+    for (i=0; i<benchKernelCount; i++)
+    {
+        if (Bench_build(&benchKernels[i], 2, bench) != 0)
+            return 1;
+        test_translate(benchKernels[i].name, bench->instMemory, bench->instCount,
+                       BENCH_CODE_OFFSET, -1, 1);
+    }
+
+    test_run(bench);
+
+    free(bench);
+    return 0;
+}
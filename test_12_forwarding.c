@@ -0,0 +1,135 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <memory.h>
+
+#include "proj_hw05.h"
+#include "proj_hw05_test_commonCode.h"
+
+
+
+#define CODE_SIZE  16
+#define DATA_SIZE  64
+
+// every program ends with "addi $v0,$zero,10; syscall": the syscall waits
+// two clocks for $v0
+#define EXIT_STALLS  2
+
+/* runs a few instructions, with no padding, on the pipeline and on the
+ * functional model; the results must match, with exactly the expected
+ * stalls.
+ */
+static void test_hazard(const char *name, WORD *code, int count,
+                        int expectLoadUse, int expectIdOperand)
+{
+    WORD instMemory[CODE_SIZE];
+    WORD dataPipe[DATA_SIZE], dataFunc[DATA_SIZE];
+    WORD regsPipe[34], regsFunc[34];
+
+    memset(instMemory, 0, sizeof(instMemory));
+    memcpy(instMemory, code, count*sizeof(WORD));
+    instMemory[count]   = ADDI(V_REG(0), REG_ZERO, 10);
+    instMemory[count+1] = SYSCALL();
+
+    int i;
+    for (i=0; i<DATA_SIZE; i++)
+        dataPipe[i] = dataFunc[i] = 1000+i;
+    memset(regsPipe, 0, sizeof(regsPipe));
+    memset(regsFunc, 0, sizeof(regsFunc));
+
+    MachineState m;
+    InitMachine(&m, instMemory, CODE_SIZE, regsPipe, dataPipe, DATA_SIZE, 0);
+
+    printf("%-14s pipelined:  ", name);
+    RunMachine(&m);
+    printf("%-14s functional: ", name);
+    ExecFunctional(instMemory, CODE_SIZE, regsFunc, dataFunc, DATA_SIZE, 0);
+
+    if (memcmp(m.regs, regsFunc, sizeof(regsFunc)) != 0)
+        printf("ERROR: %s: the registers differ from ExecFunctional().\n", name);
+    if (memcmp(dataPipe, dataFunc, sizeof(dataFunc)) != 0)
+        printf("ERROR: %s: data memory differs from ExecFunctional().\n", name);
+
+    if (m.perf.stalls[STALL_LOAD_USE] != expectLoadUse ||
+        m.perf.stalls[STALL_ID_OPERAND] != expectIdOperand + EXIT_STALLS)
+        printf("ERROR: %s: %lld load-use and %lld ID stalls, expected %d and %d.\n", name,
+               m.perf.stalls[STALL_LOAD_USE], m.perf.stalls[STALL_ID_OPERAND] - EXIT_STALLS,
+               expectLoadUse, expectIdOperand);
+
+    FreeMachine(&m);
+}
+
+
+
+int main()
+{
+    // EX forwarding: a LW result comes from MEM/WB's memResult
+    WORD loadUse[] = {
+        LW  (T_REG(0), REG_ZERO, 4*3),
+        ADD (T_REG(1), T_REG(0), T_REG(0)),
+        ADDI(T_REG(2), T_REG(0), 1),
+    };
+    test_hazard("load-use", loadUse, 3, 1, 0);
+
+    WORD loadGap[] = {
+        LW  (T_REG(0), REG_ZERO, 4*3),
+        ADDI(T_REG(1), REG_ZERO, 7),
+        ADD (T_REG(2), T_REG(0), T_REG(1)),
+    };
+    test_hazard("load, gap, use", loadGap, 3, 0, 0);
+
+    // SW data, from EX/MEM and MEM/WB, and from a LW in MEM
+    WORD storeData[] = {
+        ADDI(T_REG(0), REG_ZERO, 55),
+        SW  (T_REG(0), REG_ZERO, 4*10),
+        ADDI(T_REG(1), REG_ZERO, 66),
+        ADDI(T_REG(2), REG_ZERO, 0),
+        SW  (T_REG(1), REG_ZERO, 4*11),
+        LW  (T_REG(3), REG_ZERO, 4*5),
+        SW  (T_REG(3), REG_ZERO, 4*12),
+    };
+    test_hazard("store data", storeData, 7, 0, 0);
+
+    // branches compare in ID: an ALU result costs a clock, and a LW two
+    WORD branchAlu[] = {
+        ADDI(T_REG(0), REG_ZERO, 1),
+        BNE (T_REG(0), REG_ZERO, 1),
+        ADDI(S_REG(0), REG_ZERO, 99),          // skipped
+        ADDI(S_REG(1), REG_ZERO, 2),
+        ADDI(T_REG(1), REG_ZERO, 3),
+        ADDI(T_REG(2), REG_ZERO, 3),
+        ADDI(S_REG(3), REG_ZERO, 6),
+        BEQ (T_REG(1), T_REG(2), 1),           // $t2 forwarded from EX/MEM
+        ADDI(S_REG(2), REG_ZERO, 5),           // skipped
+    };
+    test_hazard("branch on ALU", branchAlu, 9, 0, 1);
+
+    WORD branchLoad[] = {
+        LW  (T_REG(0), REG_ZERO, 4*2),
+        BEQ (REG_ZERO, T_REG(0), 1),
+        ADDI(S_REG(0), REG_ZERO, 99),          // not skipped
+    };
+    test_hazard("branch on LW", branchLoad, 3, 0, 2);
+
+    // a syscall reads $v0 and $a0 from the register file
+    WORD syscall[] = {
+        ADDI(V_REG(0), REG_ZERO, 1),
+        ADDI(A_REG(0), REG_ZERO, 42),
+        SYSCALL(),
+    };
+    test_hazard("syscall", syscall, 3, 0, 2);
+
+    // exit waits for the ADDI ahead of it to reach WB (two clocks, the
+    // same as EXIT_STALLS); the exit appended by test_hazard() never runs
+    WORD exitDrain[] = {
+        ADDI(V_REG(0), REG_ZERO, 10),
+        NOP(),
+        NOP(),
+        NOP(),
+        ADDI(T_REG(0), REG_ZERO, 5),
+        SYSCALL(),
+    };
+    test_hazard("exit after ALU", exitDrain, 6, 0, 0);
+    printf("\n");
+
+    return 0;
+}
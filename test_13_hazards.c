@@ -0,0 +1,82 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <memory.h>
+
+#include "proj_hw05.h"
+#include "proj_hw05_test_commonCode.h"
+
+
+
+/* decodes 'inst' into ID/EX, as if it had just left ID */
+static void decode(WORD inst, ID_EX *idex)
+{
+    InstructionFields fields;
+    extract_instructionFields(inst, &fields);
+    memset(idex, 0, sizeof(*idex));
+    execute_ID(0, &fields, 0,0, idex);
+}
+
+/* asks the hazard unit about 'inst' in ID, with 'inEX' in EX and 'inMEM'
+ * in MEM (either can be a NOP)
+ */
+static void test_hazard(const char *name, WORD inMEM, WORD inEX, WORD inst, int expect)
+{
+    ID_EX  idex, older;
+    EX_MEM exmem;
+
+    decode(inMEM, &older);
+    memset(&exmem, 0, sizeof(exmem));
+    execute_EX(&older, 0,0, &exmem);
+    decode(inEX, &idex);
+
+    InstructionFields fields;
+    extract_instructionFields(inst, &fields);
+
+    int hazard = IDtoIF_get_hazard(&fields, &idex, &exmem);
+    printf("%-24s hazard %d\n", name, hazard);
+
+    if (hazard != expect)
+        printf("ERROR: %s: IDtoIF_get_hazard() returned %d, expected %d.\n", name, hazard, expect);
+
+    // IDtoIF_get_stall() only looks at EX
+    EX_MEM nothing;
+    memset(&nothing, 0, sizeof(nothing));
+    int expectStall = (IDtoIF_get_hazard(&fields, &idex, &nothing) != HAZARD_NONE);
+    if (IDtoIF_get_stall(&fields, &idex) != expectStall)
+        printf("ERROR: %s: IDtoIF_get_stall() doesn't agree with IDtoIF_get_hazard().\n", name);
+}
+
+
+
+int main()
+{
+    WORD loadT0 = LW(T_REG(0), S_REG(0), 4);
+    WORD addiT0 = ADDI(T_REG(0), REG_ZERO, 1);
+
+    // real load-use hazards: an ALU input, or a SW address
+    test_hazard("lw; add",           NOP(), loadT0, ADD(T_REG(1), T_REG(2), T_REG(0)), HAZARD_LOAD_USE);
+    test_hazard("lw; sw address",    NOP(), loadT0, SW(S_REG(1), T_REG(0), 0),         HAZARD_LOAD_USE);
+
+    // instructions that don't read the register: the rs bits of a jump
+    // address, and the rt of an I format instruction
+    test_hazard("lw; j",             NOP(), loadT0, J(T_REG(0) << 21),                 HAZARD_NONE);
+    test_hazard("lw; lui",           NOP(), loadT0, LUI(T_REG(0), 0x1234),             HAZARD_NONE);
+    test_hazard("lw; addi over it",  NOP(), loadT0, ADDI(T_REG(0), T_REG(1), 5),       HAZARD_NONE);
+    test_hazard("lw; nop",           NOP(), loadT0, NOP(),                             HAZARD_NONE);
+
+    // $zero never changes, and SW data is forwarded in MEM
+    test_hazard("lw $zero; add",     NOP(), LW(REG_ZERO, S_REG(0), 4),
+                                            ADD(T_REG(1), REG_ZERO, REG_ZERO),         HAZARD_NONE);
+    test_hazard("lw; sw data",       NOP(), loadT0, SW(T_REG(0), S_REG(1), 0),         HAZARD_NONE);
+
+    // ALU results are forwarded to EX
+    test_hazard("addi; add",         NOP(), addiT0, ADD(T_REG(1), T_REG(0), T_REG(0)), HAZARD_NONE);
+
+    // branches compare in ID
+    test_hazard("addi; beq",         NOP(), addiT0, BEQ(T_REG(0), REG_ZERO, 1),        HAZARD_BRANCH);
+    test_hazard("addi; x; beq",      addiT0, NOP(), BEQ(REG_ZERO, T_REG(0), 1),        HAZARD_NONE);
+    test_hazard("lw; x; bne",        loadT0, NOP(), BNE(T_REG(0), REG_ZERO, 1),        HAZARD_BRANCH);
+    test_hazard("lw; x; add",        loadT0, NOP(), ADD(T_REG(1), T_REG(0), T_REG(0)), HAZARD_NONE);
+
+    return 0;
+}
@@ -0,0 +1,192 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <memory.h>
+#include <string.h>
+
+#include "proj_hw05.h"
+#include "proj_hw05_test_commonCode.h"
+#include "proj_hw05_memory.h"
+#include "proj_hw05_bench.h"
+
+
+
+#define DATA_ADDR    0x10010000u
+#define STRING_ADDR  0x10010ffcu     // crosses into the next page
+#define STACK_ADDR   0x7ffffff0u
+
+static const char message[] = "(string across two pages)\n";
+
+
+// the page table on its own
+static void test_pages()
+{
+    GuestMemory m;
+    GuestMem_init(&m);
+
+    if (GuestMem_read(&m, 0x12345678) != 0 || m.pages != 1)
+        printf("ERROR: a new page should read as zeroes.\n");
+
+    GuestMem_write(&m, 0xfffffffc, 42);
+    GuestMem_write(&m, 0x00000000, 43);
+    if (GuestMem_read(&m, 0xfffffffc) != 42 || GuestMem_read(&m, 0) != 43 || m.pages != 3)
+        printf("ERROR: the first and last words of the address space don't work.\n");
+
+    if (GuestMem_findPage(&m, 0x40000000) != NULL || m.pages != 3)
+        printf("ERROR: GuestMem_findPage() allocated a page.\n");
+
+    WORD in[3000], out[3000];
+    int i;
+    for (i=0; i<3000; i++)
+        in[i] = i*7;
+    GuestMem_copyIn (&m, 0x20000ff0, in, 3000);
+    GuestMem_copyOut(&m, 0x20000ff0, out, 3000);
+    if (memcmp(in, out, sizeof(in)) != 0 || m.pages != 7)
+        printf("ERROR: GuestMem_copyIn() / GuestMem_copyOut() across 4 pages.\n");
+
+    printf("test_pages: %lld pages\n", m.pages);
+    GuestMem_free(&m);
+}
+
+
+
+// a program with its data at 0x10010000 and its stack just under
+// 0x80000000, on the pipeline and on the functional model
+static void test_program()
+{
+    WORD code[24];
+    memset(code, 0, sizeof(code));
+
+    code[ 0] = LUI (S_REG(0), DATA_ADDR >> 16);
+    code[ 1] = LUI (SP_REG, 0x8000);
+    code[ 2] = ADDI(SP_REG, SP_REG, -16);
+    code[ 3] = ADDI(T_REG(0), REG_ZERO, 0);
+    code[ 4] = ADDI(T_REG(1), REG_ZERO, 0);
+    code[ 5] = ADD (T_REG(2), T_REG(0), T_REG(0));      // loop:
+    code[ 6] = ADD (T_REG(2), T_REG(2), T_REG(2));
+    code[ 7] = ADD (T_REG(3), S_REG(0), T_REG(2));
+    code[ 8] = LW  (T_REG(4), T_REG(3), 0);
+    code[ 9] = ADD (T_REG(1), T_REG(1), T_REG(4));
+    code[10] = SW  (T_REG(1), T_REG(3), 64);           // running sums
+    code[11] = ADDI(T_REG(0), T_REG(0), 1);
+    code[12] = SLTI(T_REG(5), T_REG(0), 8);
+    code[13] = BNE (T_REG(5), REG_ZERO, -9);           // to loop
+    code[14] = SW  (T_REG(1), SP_REG, 0);
+    code[15] = LW  (V_REG(1), SP_REG, 0);
+    code[16] = ADDI(V_REG(0), REG_ZERO, 4);
+    code[17] = ORI (A_REG(0), S_REG(0), STRING_ADDR & 0xffff);
+    code[18] = SYSCALL();
+    code[19] = ADDI(V_REG(0), REG_ZERO, 10);
+    code[20] = SYSCALL();
+
+    GuestMemory pipeMem, funcMem;
+    GuestMem_init(&pipeMem);
+    GuestMem_init(&funcMem);
+
+    WORD values[8] = { 1,2,3,4,5,6,7,8 };
+    WORD str[8];
+    memset(str, 0, sizeof(str));
+    memcpy(str, message, sizeof(message));
+
+    GuestMem_copyIn(&pipeMem, DATA_ADDR,   values, 8);
+    GuestMem_copyIn(&pipeMem, STRING_ADDR, str,    8);
+    GuestMem_copyIn(&funcMem, DATA_ADDR,   values, 8);
+    GuestMem_copyIn(&funcMem, STRING_ADDR, str,    8);
+
+    WORD regs[34], regsFunc[34];
+    memset(regs,     0, sizeof(regs));
+    memset(regsFunc, 0, sizeof(regsFunc));
+
+    MachineState m;
+    InitMachine(&m, code, 24, regs, NULL, 0, 0x00400000);
+    m.pagedMemory = &pipeMem;
+
+    printf("paged pipelined:  ");
+    RunMachine(&m);
+    printf("paged functional: ");
+    ExecFunctionalPaged(code, 24, regsFunc, &funcMem, 0x00400000);
+
+    if (m.regs[V_REG(1)] != 36)
+        printf("ERROR: $v1 = %d, expected 36.\n", m.regs[V_REG(1)]);
+    if (memcmp(m.regs, regsFunc, sizeof(regsFunc)) != 0)
+        printf("ERROR: the pipeline's registers differ from ExecFunctionalPaged().\n");
+
+    WORD a[32], b[32];
+    GuestMem_copyOut(&pipeMem, DATA_ADDR, a, 32);
+    GuestMem_copyOut(&funcMem, DATA_ADDR, b, 32);
+    if (memcmp(a, b, sizeof(a)) != 0 || a[16+7] != 36)
+        printf("ERROR: the running sums are wrong.\n");
+
+    if (GuestMem_read(&pipeMem, STACK_ADDR) != 36)
+        printf("ERROR: the word on the stack is wrong.\n");
+
+    // data, the rest of the string, and the stack
+    if (pipeMem.pages != 3 || funcMem.pages != 3)
+        printf("ERROR: %lld and %lld pages, expected 3.\n", pipeMem.pages, funcMem.pages);
+
+    FreeMachine(&m);
+    GuestMem_free(&pipeMem);
+    GuestMem_free(&funcMem);
+}
+
+
+
+// every kernel, with its data image copied to address 0 of a paged memory:
+// the results, and the timing, must be the same as with the flat array
+static void test_kernels()
+{
+    BenchProgram *prog = malloc(sizeof(BenchProgram));
+    WORD         *data = malloc(BENCH_DATA_SIZE*sizeof(WORD));
+    if (prog == NULL || data == NULL)
+        return;
+
+    int i;
+    for (i=0; i<benchKernelCount; i++)
+    {
+        const BenchKernel *kernel = &benchKernels[i];
+        if (Bench_build(kernel, 2, prog) != 0)
+            break;
+
+        GuestMemory mem;
+        GuestMem_init(&mem);
+        GuestMem_copyIn(&mem, 0, prog->dataMemory, BENCH_DATA_SIZE);
+
+        MachineState a, b;
+        InitMachine(&a, prog->instMemory, BENCH_CODE_SIZE, prog->regs,
+                    prog->dataMemory, BENCH_DATA_SIZE, BENCH_CODE_OFFSET);
+        InitMachine(&b, prog->instMemory, BENCH_CODE_SIZE, prog->regs,
+                    NULL, 0, BENCH_CODE_OFFSET);
+        b.pagedMemory = &mem;
+
+        printf("%-10s flat:  ", kernel->name);
+        RunMachine(&a);
+        printf("%-10s paged: ", kernel->name);
+        RunMachine(&b);
+
+        GuestMem_copyOut(&mem, 0, data, BENCH_DATA_SIZE);
+
+        if (memcmp(a.regs, b.regs, sizeof(a.regs)) != 0)
+            printf("ERROR: %s: paged memory changed the registers.\n", kernel->name);
+        if (memcmp(prog->dataMemory, data, BENCH_DATA_SIZE*sizeof(WORD)) != 0)
+            printf("ERROR: %s: paged memory changed data memory.\n", kernel->name);
+        if (a.cycles != b.cycles)
+            printf("ERROR: %s: %lld cycles with paged memory, %lld without.\n",
+                   kernel->name, b.cycles, a.cycles);
+
+        FreeMachine(&a);
+        FreeMachine(&b);
+        GuestMem_free(&mem);
+    }
+
+    free(prog);
+    free(data);
+}
+
+
+
+int main()
+{
+    test_pages();
+    test_program();
+    test_kernels();
+    return 0;
+}
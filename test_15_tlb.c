@@ -0,0 +1,166 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <memory.h>
+
+#include "proj_hw05.h"
+#include "proj_hw05_test_commonCode.h"
+#include "proj_hw05_memory.h"
+#include "proj_hw05_mmu.h"
+#include "proj_hw05_bench.h"
+
+
+
+// a 4-entry, fully-associative TLB, cycling through 5 pages: LRU misses
+// every time
+static void test_tlb()
+{
+    TlbConfig bad = { 6, 2, 10 };
+    Tlb t;
+    if (Tlb_init(&t, &bad) == 0)
+        printf("ERROR: Tlb_init() accepted 6 entries.\n");
+
+    TlbConfig config = { 4, 4, 10 };
+    if (Tlb_init(&t, &config) != 0)
+        return;
+
+    int i, total = 0;
+    for (i=0; i<20; i++)
+        total += Tlb_access(&t, (i%5) * GMEM_PAGE_SIZE + 4*i);
+
+    if (total != 20*10 || Tlb_access(&t, 4*GMEM_PAGE_SIZE + 8) != 0)
+        printf("ERROR: 5 pages in a 4-entry TLB cost %d clocks, expected 200.\n", total);
+
+    Tlb_free(&t);
+}
+
+
+
+// the same program, with and without virtual memory: the results must be
+// the same, and the physical pages must be where Mmu_map() put them
+static void test_mmu()
+{
+    WORD code[16];
+    memset(code, 0, sizeof(code));
+    code[0] = LUI (S_REG(0), 0x1001);                   // virtual page
+    code[1] = ADDI(T_REG(0), REG_ZERO, 77);
+    code[2] = SW  (T_REG(0), S_REG(0), 8);
+    code[3] = LUI (S_REG(1), 0x2000);                   // its alias
+    code[4] = LW  (V_REG(1), S_REG(1), 8);
+    code[5] = SW  (V_REG(1), REG_ZERO, 12);             // unmapped: itself
+    code[6] = ADDI(V_REG(0), REG_ZERO, 10);
+    code[7] = SYSCALL();
+
+    GuestMemory phys;
+    GuestMem_init(&phys);
+
+    Mmu mmu;
+    Mmu_init(&mmu, &phys);
+    if (Mmu_map(&mmu, 0x10010000, 0x00005000, 4) != 0 ||
+        Mmu_map(&mmu, 0x20000000, 0x00005000, GMEM_PAGE_SIZE) != 0)
+        return;
+    if (Mmu_map(&mmu, 0x10010004, 0, 4) == 0)
+        printf("ERROR: Mmu_map() accepted an unaligned address.\n");
+
+    WORD regs[34];
+    memset(regs, 0, sizeof(regs));
+
+    MachineState m;
+    InitMachine(&m, code, 16, regs, NULL, 0, 0x00400000);
+    m.mmu = &mmu;
+
+    printf("mmu: ");
+    RunMachine(&m);
+
+    if (m.regs[V_REG(1)] != 77)
+        printf("ERROR: the alias read %d, expected 77.\n", m.regs[V_REG(1)]);
+    if (GuestMem_read(&phys, 0x5008) != 77 || GuestMem_read(&phys, 12) != 77)
+        printf("ERROR: the stores didn't land in the mapped physical pages.\n");
+    if (GuestMem_findPage(&phys, 0x10010000) != NULL)
+        printf("ERROR: a mapped virtual page was used as a physical one.\n");
+    if (Mmu_translate(&mmu, 0x20000abc) != 0x5abc || Mmu_translate(&mmu, 0x30000abc) != 0x30000abc)
+        printf("ERROR: Mmu_translate() is wrong.\n");
+
+    FreeMachine(&m);
+    Mmu_free(&mmu);
+    GuestMem_free(&phys);
+}
+
+
+
+// every kernel, with tiny TLBs: the results must not change, and every
+// extra clock must be a counted TLB stall (less any hazard stalls that a
+// miss hid)
+static void test_kernels()
+{
+    BenchProgram *plain  = malloc(sizeof(BenchProgram));
+    BenchProgram *tlbed  = malloc(sizeof(BenchProgram));
+    if (plain == NULL || tlbed == NULL)
+        return;
+
+    TlbConfig iConfig = { 1, 1, 5 };
+    TlbConfig dConfig = { 2, 1, 7 };
+
+    int i;
+    for (i=0; i<benchKernelCount; i++)
+    {
+        const BenchKernel *kernel = &benchKernels[i];
+
+        if (Bench_build(kernel, 2, plain) != 0 ||
+            Bench_build(kernel, 2, tlbed) != 0)
+            break;
+
+        MachineState a, b;
+        InitMachine(&a, plain->instMemory, BENCH_CODE_SIZE, plain->regs,
+                    plain->dataMemory, BENCH_DATA_SIZE, BENCH_CODE_OFFSET);
+        InitMachine(&b, tlbed->instMemory, BENCH_CODE_SIZE, tlbed->regs,
+                    tlbed->dataMemory, BENCH_DATA_SIZE, BENCH_CODE_OFFSET);
+
+        Tlb itlb, dtlb;
+        Tlb_init(&itlb, &iConfig);
+        Tlb_init(&dtlb, &dConfig);
+        b.itlb = &itlb;
+        b.dtlb = &dtlb;
+
+        printf("%-10s no TLBs: ", kernel->name);
+        RunMachine(&a);
+        printf("%-10s TLBs:    ", kernel->name);
+        RunMachine(&b);
+
+        long long tlbStalls = b.perf.stalls[STALL_ITLB] + b.perf.stalls[STALL_DTLB];
+        printf("%-10s %lld -> %lld cycles (%lld I-TLB, %lld D-TLB stalls)\n",
+               kernel->name, a.cycles, b.cycles,
+               b.perf.stalls[STALL_ITLB], b.perf.stalls[STALL_DTLB]);
+
+        if (memcmp(a.regs, b.regs, sizeof(a.regs)) != 0)
+            printf("ERROR: %s: the TLBs changed the registers.\n", kernel->name);
+        if (memcmp(plain->dataMemory, tlbed->dataMemory, sizeof(plain->dataMemory)) != 0)
+            printf("ERROR: %s: the TLBs changed data memory.\n", kernel->name);
+        if (b.perf.stalls[STALL_DTLB] != dtlb.lines.stats.readMisses * dConfig.missLatency)
+            printf("ERROR: %s: %lld D-TLB stalls for %lld misses.\n", kernel->name,
+                   b.perf.stalls[STALL_DTLB], dtlb.lines.stats.readMisses);
+
+        long long hazardsA = a.perf.stalls[STALL_LOAD_USE] + a.perf.stalls[STALL_ID_OPERAND];
+        long long hazardsB = b.perf.stalls[STALL_LOAD_USE] + b.perf.stalls[STALL_ID_OPERAND];
+        if (b.cycles - tlbStalls - hazardsB != a.cycles - hazardsA)
+            printf("ERROR: %s: %lld extra cycles, but %lld TLB stalls (%lld fewer hazard stalls).\n",
+                   kernel->name, b.cycles - a.cycles, tlbStalls, hazardsA - hazardsB);
+
+        Tlb_free(&itlb);
+        Tlb_free(&dtlb);
+        FreeMachine(&a);
+        FreeMachine(&b);
+    }
+
+    free(plain);
+    free(tlbed);
+}
+
+
+
+int main()
+{
+    test_tlb();
+    test_mmu();
+    test_kernels();
+    return 0;
+}
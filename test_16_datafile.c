@@ -0,0 +1,119 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <memory.h>
+
+#include "proj_hw05.h"
+#include "proj_hw05_test_commonCode.h"
+#include "proj_hw05_datafile.h"
+
+
+
+#define DATA_FILE   "test_16_datafile.dat"
+
+#define FILE_WORDS  256              // the input image
+#define DATA_SIZE   8192             // the data memory; the rest is zeroes
+#define EXPECTED    (3*2016)         // 3 * (0 + 1 + ... + 63)
+
+
+// sums the first 64 words, and stores the sum inside the input image
+// (word 200) and past its end (word 5000)
+static void build(WORD *code)
+{
+    memset(code, 0, 16*sizeof(WORD));
+    code[ 0] = ADDI(T_REG(0), REG_ZERO, 0);
+    code[ 1] = ADDI(T_REG(1), REG_ZERO, 0);
+    code[ 2] = LW  (T_REG(2), T_REG(0), 0);            // loop:
+    code[ 3] = ADD (T_REG(1), T_REG(1), T_REG(2));
+    code[ 4] = ADDI(T_REG(0), T_REG(0), 4);
+    code[ 5] = SLTI(T_REG(3), T_REG(0), 4*64);
+    code[ 6] = BNE (T_REG(3), REG_ZERO, -5);           // to loop
+    code[ 7] = SW  (T_REG(1), REG_ZERO, 4*200);
+    code[ 8] = SW  (T_REG(1), REG_ZERO, 4*5000);
+    code[ 9] = ADDI(V_REG(0), REG_ZERO, 10);
+    code[10] = SYSCALL();
+}
+
+
+// reads the whole file back; returns the number of words
+static int read_file(WORD *buf, int maxWords)
+{
+    FILE *fp = fopen(DATA_FILE, "rb");
+    if (fp == NULL)
+        return -1;
+    int n = fread(buf, sizeof(WORD), maxWords, fp);
+    fclose(fp);
+    return n;
+}
+
+
+static void run(const char *name, int mode, WORD *code)
+{
+    WORD regs[34];
+    memset(regs, 0, sizeof(regs));
+
+    DataFile df;
+    if (DataFile_open(&df, DATA_FILE, DATA_SIZE, mode) != 0)
+    {
+        printf("ERROR: %s: DataFile_open() failed.\n", name);
+        return;
+    }
+
+    printf("%-8s ", name);
+    ExecProcessor(code, 16, regs, df.words, df.sizeWords, 0);
+
+    if (df.words[200] != EXPECTED || df.words[5000] != EXPECTED || df.words[DATA_SIZE-1] != 0)
+        printf("ERROR: %s: the program's results aren't in memory.\n", name);
+
+    DataFile_sync(&df);
+    DataFile_close(&df);
+}
+
+
+
+int main()
+{
+    WORD code[16];
+    build(code);
+
+    WORD *image = malloc(DATA_SIZE*sizeof(WORD));
+    WORD *after = malloc(DATA_SIZE*sizeof(WORD));
+    if (image == NULL || after == NULL)
+        return 1;
+
+    int i;
+    for (i=0; i<FILE_WORDS; i++)
+        image[i] = 3*i;
+
+    FILE *fp = fopen(DATA_FILE, "wb");
+    if (fp == NULL || fwrite(image, sizeof(WORD), FILE_WORDS, fp) != FILE_WORDS)
+    {
+        printf("ERROR: Could not write %s.\n", DATA_FILE);
+        return 1;
+    }
+    fclose(fp);
+
+    // copy-on-write: the file doesn't change
+    run("private", DATAFILE_PRIVATE, code);
+    if (read_file(after, DATA_SIZE) != FILE_WORDS ||
+        memcmp(image, after, FILE_WORDS*sizeof(WORD)) != 0)
+        printf("ERROR: DATAFILE_PRIVATE changed the file.\n");
+
+    // shared: the file is extended, and holds the results afterwards
+    run("shared", DATAFILE_SHARED, code);
+    image[200] = EXPECTED;
+    if (read_file(after, DATA_SIZE) != DATA_SIZE ||
+        memcmp(image, after, FILE_WORDS*sizeof(WORD)) != 0 ||
+        after[5000] != EXPECTED)
+        printf("ERROR: DATAFILE_SHARED didn't leave the results in the file.\n");
+
+    // the size of the file, by default
+    DataFile df;
+    if (DataFile_open(&df, DATA_FILE, 0, DATAFILE_PRIVATE) != 0 || df.sizeWords != DATA_SIZE)
+        printf("ERROR: DataFile_open() didn't use the size of the file.\n");
+    DataFile_close(&df);
+
+    remove(DATA_FILE);
+    free(image);
+    free(after);
+    return 0;
+}
@@ -0,0 +1,290 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <memory.h>
+#include <string.h>
+#include <elf.h>
+
+#include "proj_hw05.h"
+#include "proj_hw05_test_commonCode.h"
+#include "proj_hw05_memory.h"
+#include "proj_hw05_loader.h"
+
+
+
+#define ELF_LE_FILE  "test_17_loader_le.elf"
+#define ELF_BE_FILE  "test_17_loader_be.elf"
+#define RAW_FILE     "test_17_loader.bin"
+#define BAD_FILE     "test_17_loader_bad.elf"
+
+#define TEXT_ADDR    0x00400000u
+#define TEXT_OFFSET  0x1000u             // in the file
+#define TEXT_WORDS   20000               // more than the old 16K words
+#define ENTRY        2                   // the word that the program starts at
+#define FAR          18000               // where it branches to
+
+#define DATA_ADDR    0x10010010u         // not on a page boundary...
+#define DATA_OFFSET  0x15010u            // ...but lined up with the file
+#define DATA_WORDS   2500                // three pages, the middle one whole
+#define DATA_MEMSZ   0x8000u             // the rest is .bss
+
+#define EXPECTED     (1000 + 1532+1000 + 2499+1000)
+
+
+// words 0 and 1 end the program, so it only works if it starts at ENTRY
+static void build_text(WORD *code)
+{
+    memset(code, 0, TEXT_WORDS*sizeof(WORD));
+    code[ 0] = ADDI(V_REG(0), REG_ZERO, 10);
+    code[ 1] = SYSCALL();
+    code[ 2] = LUI (S_REG(0), DATA_ADDR >> 16);
+    code[ 3] = LW  (T_REG(0), S_REG(0), 0x0010);        // the first word
+    code[ 4] = LW  (T_REG(1), S_REG(0), 0x1800);        // in the whole page
+    code[ 5] = LW  (T_REG(2), S_REG(0), 0x271c);        // the last word
+    code[ 6] = LW  (T_REG(3), S_REG(0), 0x2720);        // .bss, on the same page
+    code[ 7] = LW  (T_REG(4), S_REG(0), 0x6000);        // .bss, on its own page
+    code[ 8] = ADD (T_REG(0), T_REG(0), T_REG(1));
+    code[ 9] = ADD (T_REG(0), T_REG(0), T_REG(2));
+    code[10] = ADD (T_REG(0), T_REG(0), T_REG(3));
+    code[11] = ADD (T_REG(0), T_REG(0), T_REG(4));
+    code[12] = SW  (T_REG(0), S_REG(0), 0x1800);        // copy-on-write
+    code[13] = LUI (T_REG(5), TEXT_ADDR >> 16);
+    code[14] = LW  (T_REG(6), T_REG(5), 4*ENTRY);       // the text, as data
+    code[15] = BEQ (REG_ZERO, REG_ZERO, FAR-16);
+
+    code[FAR  ] = LW  (V_REG(1), S_REG(0), 0x1800);
+    code[FAR+1] = ADDI(V_REG(0), REG_ZERO, 10);
+    code[FAR+2] = SYSCALL();
+}
+
+
+static uint32_t order32(uint32_t x, int swap) { return swap ? __builtin_bswap32(x) : x; }
+static uint16_t order16(uint16_t x, int swap) { return swap ? __builtin_bswap16(x) : x; }
+
+
+static int write_at(FILE *fp, long offset, const void *buf, size_t len)
+{
+    return fseek(fp, offset, SEEK_SET) == 0 && fwrite(buf, 1, len, fp) == len ? 0 : -1;
+}
+
+
+// an executable with the text and data segments, in either byte order.
+// With 'badData', the data segment runs past the end of the file.
+static int write_elf(const char *path, const WORD *code, const WORD *data,
+                     int bigEndian, int badData)
+{
+    int swap = bigEndian;          // the host is little-endian
+
+    Elf32_Ehdr eh;
+    memset(&eh, 0, sizeof(eh));
+    memcpy(eh.e_ident, ELFMAG, SELFMAG);
+    eh.e_ident[EI_CLASS]   = ELFCLASS32;
+    eh.e_ident[EI_DATA]    = bigEndian ? ELFDATA2MSB : ELFDATA2LSB;
+    eh.e_ident[EI_VERSION] = EV_CURRENT;
+    eh.e_type      = order16(ET_EXEC, swap);
+    eh.e_machine   = order16(EM_MIPS, swap);
+    eh.e_version   = order32(EV_CURRENT, swap);
+    eh.e_entry     = order32(TEXT_ADDR + 4*ENTRY, swap);
+    eh.e_phoff     = order32(sizeof(eh), swap);
+    eh.e_ehsize    = order16(sizeof(eh), swap);
+    eh.e_phentsize = order16(sizeof(Elf32_Phdr), swap);
+    eh.e_phnum     = order16(2, swap);
+
+    Elf32_Phdr ph[2];
+    memset(ph, 0, sizeof(ph));
+    ph[0].p_type   = order32(PT_LOAD, swap);
+    ph[0].p_offset = order32(TEXT_OFFSET, swap);
+    ph[0].p_vaddr  = order32(TEXT_ADDR, swap);
+    ph[0].p_filesz = order32(TEXT_WORDS*4, swap);
+    ph[0].p_memsz  = order32(TEXT_WORDS*4, swap);
+    ph[0].p_flags  = order32(PF_R|PF_X, swap);
+    ph[0].p_align  = order32(0x1000, swap);
+    ph[1].p_type   = order32(PT_LOAD, swap);
+    ph[1].p_offset = order32(DATA_OFFSET, swap);
+    ph[1].p_vaddr  = order32(DATA_ADDR, swap);
+    ph[1].p_filesz = order32(badData ? DATA_MEMSZ : DATA_WORDS*4, swap);
+    ph[1].p_memsz  = order32(DATA_MEMSZ, swap);
+    ph[1].p_flags  = order32(PF_R|PF_W, swap);
+    ph[1].p_align  = order32(0x1000, swap);
+
+    WORD *text = malloc(TEXT_WORDS*sizeof(WORD));
+    WORD  init[DATA_WORDS];
+    if (text == NULL)
+        return -1;
+
+    int i;
+    for (i=0; i<TEXT_WORDS; i++)
+        text[i] = order32(code[i], swap);
+    for (i=0; i<DATA_WORDS; i++)
+        init[i] = order32(data[i], swap);
+
+    FILE *fp = fopen(path, "wb");
+    int rc = (fp == NULL ||
+              write_at(fp, 0,           &eh,  sizeof(eh))                 != 0 ||
+              write_at(fp, sizeof(eh),  ph,   sizeof(ph))                 != 0 ||
+              write_at(fp, TEXT_OFFSET, text, TEXT_WORDS*sizeof(WORD))   != 0 ||
+              write_at(fp, DATA_OFFSET, init, DATA_WORDS*sizeof(WORD))   != 0) ? -1 : 0;
+    if (fp != NULL)
+        fclose(fp);
+    free(text);
+    return rc;
+}
+
+
+static int same_file(const char *path, const char *before, long size)
+{
+    char *after = malloc(size+1);
+    FILE *fp    = fopen(path, "rb");
+    int   same  = (after != NULL && fp != NULL &&
+                   fread(after, 1, size+1, fp) == (size_t)size &&
+                   memcmp(before, after, size) == 0);
+    if (fp != NULL)
+        fclose(fp);
+    free(after);
+    return same;
+}
+
+
+static char *read_file(const char *path, long *size)
+{
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL)
+        return NULL;
+    fseek(fp, 0, SEEK_END);
+    *size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    char *buf = malloc(*size);
+    if (buf != NULL && fread(buf, 1, *size, fp) != (size_t)*size)
+    {
+        free(buf);
+        buf = NULL;
+    }
+    fclose(fp);
+    return buf;
+}
+
+
+// loads and runs one image; 'rodata' is the word that the program reads
+// back from the text
+static void run(const char *name, const char *path, int isELF,
+                const WORD *data, WORD rodata, long long attached)
+{
+    long  size = 0;
+    char *before = read_file(path, &size);
+
+    GuestMemory mem;
+    GuestMem_init(&mem);
+
+    ProgramImage img;
+    int rc;
+    if (isELF)
+        rc = Loader_loadELF(&img, path, &mem);
+    else
+    {
+        rc = Loader_loadRaw(&img, path, TEXT_ADDR, LOADER_LITTLE_ENDIAN, &mem);
+        if (rc == 0)
+            rc = GuestMem_copyIn(&mem, DATA_ADDR, data, DATA_WORDS);
+    }
+    if (rc != 0 || before == NULL)
+    {
+        printf("ERROR: %s: could not load '%s'.\n", name, path);
+        free(before);
+        return;
+    }
+
+    if (mem.attachedPages != attached)
+        printf("ERROR: %s: %lld pages attached, expected %lld.\n", name, mem.attachedPages, attached);
+
+    WORD regs[34];
+    memset(regs, 0, sizeof(regs));
+
+    MachineState m;
+    Loader_initMachine(&m, &img, regs, &mem);
+
+    printf("%-8s ", name);
+    RunMachine(&m);
+
+    if (m.regs[V_REG(1)] != EXPECTED)
+        printf("ERROR: %s: $v1 = %d, expected %d.\n", name, m.regs[V_REG(1)], EXPECTED);
+    if (m.regs[T_REG(6)] != rodata)
+        printf("ERROR: %s: the text reads as 0x%08x in data memory, expected 0x%08x.\n",
+               name, m.regs[T_REG(6)], rodata);
+    if (!same_file(path, before, size))
+        printf("ERROR: %s: running the program changed '%s'.\n", name, path);
+
+    FreeMachine(&m);
+    GuestMem_free(&mem);
+    Loader_free(&img);
+    free(before);
+}
+
+
+
+int main()
+{
+    WORD *code = malloc(TEXT_WORDS*sizeof(WORD));
+    WORD  data[DATA_WORDS];
+    if (code == NULL)
+        return 1;
+    build_text(code);
+
+    int i;
+    for (i=0; i<DATA_WORDS; i++)
+        data[i] = 1000+i;
+
+    if (write_elf(ELF_LE_FILE, code, data, 0, 0) != 0 ||
+        write_elf(ELF_BE_FILE, code, data, 1, 0) != 0 ||
+        write_elf(BAD_FILE,    code, data, 0, 1) != 0)
+    {
+        printf("ERROR: Could not write the ELF files.\n");
+        return 1;
+    }
+
+    // a raw image starts at its first word: leave off the two that exit
+    FILE *fp = fopen(RAW_FILE, "wb");
+    if (fp == NULL || fwrite(code+ENTRY, sizeof(WORD), TEXT_WORDS-ENTRY, fp) != TEXT_WORDS-ENTRY)
+    {
+        printf("ERROR: Could not write %s.\n", RAW_FILE);
+        return 1;
+    }
+    fclose(fp);
+
+    /* the text has 19 whole pages; the data, 1.  The big-endian image
+     * and the raw one are attached as well (the first has been swapped
+     * in its private mapping, the second is all text).
+     */
+    run("elf-le", ELF_LE_FILE, 1, data, code[ENTRY],   20);
+    run("elf-be", ELF_BE_FILE, 1, data, code[ENTRY],   20);
+    run("raw",    RAW_FILE,    0, data, code[ENTRY+2], 19);
+
+    // a raw binary isn't an ELF file
+    ProgramImage img;
+    if (Loader_loadELF(&img, RAW_FILE, NULL) == 0)
+    {
+        printf("ERROR: Loader_loadELF() accepted a raw binary.\n");
+        Loader_free(&img);
+    }
+
+    /* the text is attached before the bad data segment is found; once
+     * the load fails, none of it may be left pointing at the file
+     */
+    GuestMemory mem;
+    GuestMem_init(&mem);
+    if (Loader_loadELF(&img, BAD_FILE, &mem) == 0)
+    {
+        printf("ERROR: Loader_loadELF() accepted a segment past the end of the file.\n");
+        Loader_free(&img);
+    }
+    else if (mem.attachedPages != 0 || GuestMem_findPage(&mem, TEXT_ADDR + 0x1000) != NULL)
+        printf("ERROR: a failed load left %lld pages attached.\n", mem.attachedPages);
+    else if (GuestMem_read(&mem, TEXT_ADDR + 0x1000) != 0)
+        printf("ERROR: a page from a failed load doesn't read as zeroes.\n");
+    GuestMem_free(&mem);
+
+    remove(ELF_LE_FILE);
+    remove(ELF_BE_FILE);
+    remove(RAW_FILE);
+    remove(BAD_FILE);
+    free(code);
+    return 0;
+}
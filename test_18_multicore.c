@@ -0,0 +1,216 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <memory.h>
+#include <string.h>
+
+#include "proj_hw05.h"
+#include "proj_hw05_test_commonCode.h"
+#include "proj_hw05_perf.h"
+
+
+
+#define CODE_SIZE   16
+#define DATA_SIZE   1024
+#define COUNTER     0x100            // the shared counter
+#define ITERATIONS  50
+
+
+// every core adds 1 to the counter ITERATIONS times; $s1 counts the sc's
+// which failed.  With 'atomic' clear, it uses a plain lw/sw instead.
+static void build_counter(WORD *code, int atomic)
+{
+    memset(code, 0, CODE_SIZE*sizeof(WORD));
+    code[0] = ADDI(T_REG(0), REG_ZERO, ITERATIONS);
+    if (atomic)
+    {
+        code[1] = LL  (T_REG(1), REG_ZERO, COUNTER);        // loop:
+        code[2] = ADDI(T_REG(1), T_REG(1), 1);
+        code[3] = SC  (T_REG(1), REG_ZERO, COUNTER);
+        code[4] = BNE (T_REG(1), REG_ZERO, 2);              // to done
+        code[5] = ADDI(S_REG(1), S_REG(1), 1);
+        code[6] = BEQ (REG_ZERO, REG_ZERO, -6);             // to loop
+    }
+    else
+    {
+        code[1] = LW  (T_REG(1), REG_ZERO, COUNTER);        // loop:
+        code[2] = ADDI(T_REG(1), T_REG(1), 1);
+        code[3] = SW  (T_REG(1), REG_ZERO, COUNTER);
+        code[4] = NOP();
+        code[5] = NOP();
+        code[6] = NOP();
+    }
+    code[7] = ADDI(T_REG(0), T_REG(0), -1);                // done:
+    code[8] = BNE (T_REG(0), REG_ZERO, -8);                // to loop
+    code[9] = ADDI(V_REG(0), REG_ZERO, 10);
+    code[10] = SYSCALL();
+}
+
+
+// ll/sc on one core: an sc without an ll fails, and one after it works
+static void test_single()
+{
+    WORD code[CODE_SIZE], data[DATA_SIZE];
+    memset(code, 0, sizeof(code));
+    memset(data, 0, sizeof(data));
+    data[COUNTER/4] = 7;
+
+    code[0] = ADDI(T_REG(0), REG_ZERO, 5);
+    code[1] = SC  (T_REG(0), REG_ZERO, COUNTER);           // no ll: fails
+    code[2] = LL  (T_REG(1), REG_ZERO, COUNTER);
+    code[3] = ADDI(T_REG(2), T_REG(1), 1);
+    code[4] = SC  (T_REG(2), REG_ZERO, COUNTER);           // works
+    code[5] = ADDI(T_REG(3), REG_ZERO, 9);
+    code[6] = SC  (T_REG(3), REG_ZERO, COUNTER);           // used up: fails
+    code[7] = ADDI(V_REG(0), REG_ZERO, 10);
+    code[8] = SYSCALL();
+
+    WORD regs[34];
+    memset(regs, 0, sizeof(regs));
+
+    printf("single:     ");
+    ExecProcessor(code, CODE_SIZE, regs, data, DATA_SIZE, 0);
+
+    if (regs[T_REG(0)] != 0 || regs[T_REG(1)] != 7 || regs[T_REG(2)] != 1 ||
+        regs[T_REG(3)] != 0 || data[COUNTER/4] != 8)
+    {
+        printf("ERROR: single core: $t0-$t3 = %d %d %d %d, counter %d; expected 0 7 1 0, 8.\n",
+               regs[T_REG(0)], regs[T_REG(1)], regs[T_REG(2)], regs[T_REG(3)], data[COUNTER/4]);
+    }
+
+    // the functional model keeps the same reservation
+    WORD regsFunc[34];
+    memset(regsFunc, 0, sizeof(regsFunc));
+    data[COUNTER/4] = 7;
+
+    printf("functional: ");
+    ExecFunctional(code, CODE_SIZE, regsFunc, data, DATA_SIZE, 0);
+
+    if (memcmp(regs, regsFunc, sizeof(regs)) != 0 || data[COUNTER/4] != 8)
+        printf("ERROR: ExecFunctional() doesn't agree with the pipeline.\n");
+}
+
+
+typedef struct RunResult
+{
+    WORD      counter;
+    long long cycles;
+    long long failedSC;
+    long long portStalls;
+    WORD      regs[MULTICORE_MAX_CORES][34];
+} RunResult;
+
+
+// runs to the end, or 'chunk' clocks at a time if it is positive
+static void run(WORD *code, int cores, int memPorts, long long chunk,
+                FILE *quiet, RunResult *res)
+{
+    WORD data[DATA_SIZE];
+    memset(data, 0, sizeof(data));
+
+    MachineState *m = calloc(cores, sizeof(MachineState));
+    if (m == NULL)
+        return;
+
+    Multicore mc;
+    InitMulticore(&mc, memPorts);
+
+    int i;
+    for (i=0; i<cores; i++)
+    {
+        WORD regs[34];
+        memset(regs, 0, sizeof(regs));
+        regs[A_REG(0)] = i;
+
+        InitMachine(&m[i], code, CODE_SIZE, regs, data, DATA_SIZE, 0);
+        m[i].out = quiet;
+        AddCore(&mc, &m[i]);
+    }
+
+    if (chunk > 0)
+    {
+        while (ExecMulticore(&mc, chunk) == 0)
+            ;
+    }
+    else if (RunMulticore(&mc) != 1)
+        printf("ERROR: %d cores: RunMulticore() returned before the programs ended.\n", cores);
+
+    memset(res, 0, sizeof(*res));
+    res->counter = data[COUNTER/4];
+    res->cycles  = mc.cycles;
+    for (i=0; i<cores; i++)
+    {
+        res->failedSC   += m[i].regs[S_REG(1)];
+        res->portStalls += m[i].perf.stalls[STALL_MEMPORT];
+        memcpy(res->regs[i], m[i].regs, sizeof(m[i].regs));
+        FreeMachine(&m[i]);
+    }
+    free(m);
+}
+
+
+int main()
+{
+    test_single();
+
+    FILE *quiet = fopen("/dev/null", "w");
+    if (quiet == NULL)
+        return 1;
+
+    WORD atomic[CODE_SIZE], plain[CODE_SIZE];
+    build_counter(atomic, 1);
+    build_counter(plain,  0);
+
+    // one core in a Multicore is exactly one RunMachine()
+    WORD data[DATA_SIZE], regs[34];
+    memset(data, 0, sizeof(data));
+    memset(regs, 0, sizeof(regs));
+
+    MachineState one;
+    InitMachine(&one, atomic, CODE_SIZE, regs, data, DATA_SIZE, 0);
+    one.out = quiet;
+    RunMachine(&one);
+
+    RunResult res, again;
+    run(atomic, 1, 0, 0, quiet, &res);
+    if (res.cycles != one.cycles || memcmp(res.regs[0], one.regs, sizeof(one.regs)) != 0)
+        printf("ERROR: one core took %lld cycles, RunMachine() took %lld.\n", res.cycles, one.cycles);
+    FreeMachine(&one);
+
+    // every increment is there with ll/sc, however many cores there are
+    int cores, ports;
+    for (ports=0; ports<=1; ports++)
+    {
+        for (cores=1; cores<=8; cores*=2)
+        {
+            run(atomic, cores, ports, 0, quiet, &res);
+            printf("%d core(s), %s: %6lld cycles, %4lld failed sc, %5lld port stalls\n",
+                   cores, ports ? "1 port   " : "no limit ", res.cycles, res.failedSC, res.portStalls);
+
+            if (res.counter != cores*ITERATIONS)
+                printf("ERROR: %d cores: the counter is %d, expected %d.\n",
+                       cores, res.counter, cores*ITERATIONS);
+            if (cores == 1 && res.failedSC != 0)
+                printf("ERROR: an sc failed with only one core.\n");
+            if (ports == 0 && res.portStalls != 0)
+                printf("ERROR: there were port stalls with no port limit.\n");
+            if (ports == 1 && cores > 1 && res.portStalls == 0)
+                printf("ERROR: %d cores never waited for the one memory port.\n", cores);
+
+            /* the arbitration order is fixed, so every run is the same,
+             * even one which stops and starts
+             */
+            run(atomic, cores, ports, 37, quiet, &again);
+            if (again.cycles != res.cycles || memcmp(again.regs, res.regs, sizeof(res.regs)) != 0)
+                printf("ERROR: %d cores: two runs of the same program differ.\n", cores);
+        }
+    }
+
+    // without ll/sc, the cores lose each other's increments
+    run(plain, 4, 0, 0, quiet, &res);
+    printf("4 cores, lw/sw: counter %d of %d\n", res.counter, 4*ITERATIONS);
+    if (res.counter >= 4*ITERATIONS)
+        printf("ERROR: plain lw/sw didn't race.\n");
+
+    fclose(quiet);
+    return 0;
+}
@@ -0,0 +1,149 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <memory.h>
+
+#include "proj_hw05.h"
+#include "proj_hw05_test_commonCode.h"
+#include "proj_hw05_trace.h"
+#include "proj_hw05_perf.h"
+
+
+
+#define TRACE_FILE  "test_19_trace.trace"
+
+#define CODE_SIZE   16
+#define DATA_SIZE   64
+#define MAX_RECS    32
+
+
+// a load-use stall, a SW whose data comes from EX/MEM, and a taken
+// branch whose operand comes from EX/MEM
+static void build(WORD *code)
+{
+    memset(code, 0, CODE_SIZE*sizeof(WORD));
+    code[0] = LW  (T_REG(0), REG_ZERO, 4*3);           // 0x00
+    code[1] = ADD (T_REG(1), T_REG(0), T_REG(0));      // 0x04: stalls once
+    code[2] = SW  (T_REG(1), REG_ZERO, 4*10);          // 0x08
+    code[3] = BNE (T_REG(1), REG_ZERO, 1);             // 0x0c: taken
+    code[4] = ADDI(S_REG(0), REG_ZERO, 99);            // 0x10: skipped
+    code[5] = ADDI(V_REG(0), REG_ZERO, 10);            // 0x14
+    code[6] = SYSCALL();                               // 0x18: stalls twice
+}
+
+
+// reads the whole trace back; returns the number of records, or -1
+static int read_trace(TraceRecord *recs, int maxRecs)
+{
+    FILE *fp = fopen(TRACE_FILE, "rb");
+    if (fp == NULL)
+        return -1;
+
+    TraceFileHeader hdr;
+    if (fread(&hdr, sizeof(hdr), 1, fp) != 1              ||
+        memcmp(hdr.magic, TRACE_MAGIC, sizeof(hdr.magic)) ||
+        hdr.version    != TRACE_VERSION                    ||
+        hdr.recordSize != sizeof(TraceRecord))
+    {
+        fclose(fp);
+        return -1;
+    }
+
+    int n = fread(recs, sizeof(TraceRecord), maxRecs, fp);
+    fclose(fp);
+    return n;
+}
+
+
+
+int main()
+{
+    WORD code[CODE_SIZE];
+    build(code);
+
+    WORD regs[34], regsRef[34];
+    WORD data[DATA_SIZE], dataRef[DATA_SIZE];
+    memset(regs,    0, sizeof(regs));
+    memset(regsRef, 0, sizeof(regsRef));
+    memset(data,    0, sizeof(data));
+    data[3] = 7;
+    memcpy(dataRef, data, sizeof(data));
+
+    printf("Traced:    ");
+    ExecProcessorTraced(code, CODE_SIZE, regs, data, DATA_SIZE, 0, TRACE_FILE);
+    printf("Untraced:  ");
+    ExecProcessor(code, CODE_SIZE, regsRef, dataRef, DATA_SIZE, 0);
+
+    if (memcmp(regs, regsRef, sizeof(regs)) != 0 ||
+        memcmp(data, dataRef, sizeof(data)) != 0)
+        printf("ERROR: tracing changed the results of the program.\n");
+
+    TraceRecord recs[MAX_RECS];
+    int count = read_trace(recs, MAX_RECS);
+    remove(TRACE_FILE);
+
+    if (count < 0)
+    {
+        printf("ERROR: Could not read %s back.\n", TRACE_FILE);
+        return 1;
+    }
+
+    // the PC in ID on every clock; the clock on which the program
+    // ended isn't traced
+    WORD expectPC[] = { 0x00, 0x04, 0x04, 0x08, 0x0c, 0x14, 0x18, 0x18 };
+    int  clocks     = sizeof(expectPC)/sizeof(expectPC[0]);
+
+    if (count != clocks)
+    {
+        printf("ERROR: %d records in the trace, expected %d.\n", count, clocks);
+        return 1;
+    }
+
+    int i;
+    for (i=0; i<count; i++)
+    {
+        if (recs[i].cycle != (uint64_t)i || recs[i].pc != expectPC[i])
+            printf("ERROR: record %d is clock %llu at pc 0x%x, expected clock %d at pc 0x%x.\n",
+                   i, (unsigned long long)recs[i].cycle, recs[i].pc, i, expectPC[i]);
+    }
+
+    // clock 1: the ADD waits for the LW
+    if (!(recs[1].flags & TRACE_STALL) || TRACE_CAUSE(recs[1].flags) != STALL_LOAD_USE)
+        printf("ERROR: the ADD didn't take a load-use stall.\n");
+    if (recs[2].flags & TRACE_STALL)
+        printf("ERROR: the ADD stalled twice.\n");
+
+    // clock 3: the ADD is in EX, and both inputs come from the LW in WB
+    if (recs[3].fwd1 != FWD_MEMWB || recs[3].fwd2 != FWD_MEMWB ||
+        recs[3].aluInput1 != 7    || recs[3].aluInput2 != 7)
+        printf("ERROR: the ADD's inputs weren't forwarded from MEM/WB.\n");
+
+    // clock 4: the BNE compares the ADD's result, forwarded from EX/MEM,
+    // while the SW picks up the same value in EX
+    if ((recs[4].flags & TRACE_STALL) || recs[4].branchControl != 1)
+        printf("ERROR: the BNE wasn't taken, without a stall.\n");
+    if (recs[4].exmem.memWrite != 1 || recs[4].exmem.rtVal != 14)
+        printf("ERROR: the SW data in EX/MEM is 0x%x, expected 14.\n", recs[4].exmem.rtVal);
+
+    // clock 5: the SW writes word 10; nothing else writes memory
+    for (i=0; i<count; i++)
+    {
+        int expectIndx = (i == 5) ? 10 : -1;
+        if (recs[i].memIndx != expectIndx)
+            printf("ERROR: clock %d wrote memory word %d, expected %d.\n",
+                   i, recs[i].memIndx, expectIndx);
+    }
+    if (recs[5].memOld != 0 || recs[5].memNew != 14)
+        printf("ERROR: the SW changed word 10 from %d to %d, expected 0 to 14.\n",
+               recs[5].memOld, recs[5].memNew);
+
+    // clocks 6 and 7: the syscall waits for $v0
+    for (i=6; i<8; i++)
+    {
+        if (!(recs[i].flags & TRACE_SYSCALL) || !(recs[i].flags & TRACE_STALL) ||
+            TRACE_CAUSE(recs[i].flags) != STALL_ID_OPERAND)
+            printf("ERROR: clock %d isn't a stalled syscall.\n", i);
+    }
+
+    printf("%d clocks traced.\n", count);
+    return 0;
+}